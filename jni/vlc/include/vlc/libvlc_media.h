@@ -140,6 +140,24 @@ typedef struct libvlc_media_stats_t
     int         i_sent_packets;
     int         i_sent_bytes;
     float       f_send_bitrate;
+
+    /* Pipeline, the times are the microseconds spent in each stage */
+    int64_t     i_demux_time;
+    int64_t     i_decode_video_time;
+    int64_t     i_decode_audio_time;
+    int64_t     i_convert_time;     /* video filters, conversions, copies */
+    int64_t     i_blend_time;       /* subpicture rendering and blending */
+    int64_t     i_display_time;
+    int64_t     i_copied_bytes;     /* copied between picture buffers */
+    int64_t     i_audio_delay;      /* time the last buffer waits in the
+                                       audio output before being played */
+    int         i_video_queue;      /* blocks waiting for the video decoder */
+    int         i_audio_queue;      /* blocks waiting for the audio decoder */
+
+    /* Network, live sources only */
+    int64_t     i_network_jitter;   /* measured interarrival jitter */
+    int         i_network_lost;     /* packets never received */
+    int64_t     i_network_buffer;   /* jitter buffer depth */
 } libvlc_media_stats_t;
 /** @}*/
 
@@ -82,6 +82,10 @@ typedef struct block_sys_t block_sys_t;
 #define BLOCK_FLAG_TOP_FIELD_FIRST 0x2000
 /** This block contains an interlaced picture with bottom field first */
 #define BLOCK_FLAG_BOTTOM_FIELD_FIRST 0x4000
+/** The buffer is followed by zeroed padding, as much as libavcodec reads
+ * past the data, so that it can be decoded in place. Copies of the block
+ * do not inherit it. */
+#define BLOCK_FLAG_PADDED        0x8000
 
 /** This block contains an interlaced picture */
 #define BLOCK_FLAG_INTERLACED_MASK \
@@ -151,7 +155,7 @@ static inline block_t *block_Duplicate( block_t *p_block )
 
     p_dup->i_dts     = p_block->i_dts;
     p_dup->i_pts     = p_block->i_pts;
-    p_dup->i_flags   = p_block->i_flags;
+    p_dup->i_flags   = p_block->i_flags & ~BLOCK_FLAG_PADDED;
     p_dup->i_length  = p_block->i_length;
     p_dup->i_rate    = p_block->i_rate;
     p_dup->i_nb_samples = p_block->i_nb_samples;
@@ -277,7 +281,7 @@ static inline block_t *block_ChainGather( block_t *p_list )
     g = block_Alloc( i_total );
     block_ChainExtract( p_list, g->p_buffer, g->i_buffer );
 
-    g->i_flags = p_list->i_flags;
+    g->i_flags = p_list->i_flags & ~BLOCK_FLAG_PADDED;
     g->i_pts   = p_list->i_pts;
     g->i_dts   = p_list->i_dts;
     g->i_length = i_length;
@@ -69,6 +69,10 @@ struct decoder_t
     /* Tell the decoder if it is allowed to drop frames */
     bool                b_pace_control;
 
+    /* Number of decoded pictures which may wait for their display, set by
+     * the owner when the video output is created (0 if unknown) */
+    unsigned            i_pictures_ahead;
+
     /* */
     picture_t *         ( * pf_decode_video )( decoder_t *, block_t ** );
     aout_buffer_t *     ( * pf_decode_audio )( decoder_t *, block_t ** );
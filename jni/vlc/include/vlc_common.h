@@ -813,6 +813,10 @@ VLC_API void vlc_tdestroy( void *, void (*)(void *) );
 /* Fast large memory copy and memory set */
 VLC_API void * vlc_memcpy( void *, const void *, size_t );
 #define vlc_memset memset
+/* Fast copy of i_lines lines of i_width bytes between two pitched planes */
+VLC_API void vlc_plane_copy( uint8_t *p_dst, size_t i_dst_pitch,
+                             const uint8_t *p_src, size_t i_src_pitch,
+                             size_t i_width, size_t i_lines );
 
 /*****************************************************************************
  * I18n stuff
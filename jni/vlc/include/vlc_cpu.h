@@ -85,8 +85,12 @@ VLC_API unsigned vlc_CPU( void );
 # endif
 
 typedef void *(*vlc_memcpy_t) (void *tgt, const void *src, size_t n);
+typedef void (*vlc_plane_copy_t) (uint8_t *dst, size_t dst_pitch,
+                                  const uint8_t *src, size_t src_pitch,
+                                  size_t width, size_t lines);
 
 VLC_API void vlc_fastmem_register(vlc_memcpy_t cpy);
+VLC_API void vlc_fastplane_register(vlc_plane_copy_t cpy);
 
 #endif /* !VLC_CPU_H */
 
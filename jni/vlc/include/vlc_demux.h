@@ -159,6 +159,11 @@ enum demux_query_e
     DEMUX_SET_RATE,             /* arg1= int*pi_rate                                        can fail */
 
     DEMUX_CAN_SEEK,            /* arg1= bool*    can fail (assume false)*/
+
+    /* Network reception of the live sources, in microseconds for the
+     * jitter and the buffer, in packets for the losses */
+    DEMUX_GET_NETWORK_STATS,   /* arg1= int64_t *pi_jitter arg2= int64_t *pi_lost
+                                  arg3= int64_t *pi_buffer  can fail */
 };
 
 VLC_API int demux_vaControlHelper( stream_t *, int64_t i_start, int64_t i_end, int64_t i_bitrate, int i_align, int i_query, va_list args );
@@ -317,6 +317,7 @@
 #define VLC_CODEC_SUBT      VLC_FOURCC('s','u','b','t')
 #define VLC_CODEC_XSUB      VLC_FOURCC('X','S','U','B')
 #define VLC_CODEC_SSA       VLC_FOURCC('s','s','a',' ')
+#define VLC_CODEC_DANMAKU   VLC_FOURCC('d','m','k','u')
 #define VLC_CODEC_TEXT      VLC_FOURCC('T','E','X','T')
 #define VLC_CODEC_TELETEXT  VLC_FOURCC('t','e','l','x')
 #define VLC_CODEC_KATE      VLC_FOURCC('k','a','t','e')
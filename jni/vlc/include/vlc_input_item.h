@@ -296,6 +296,23 @@ struct input_stats_t
     /* Vout */
     int64_t i_displayed_pictures;
     int64_t i_lost_pictures;
+    int64_t i_copied_bytes;     /* copied between buffers by the vout */
+
+    /* Pipeline, the times are the microseconds spent in each stage */
+    int64_t i_demux_time;
+    int64_t i_decode_video_time;
+    int64_t i_decode_audio_time;
+    int64_t i_convert_time;     /* vout filters, conversions and copies */
+    int64_t i_blend_time;       /* subpicture rendering and blending */
+    int64_t i_display_time;
+    int64_t i_audio_delay;      /* time the last buffer waits in the aout */
+    int64_t i_video_queue;      /* blocks waiting for the video decoder */
+    int64_t i_audio_queue;      /* blocks waiting for the audio decoder */
+
+    /* Network, for the demuxers able to tell */
+    int64_t i_network_jitter;   /* measured interarrival jitter */
+    int64_t i_network_lost;     /* packets never received */
+    int64_t i_network_buffer;   /* jitter buffer depth */
 
     /* Sout */
     int64_t i_sent_packets;
@@ -111,6 +111,9 @@ enum stream_query_e
 
     /* XXX only data read through stream_Read/Block will be recorded */
     STREAM_SET_RECORD_STATE,     /**< arg1=bool, arg2=const char *psz_ext (if arg1 is true)  res=can fail */
+
+    /* Caching wanted by the access, for an access made of other streams */
+    STREAM_GET_PTS_DELAY,       /**< arg1= int64_t *       res=can fail */
 };
 
 VLC_API int stream_Read( stream_t *s, void *p_read, int i_read );
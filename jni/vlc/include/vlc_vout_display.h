@@ -193,6 +193,8 @@ enum {
 
     VOUT_DISPLAY_EVENT_DISPLAY_SIZE,        /* The display size need to change : int i_width, int i_height, bool is_fullscreen */
 
+    VOUT_DISPLAY_EVENT_EXPOSED,             /* The displayed content was lost and must be displayed again */
+
     /* */
     VOUT_DISPLAY_EVENT_CLOSE,
     VOUT_DISPLAY_EVENT_KEY,
@@ -348,6 +350,10 @@ static inline void vout_display_SendEventPicturesInvalid(vout_display_t *vd)
 {
     vout_display_SendEvent(vd, VOUT_DISPLAY_EVENT_PICTURES_INVALID);
 }
+static inline void vout_display_SendEventExposed(vout_display_t *vd)
+{
+    vout_display_SendEvent(vd, VOUT_DISPLAY_EVENT_EXPOSED);
+}
 static inline void vout_display_SendEventClose(vout_display_t *vd)
 {
     vout_display_SendEvent(vd, VOUT_DISPLAY_EVENT_CLOSE);
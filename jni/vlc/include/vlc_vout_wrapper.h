@@ -82,7 +82,11 @@ VLC_API bool vout_IsDisplayFiltered(vout_display_t *);
 VLC_API picture_t * vout_FilterDisplay(vout_display_t *, picture_t *);
 VLC_API bool vout_AreDisplayPicturesInvalid(vout_display_t *);
 
-VLC_API void vout_ManageDisplay(vout_display_t *, bool allow_reset_pictures);
+/**
+ * It returns true if the display configuration changed or if the display
+ * lost its content, ie when the last picture must be displayed again.
+ */
+VLC_API bool vout_ManageDisplay(vout_display_t *, bool allow_reset_pictures);
 
 VLC_API void vout_SetDisplayFullscreen(vout_display_t *, bool is_fullscreen);
 VLC_API void vout_SetDisplayFilled(vout_display_t *, bool is_filled);
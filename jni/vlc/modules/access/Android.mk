@@ -60,6 +60,31 @@ ifeq ($(BUILD_WITH_NEON),1)
 LOCAL_ARM_NEON := true
 endif
 
+LOCAL_MODULE := access_concat_plugin
+
+LOCAL_CFLAGS += \
+    -std=c99 \
+    -DHAVE_CONFIG_H \
+    -DMODULE_STRING=\"access_concat\" \
+    -DMODULE_NAME=access_concat
+
+LOCAL_C_INCLUDES += \
+    $(VLCROOT) \
+    $(VLCROOT)/include \
+    $(VLCROOT)/src
+
+LOCAL_SRC_FILES := \
+    concat.c
+
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_ARM_MODE := arm
+ifeq ($(BUILD_WITH_NEON),1)
+LOCAL_ARM_NEON := true
+endif
+
 LOCAL_MODULE := filesystem_plugin
 
 LOCAL_CFLAGS += \
@@ -101,7 +126,9 @@ LOCAL_C_INCLUDES += \
     $(VLCROOT)/src
 
 LOCAL_SRC_FILES := \
-    http.c
+    http.c \
+    http_range.c \
+    http_cache.c
 
 include $(BUILD_STATIC_LIBRARY)
 
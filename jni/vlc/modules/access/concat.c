@@ -0,0 +1,556 @@
+/*****************************************************************************
+ * concat.c: access to the segments of a media as one stream
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_access.h>
+#include <vlc_stream.h>
+#include <vlc_input.h>
+#include <vlc_charset.h>
+
+#include <limits.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define DURATIONS_TEXT N_("Segment durations")
+#define DURATIONS_LONGTEXT N_( \
+    "Comma separated durations of the segments in seconds. They are used " \
+    "to find the segment of a seek." )
+
+#define PREFETCH_TEXT N_("Prefetch size")
+#define PREFETCH_LONGTEXT N_( \
+    "Size in KiB of the beginning of the next segment that is fetched " \
+    "while the current one is played." )
+
+vlc_module_begin ()
+    set_shortname( N_("Concat") )
+    set_description( N_("Segmented FLV concatenation") )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_ACCESS )
+    add_string( "concat-durations", NULL, DURATIONS_TEXT,
+                DURATIONS_LONGTEXT, true )
+    add_integer( "concat-prefetch", 512, PREFETCH_TEXT,
+                 PREFETCH_LONGTEXT, true )
+    set_capability( "access", 0 )
+    add_shortcut( "concat" )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+typedef struct
+{
+    char    *psz_url;
+    int64_t i_size;     /* -1 until known */
+} concat_segment_t;
+
+struct access_sys_t
+{
+    int              i_segment;
+    concat_segment_t *p_segment;
+
+    /* Current segment */
+    int      i_current;
+    stream_t *s;
+    uint64_t i_start;   /* position of its first byte, a lower bound when
+                         * the size of a previous segment is unknown */
+
+    /* Next segment, opened and partially read in the background */
+    vlc_thread_t thread;
+    bool         b_prefetch;
+    vlc_object_t *p_prefetch_obj; /* parent of its stream, killed to abort */
+    int          i_prefetch;
+    stream_t     *p_prefetch;
+    int          i_prefetch_size;
+
+    /* One seekpoint per segment */
+    input_title_t *p_title;
+};
+
+static ssize_t Read( access_t *, uint8_t *, size_t );
+static int Seek( access_t *, uint64_t );
+static int Control( access_t *, int, va_list );
+
+static int  SegmentSwitch( access_t *, int );
+static void PrefetchStop( access_t *, bool b_abort );
+
+/*****************************************************************************
+ * Open: concat://url1|url2|..., the segments of an FLV media
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys;
+
+    if( !*p_access->psz_location )
+        return VLC_EGENERIC;
+
+    char *psz_list = strdup( p_access->psz_location );
+    if( !psz_list )
+        return VLC_ENOMEM;
+
+    p_access->p_sys = p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( !p_sys )
+    {
+        free( psz_list );
+        return VLC_ENOMEM;
+    }
+    p_sys->i_current = -1;
+    p_sys->i_prefetch = -1;
+    p_sys->i_prefetch_size = __MAX( var_InheritInteger( p_access, "concat-prefetch" ), 0 ) * 1024;
+
+    char *psz_save;
+    for( char *psz_url = strtok_r( psz_list, "|", &psz_save );
+         psz_url; psz_url = strtok_r( NULL, "|", &psz_save ) )
+    {
+        concat_segment_t *p_segment = realloc( p_sys->p_segment,
+                                               ( p_sys->i_segment + 1 ) * sizeof(*p_segment) );
+        if( !p_segment )
+            break;
+        p_sys->p_segment = p_segment;
+        p_segment[p_sys->i_segment].psz_url = strdup( psz_url );
+        p_segment[p_sys->i_segment].i_size = -1;
+        if( !p_segment[p_sys->i_segment].psz_url )
+            break;
+        p_sys->i_segment++;
+    }
+    free( psz_list );
+    if( p_sys->i_segment <= 0 )
+        goto error;
+
+    /* Segments as seekpoints, at the times given by their durations */
+    if( p_sys->i_segment > 1 )
+    {
+        char *psz_durations = var_InheritString( p_access, "concat-durations" );
+        const char *psz = psz_durations;
+        int64_t i_time = 0;
+
+        p_sys->p_title = vlc_input_title_New();
+        for( int i = 0; i < p_sys->i_segment; i++ )
+        {
+            seekpoint_t *p_seekpoint = vlc_seekpoint_New();
+
+            if( asprintf( &p_seekpoint->psz_name, _("Segment %d"), i + 1 ) < 0 )
+                p_seekpoint->psz_name = NULL;
+            p_seekpoint->i_time_offset = psz ? i_time : -1;
+            TAB_APPEND( p_sys->p_title->i_seekpoint, p_sys->p_title->seekpoint,
+                        p_seekpoint );
+
+            /* Stop at the first invalid duration */
+            char *psz_end = NULL;
+            const double f_duration = psz ? us_strtod( psz, &psz_end ) : 0.0;
+            if( f_duration <= 0.0 || psz_end == psz ||
+                ( *psz_end != ',' && i + 1 < p_sys->i_segment ) )
+            {
+                psz = NULL;
+                continue;
+            }
+            i_time += f_duration * CLOCK_FREQ;
+            psz = psz_end + ( *psz_end == ',' );
+        }
+        if( psz )
+            p_sys->p_title->i_length = i_time;
+        free( psz_durations );
+    }
+
+    access_InitFields( p_access );
+    ACCESS_SET_CALLBACKS( Read, NULL, Control, Seek );
+
+    if( SegmentSwitch( p_access, 0 ) )
+        goto error;
+
+    msg_Dbg( p_access, "concatenating %d segments", p_sys->i_segment );
+    return VLC_SUCCESS;
+
+error:
+    Close( p_this );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close:
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
+
+    PrefetchStop( p_access, true );
+    if( p_sys->p_prefetch )
+        stream_Delete( p_sys->p_prefetch );
+    if( p_sys->s )
+        stream_Delete( p_sys->s );
+
+    for( int i = 0; i < p_sys->i_segment; i++ )
+        free( p_sys->p_segment[i].psz_url );
+    free( p_sys->p_segment );
+    vlc_input_title_Delete( p_sys->p_title );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Prefetch: open the next segment and fill its stream cache
+ *****************************************************************************/
+/* The cache is filled in steps, so that an abort is noticed soon */
+#define PREFETCH_STEP (32 * 1024)
+
+static void *PrefetchThread( void *p_data )
+{
+    access_t     *p_access = p_data;
+    access_sys_t *p_sys = p_access->p_sys;
+    vlc_object_t *p_obj = p_sys->p_prefetch_obj;
+    const uint8_t *p_peek;
+    stream_t *s = NULL;
+
+    /* Not cancellable, the stream would leak: it is aborted by killing
+     * p_prefetch_obj and its children instead */
+    int canc = vlc_savecancel();
+
+    if( vlc_object_alive( p_obj ) )
+        s = stream_UrlNew( p_obj, p_sys->p_segment[p_sys->i_prefetch].psz_url );
+
+    int i_peek = 0;
+    while( s && i_peek < p_sys->i_prefetch_size && vlc_object_alive( p_obj ) )
+    {
+        const int i_want = __MIN( i_peek + PREFETCH_STEP, p_sys->i_prefetch_size );
+        i_peek = stream_Peek( s, &p_peek, i_want );
+        if( i_peek < i_want )
+            break;
+    }
+    p_sys->p_prefetch = s;
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+/* Kill an object and the ones it created, the access and the stream of the
+ * prefetch: their connection and reads then return at once */
+static void PrefetchKill( vlc_object_t *p_obj )
+{
+    vlc_object_kill( p_obj );
+
+    vlc_list_t *p_list = vlc_list_children( p_obj );
+    for( int i = 0; i < p_list->i_count; i++ )
+        PrefetchKill( p_list->p_values[i].p_object );
+    vlc_list_release( p_list );
+}
+
+static void PrefetchStart( access_t *p_access, int i_segment )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( i_segment >= p_sys->i_segment || p_sys->b_prefetch ||
+        ( p_sys->p_prefetch && p_sys->i_prefetch == i_segment ) )
+        return;
+
+    if( p_sys->p_prefetch )
+    {
+        stream_Delete( p_sys->p_prefetch );
+        p_sys->p_prefetch = NULL;
+    }
+    p_sys->p_prefetch_obj = vlc_object_create( p_access, sizeof( *p_sys->p_prefetch_obj ) );
+    if( !p_sys->p_prefetch_obj )
+        return;
+    p_sys->i_prefetch = i_segment;
+    p_sys->b_prefetch = !vlc_clone( &p_sys->thread, PrefetchThread, p_access,
+                                    VLC_THREAD_PRIORITY_LOW );
+    if( !p_sys->b_prefetch )
+    {
+        vlc_object_release( p_sys->p_prefetch_obj );
+        p_sys->p_prefetch_obj = NULL;
+    }
+}
+
+/* Wait for the prefetch thread, its stream is then in p_prefetch. When it
+ * is aborted, it is interrupted first and what it fetched is dropped. */
+static void PrefetchStop( access_t *p_access, bool b_abort )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( !p_sys->b_prefetch )
+        return;
+    if( b_abort )
+        PrefetchKill( p_sys->p_prefetch_obj );
+    vlc_join( p_sys->thread, NULL );
+    p_sys->b_prefetch = false;
+
+    /* The stream keeps its parent alive */
+    vlc_object_release( p_sys->p_prefetch_obj );
+    p_sys->p_prefetch_obj = NULL;
+    if( b_abort && p_sys->p_prefetch )
+    {
+        stream_Delete( p_sys->p_prefetch );
+        p_sys->p_prefetch = NULL;
+    }
+}
+
+/*****************************************************************************
+ * Segments
+ *****************************************************************************/
+/* Only the sizes already known are used, no segment is opened to learn
+ * its size */
+static int64_t SegmentSize( access_t *p_access, int i_segment )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    concat_segment_t *p_segment = &p_sys->p_segment[i_segment];
+
+    if( p_segment->i_size < 0 && i_segment == p_sys->i_current &&
+        stream_Size( p_sys->s ) > 0 )
+        p_segment->i_size = stream_Size( p_sys->s );
+    return p_segment->i_size;
+}
+
+static int SegmentSwitch( access_t *p_access, int i_segment )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint64_t i_start = 0;
+
+    /* The position of the segment needs the sizes of the previous ones,
+     * the unknown ones are skipped so that the positions still grow */
+    for( int i = 0; i < i_segment; i++ )
+    {
+        const int64_t i_size = SegmentSize( p_access, i );
+        if( i_size > 0 )
+            i_start += i_size;
+    }
+
+    stream_t *s;
+    /* Only the prefetch of another segment is worth interrupting */
+    PrefetchStop( p_access, p_sys->i_prefetch != i_segment );
+    const bool b_prefetched = p_sys->p_prefetch && p_sys->i_prefetch == i_segment;
+    if( b_prefetched )
+    {
+        s = p_sys->p_prefetch;
+        p_sys->p_prefetch = NULL;
+    }
+    else
+    {
+        s = stream_UrlNew( p_access, p_sys->p_segment[i_segment].psz_url );
+    }
+    if( !s )
+    {
+        msg_Err( p_access, "cannot open segment %d", i_segment + 1 );
+        return VLC_EGENERIC;
+    }
+    /* Only the FLV demuxer continues its timeline across the segments,
+     * others (like MP4 with one moov per segment) would stop at the first */
+    const uint8_t *p_peek;
+    if( stream_Peek( s, &p_peek, 3 ) < 3 || memcmp( p_peek, "FLV", 3 ) )
+    {
+        msg_Err( p_access, "segment %d is not FLV, only FLV segments can be "
+                 "concatenated", i_segment + 1 );
+        stream_Delete( s );
+        return VLC_EGENERIC;
+    }
+    msg_Dbg( p_access, "segment %d at %"PRIu64"%s", i_segment + 1, i_start,
+             b_prefetched ? " (prefetched)" : "" );
+
+    if( p_sys->s )
+        stream_Delete( p_sys->s );
+    p_sys->s = s;
+    p_sys->i_current = i_segment;
+    p_sys->i_start = i_start;
+    if( p_sys->p_segment[i_segment].i_size < 0 && stream_Size( s ) > 0 )
+        p_sys->p_segment[i_segment].i_size = stream_Size( s );
+
+    p_access->info.i_pos = i_start;
+    p_access->info.b_eof = false;
+    if( p_sys->p_title )
+    {
+        p_access->info.i_seekpoint = i_segment;
+        p_access->info.i_update |= INPUT_UPDATE_SEEKPOINT;
+    }
+
+    /* The whole size is only known once all the segments have been seen */
+    uint64_t i_size = 0;
+    for( int i = 0; i < p_sys->i_segment && i_size != UINT64_MAX; i++ )
+        i_size = p_sys->p_segment[i].i_size >= 0 ? i_size + p_sys->p_segment[i].i_size
+                                                 : UINT64_MAX;
+    if( i_size != UINT64_MAX && i_size != p_access->info.i_size )
+    {
+        p_access->info.i_size = i_size;
+        p_access->info.i_update |= INPUT_UPDATE_SIZE;
+    }
+
+    PrefetchStart( p_access, i_segment + 1 );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Read: from the current segment, then the next ones
+ *****************************************************************************/
+static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( i_len == 0 || p_access->info.b_eof )
+        return 0;
+
+    for( ;; )
+    {
+        const int i_read = stream_Read( p_sys->s, p_buffer, __MIN( i_len, INT_MAX ) );
+        if( i_read > 0 )
+        {
+            p_access->info.i_pos += i_read;
+            return i_read;
+        }
+
+        /* End of the segment, its size is now known for sure */
+        concat_segment_t *p_segment = &p_sys->p_segment[p_sys->i_current];
+        if( p_segment->i_size < 0 )
+            p_segment->i_size = p_access->info.i_pos - p_sys->i_start;
+
+        if( p_sys->i_current + 1 >= p_sys->i_segment ||
+            SegmentSwitch( p_access, p_sys->i_current + 1 ) )
+        {
+            p_access->info.b_eof = true;
+            return 0;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Seek:
+ *****************************************************************************/
+static int Seek( access_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    int i_segment = p_sys->i_current;
+    uint64_t i_start = p_sys->i_start;
+    const int64_t i_current_size = SegmentSize( p_access, i_segment );
+
+    /* Positions in the current segment are counted from its start, known
+     * or not; another segment needs the sizes of the previous ones */
+    if( i_pos < i_start ||
+        ( i_current_size >= 0 && i_pos >= i_start + i_current_size &&
+          i_segment + 1 < p_sys->i_segment ) )
+    {
+        i_start = 0;
+        for( i_segment = 0; i_segment + 1 < p_sys->i_segment; i_segment++ )
+        {
+            const int64_t i_size = SegmentSize( p_access, i_segment );
+            if( i_size < 0 )
+            {
+                msg_Dbg( p_access, "cannot seek past segment %d of unknown size",
+                         i_segment + 1 );
+                return VLC_EGENERIC;
+            }
+            if( i_pos < i_start + i_size )
+                break;
+            i_start += i_size;
+        }
+
+        if( i_segment != p_sys->i_current &&
+            SegmentSwitch( p_access, i_segment ) )
+            return VLC_EGENERIC;
+    }
+    if( stream_Seek( p_sys->s, i_pos - i_start ) )
+        return VLC_EGENERIC;
+
+    p_access->info.i_pos = i_pos;
+    p_access->info.b_eof = false;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Control:
+ *****************************************************************************/
+static int Control( access_t *p_access, int i_query, va_list args )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    bool *pb_bool;
+    int64_t *pi_64;
+    int i;
+
+    switch( i_query )
+    {
+    case ACCESS_CAN_SEEK:
+        pb_bool = (bool*)va_arg( args, bool* );
+        return stream_Control( p_sys->s, STREAM_CAN_SEEK, pb_bool );
+
+    case ACCESS_CAN_FASTSEEK:
+        pb_bool = (bool*)va_arg( args, bool* );
+        *pb_bool = false;
+        break;
+
+    case ACCESS_CAN_PAUSE:
+    case ACCESS_CAN_CONTROL_PACE:
+        pb_bool = (bool*)va_arg( args, bool* );
+        *pb_bool = true;
+        break;
+
+    case ACCESS_GET_PTS_DELAY:
+        pi_64 = (int64_t*)va_arg( args, int64_t * );
+        /* The caching of the access of the current segment */
+        if( stream_Control( p_sys->s, STREAM_GET_PTS_DELAY, pi_64 ) )
+            *pi_64 = INT64_C(1000) * var_InheritInteger( p_access, "network-caching" );
+        break;
+
+    case ACCESS_GET_TITLE_INFO:
+    {
+        input_title_t ***ppp_title = va_arg( args, input_title_t *** );
+        int *pi_title = va_arg( args, int * );
+
+        if( !p_sys->p_title )
+            return VLC_EGENERIC;
+        *ppp_title = malloc( sizeof( input_title_t * ) );
+        if( !*ppp_title )
+            return VLC_ENOMEM;
+        (*ppp_title)[0] = vlc_input_title_Duplicate( p_sys->p_title );
+        *pi_title = 1;
+        break;
+    }
+
+    case ACCESS_SET_TITLE:
+        i = (int)va_arg( args, int );
+        return i == 0 ? VLC_SUCCESS : VLC_EGENERIC;
+
+    case ACCESS_SET_SEEKPOINT:
+        i = (int)va_arg( args, int );
+        if( i < 0 || i >= p_sys->i_segment )
+            return VLC_EGENERIC;
+        if( i == p_sys->i_current )
+            return Seek( p_access, p_sys->i_start );
+        return SegmentSwitch( p_access, i );
+
+    case ACCESS_SET_PAUSE_STATE:
+        break;
+
+    case ACCESS_GET_CONTENT_TYPE:
+        return stream_Control( p_sys->s, STREAM_GET_CONTENT_TYPE,
+                               va_arg( args, char ** ) );
+
+    default:
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
@@ -65,6 +65,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #if defined( WIN32 ) && !defined( UNDER_CE )
 #   ifdef lseek
@@ -85,6 +88,10 @@ struct access_sys_t
 
     int fd;
 
+    /* memory mapped mode */
+    size_t page_mask;
+    unsigned i_sequential; /* blocks read without seeking in between */
+
     /* */
     unsigned caching;
     bool b_pace_control;
@@ -218,6 +225,8 @@ int Open( vlc_object_t *p_this )
     p_access->p_sys = p_sys;
     p_sys->i_nb_reads = 0;
     p_sys->fd = fd;
+    p_sys->page_mask = 0;
+    p_sys->i_sequential = 0;
     p_sys->caching = var_InheritInteger (p_access, "file-caching");
     if (IsRemote(fd))
         p_sys->caching += var_InheritInteger (p_access, "network-caching");
@@ -231,6 +240,22 @@ int Open( vlc_object_t *p_this )
         p_sys->b_pace_control = strcasecmp (p_access->psz_access, "stream");
     }
 
+#ifdef HAVE_MMAP
+    /* Remote files may vanish (SIGBUS on access) */
+    if (S_ISREG (st.st_mode) && st.st_size > 0 && !IsRemote (fd)
+     && var_InheritBool (p_access, "file-mmap"))
+    {
+        const long pagesize = sysconf (_SC_PAGESIZE);
+        if (pagesize > 0 && !(pagesize & (pagesize - 1)))
+        {
+            msg_Dbg (p_access, "memory mapping the file");
+            p_sys->page_mask = pagesize - 1;
+            p_access->pf_read = NULL;
+            p_access->pf_block = FileBlock;
+        }
+    }
+#endif
+
     if (p_access->pf_seek != NoSeek)
     {
         /* Demuxers will need the beginning of the file for probing. */
@@ -262,7 +287,7 @@ void Close (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_block == DirBlock)
     {
         DirClose (p_this);
         return;
@@ -334,11 +359,93 @@ ssize_t FileRead( access_t *p_access, uint8_t *p_buffer, size_t i_len )
 }
 
 
+#ifdef HAVE_MMAP
+/* Size of the file windows mapped by FileBlock() */
+#define MMAP_WINDOW_SIZE (1 << 20)
+
+/*****************************************************************************
+ * Block: map the next window of the file
+ *****************************************************************************
+ * The returned block references the mapping, it is unmapped when the block is
+ * released, so only the windows still used by the stream cache or the
+ * demuxer are mapped.
+ *****************************************************************************/
+block_t *FileBlock (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    const uint64_t i_pos = p_access->info.i_pos;
+
+    /* The file may have grown */
+    if (i_pos >= p_access->info.i_size)
+    {
+        struct stat st;
+
+        if (fstat (p_sys->fd, &st) == 0
+         && p_access->info.i_size != (uint64_t)st.st_size)
+        {
+            p_access->info.i_size = st.st_size;
+            p_access->info.i_update |= INPUT_UPDATE_SIZE;
+        }
+        if (i_pos >= p_access->info.i_size)
+        {
+            p_access->info.b_eof = true;
+            return NULL;
+        }
+    }
+
+    /* The offset must be page aligned, it is after the first window */
+    const uint64_t i_offset = i_pos & ~(uint64_t)p_sys->page_mask;
+    const size_t i_inner = i_pos - i_offset;
+    const size_t i_length = __MIN (p_access->info.i_size - i_offset,
+                                   MMAP_WINDOW_SIZE);
+
+    void *addr = mmap (NULL, i_length, PROT_READ, MAP_SHARED,
+                       p_sys->fd, i_offset);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping failed (%m)");
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+
+    /* Contiguous windows are read ahead by the kernel, while the demuxer
+     * seeks around (probing, index parsing or reading backward) only the
+     * pages it touches are read. */
+#ifdef MADV_SEQUENTIAL
+    if (p_sys->i_sequential > 0)
+    {
+        madvise (addr, i_length, MADV_SEQUENTIAL);
+        madvise (addr, i_length, MADV_WILLNEED);
+    }
+    else
+        madvise (addr, i_length, MADV_RANDOM);
+#endif
+    p_sys->i_sequential++;
+
+    block_t *p_block = block_mmap_Alloc (addr, i_length);
+    if (p_block == NULL)
+        return NULL;
+
+    p_block->p_buffer += i_inner;
+    p_block->i_buffer -= i_inner;
+    p_access->info.i_pos = i_offset + i_length;
+    return p_block;
+}
+#else
+block_t *FileBlock (access_t *p_access)
+{
+    (void) p_access;
+    return NULL;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
 int FileSeek (access_t *p_access, uint64_t i_pos)
 {
+    if (p_access->info.i_pos != i_pos)
+        p_access->p_sys->i_sequential = 0;
     p_access->info.i_pos = i_pos;
     p_access->info.b_eof = false;
 
@@ -25,6 +25,7 @@ void Close (vlc_object_t *);
 int NoSeek (access_t *, uint64_t);
 
 ssize_t FileRead (access_t *, uint8_t *, size_t);
+block_t *FileBlock (access_t *);
 int FileSeek (access_t *, uint64_t);
 int FileControl (access_t *, int, va_list);
 
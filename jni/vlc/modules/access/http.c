@@ -62,6 +62,8 @@
 #   include <windows.h>
 #endif
 
+#include "http.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -129,6 +131,16 @@ vlc_module_begin ()
         change_safe()
     add_bool( "http-forward-cookies", true, FORWARD_COOKIES_TEXT,
               FORWARD_COOKIES_LONGTEXT, true )
+    add_integer_with_range( "http-connections", 3, 0, 8, CONNECTIONS_TEXT,
+                            CONNECTIONS_LONGTEXT, true )
+    add_integer( "http-readahead", 20, READAHEAD_TEXT,
+                 READAHEAD_LONGTEXT, true )
+    add_integer( "http-range-cache", 32, RANGE_CACHE_TEXT,
+                 RANGE_CACHE_LONGTEXT, true )
+    add_directory( "http-cache-dir", NULL, CACHE_DIR_TEXT,
+                   CACHE_DIR_LONGTEXT, true )
+    add_integer( "http-cache-size", 256, CACHE_SIZE_TEXT,
+                 CACHE_SIZE_LONGTEXT, true )
     /* 'itpc' = iTunes Podcast */
     add_shortcut( "http", "https", "unsv", "itpc", "icyx" )
     set_callbacks( Open, Close )
@@ -165,6 +177,8 @@ struct access_sys_t
     char       *psz_mime;
     char       *psz_pragma;
     char       *psz_location;
+    char       *psz_etag;           /* strong only */
+    char       *psz_last_modified;
     bool b_mms;
     bool b_icecast;
     bool b_ssl;
@@ -196,6 +210,9 @@ struct access_sys_t
     bool b_has_size;
 
     vlc_array_t * cookies;
+
+    /* Range requests, once the server has proved to support them */
+    http_range_t *p_range;
 };
 
 /* */
@@ -212,6 +229,7 @@ static int Control( access_t *, int, va_list );
 static int Connect( access_t *, uint64_t );
 static int Request( access_t *p_access, uint64_t i_tell );
 static void Disconnect( access_t * );
+static void RangeStart( access_t * );
 
 /* Small Cookie utilities. Cookies support is partial. */
 static char * cookie_get_content( const char * cookie );
@@ -269,6 +287,8 @@ static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
     p_sys->b_mms = false;
     p_sys->b_icecast = false;
     p_sys->psz_location = NULL;
+    p_sys->psz_etag = NULL;
+    p_sys->psz_last_modified = NULL;
     p_sys->psz_user_agent = NULL;
     p_sys->psz_referrer = NULL;
     p_sys->b_pace_control = true;
@@ -293,6 +313,7 @@ static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
     p_sys->i_remaining = 0;
     p_sys->b_persist = false;
     p_sys->b_has_size = false;
+    p_sys->p_range = NULL;
     p_access->info.i_size = 0;
     p_access->info.i_pos  = 0;
     p_access->info.b_eof  = false;
@@ -577,6 +598,8 @@ connect:
         free( p_sys->psz_mime );
         free( p_sys->psz_pragma );
         free( p_sys->psz_location );
+        free( p_sys->psz_etag );
+        free( p_sys->psz_last_modified );
         free( p_sys->psz_user_agent );
         free( p_sys->psz_referrer );
 
@@ -660,6 +683,8 @@ connect:
 
     if( p_sys->b_reconnect ) msg_Dbg( p_access, "auto re-connect enabled" );
 
+    RangeStart( p_access );
+
     /* PTS delay */
     var_Create( p_access, "http-caching", VLC_VAR_INTEGER |VLC_VAR_DOINHERIT );
 
@@ -672,6 +697,8 @@ error:
     free( p_sys->psz_mime );
     free( p_sys->psz_pragma );
     free( p_sys->psz_location );
+    free( p_sys->psz_etag );
+    free( p_sys->psz_last_modified );
     free( p_sys->psz_user_agent );
     free( p_sys->psz_referrer );
 
@@ -708,6 +735,8 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->psz_mime );
     free( p_sys->psz_pragma );
     free( p_sys->psz_location );
+    free( p_sys->psz_etag );
+    free( p_sys->psz_last_modified );
 
     free( p_sys->psz_icy_name );
     free( p_sys->psz_icy_genre );
@@ -716,6 +745,8 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->psz_user_agent );
     free( p_sys->psz_referrer );
 
+    if( p_sys->p_range )
+        http_range_Delete( p_sys->p_range );
     Disconnect( p_access );
 
     if( p_sys->cookies )
@@ -739,11 +770,15 @@ static void Close( vlc_object_t *p_this )
  * p_buffer. Return the actual number of bytes read
  *****************************************************************************/
 static int ReadICYMeta( access_t *p_access );
+static ssize_t ReadRange( access_t *p_access, uint8_t *p_buffer, size_t i_len );
 static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
 {
     access_sys_t *p_sys = p_access->p_sys;
     int i_read;
 
+    if( p_sys->p_range )
+        return ReadRange( p_access, p_buffer, i_len );
+
     if( p_sys->fd == -1 )
         goto fatal;
 
@@ -877,6 +912,35 @@ fatal:
     return 0;
 }
 
+static ssize_t ReadRange( access_t *p_access, uint8_t *p_buffer, size_t i_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    const uint64_t i_pos = p_access->info.i_pos;
+
+    ssize_t i_read = http_range_Read( p_sys->p_range, i_pos, p_buffer, i_len );
+    if( i_read > 0 )
+    {
+        p_access->info.i_pos += i_read;
+        return i_read;
+    }
+    if( i_read == 0 )
+    {
+        p_access->info.b_eof = true;
+        return 0;
+    }
+
+    /* Back to a single request */
+    msg_Warn( p_access, "range requests failed, reading sequentially" );
+    http_range_Delete( p_sys->p_range );
+    p_sys->p_range = NULL;
+    if( Connect( p_access, i_pos ) )
+    {
+        p_access->info.b_eof = true;
+        return 0;
+    }
+    return Read( p_access, p_buffer, i_len );
+}
+
 static int ReadICYMeta( access_t *p_access )
 {
     access_sys_t *p_sys = p_access->p_sys;
@@ -988,8 +1052,19 @@ static ssize_t ReadCompressed( access_t *p_access, uint8_t *p_buffer,
  *****************************************************************************/
 static int Seek( access_t *p_access, uint64_t i_pos )
 {
+    access_sys_t *p_sys = p_access->p_sys;
+
     msg_Dbg( p_access, "trying to seek to %"PRId64, i_pos );
 
+    if( p_sys->p_range )
+    {
+        /* No new connection, the chunks are fetched from there */
+        p_access->info.i_pos = __MIN( i_pos, p_access->info.i_size );
+        p_access->info.b_eof = false;
+        http_range_Seek( p_sys->p_range, p_access->info.i_pos );
+        return VLC_SUCCESS;
+    }
+
     Disconnect( p_access );
 
     if( p_access->info.i_size
@@ -1031,7 +1106,7 @@ static int Control( access_t *p_access, int i_query, va_list args )
             break;
         case ACCESS_CAN_FASTSEEK:
             pb_bool = (bool*)va_arg( args, bool* );
-            *pb_bool = false;
+            *pb_bool = p_sys->p_range != NULL;
             break;
         case ACCESS_CAN_PAUSE:
         case ACCESS_CAN_CONTROL_PACE:
@@ -1096,6 +1171,8 @@ static int Connect( access_t *p_access, uint64_t i_tell )
     free( p_sys->psz_location );
     free( p_sys->psz_mime );
     free( p_sys->psz_pragma );
+    free( p_sys->psz_etag );
+    free( p_sys->psz_last_modified );
 
     free( p_sys->psz_icy_genre );
     free( p_sys->psz_icy_name );
@@ -1105,6 +1182,8 @@ static int Connect( access_t *p_access, uint64_t i_tell )
     p_sys->psz_location = NULL;
     p_sys->psz_mime = NULL;
     p_sys->psz_pragma = NULL;
+    p_sys->psz_etag = NULL;
+    p_sys->psz_last_modified = NULL;
     p_sys->b_mms = false;
     p_sys->b_chunked = false;
     p_sys->i_chunk = 0;
@@ -1473,6 +1552,17 @@ static int Request( access_t *p_access, uint64_t i_tell )
             p_sys->psz_mime = strdup( p );
             msg_Dbg( p_access, "Content-Type: %s", p_sys->psz_mime );
         }
+        else if( !strcasecmp( psz, "ETag" ) )
+        {
+            /* A weak one does not guarantee identical bytes */
+            free( p_sys->psz_etag );
+            p_sys->psz_etag = strncmp( p, "W/", 2 ) ? strdup( p ) : NULL;
+        }
+        else if( !strcasecmp( psz, "Last-Modified" ) )
+        {
+            free( p_sys->psz_last_modified );
+            p_sys->psz_last_modified = strdup( p );
+        }
         else if( !strcasecmp( psz, "Content-Encoding" ) )
         {
             msg_Dbg( p_access, "Content-Encoding: %s", p );
@@ -1612,6 +1702,92 @@ error:
     return VLC_EGENERIC;
 }
 
+/*****************************************************************************
+ * RangeStart: switch to range requests over parallel connections
+ *****************************************************************************/
+static void RangeStart( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    /* Only plain seekable files, the per request authentication and the
+     * stream transformations are left to the sequential reader */
+    if( p_sys->i_code != 206 || !p_sys->b_has_size || !p_sys->b_seekable ||
+        p_sys->b_chunked || p_sys->b_continuous || p_sys->i_icy_meta > 0 ||
+        p_sys->b_icecast || p_sys->i_version != 1 ||
+        p_sys->url.psz_username || p_sys->url.psz_password ||
+        p_sys->proxy.psz_username || p_sys->proxy.psz_password )
+        return;
+#ifdef HAVE_ZLIB_H
+    if( p_sys->b_compressed )
+        return;
+#endif
+
+    /* The headers sent by Request(), besides the range */
+    char *psz_headers;
+    if( asprintf( &psz_headers, "User-Agent: %s\r\n", p_sys->psz_user_agent ) < 0 )
+        return;
+    if( p_sys->psz_referrer )
+    {
+        char *psz;
+        if( asprintf( &psz, "%sReferer: %s\r\n", psz_headers, p_sys->psz_referrer ) < 0 )
+            psz = NULL;
+        free( psz_headers );
+        psz_headers = psz;
+    }
+    for( int i = 0; psz_headers && p_sys->cookies &&
+                    i < vlc_array_count( p_sys->cookies ); i++ )
+    {
+        const char *cookie = vlc_array_item_at_index( p_sys->cookies, i );
+        char *psz_cookie_content = cookie_get_content( cookie );
+        char *psz_cookie_domain = cookie_get_domain( cookie );
+        char *psz = psz_headers;
+
+        if( psz_cookie_content &&
+            ( !psz_cookie_domain || strstr( p_sys->url.psz_host, psz_cookie_domain ) ) )
+        {
+            if( asprintf( &psz, "%sCookie: %s\r\n", psz_headers, psz_cookie_content ) < 0 )
+                psz = NULL;
+            free( psz_headers );
+        }
+        psz_headers = psz;
+        free( psz_cookie_content );
+        free( psz_cookie_domain );
+    }
+
+    /* The file must not change under the chunks already fetched: a changed
+     * file is answered with a 200, which stops the range engine */
+    const char *psz_validator = p_sys->psz_etag ? p_sys->psz_etag
+                                                : p_sys->psz_last_modified;
+    http_cache_t *p_cache = NULL;
+    if( psz_headers && psz_validator )
+    {
+        char *psz;
+        if( asprintf( &psz, "%sIf-Range: %s\r\n", psz_headers, psz_validator ) < 0 )
+            psz = NULL;
+        free( psz_headers );
+        psz_headers = psz;
+
+        p_cache = http_cache_New( p_access, p_access->psz_location,
+                                  psz_validator, p_access->info.i_size );
+    }
+    if( !psz_headers )
+    {
+        if( p_cache )
+            http_cache_Delete( p_cache );
+        return;
+    }
+
+    p_sys->p_range = http_range_New( p_access, &p_sys->url,
+                                     p_sys->b_proxy ? &p_sys->proxy : NULL,
+                                     p_sys->b_ssl, psz_headers,
+                                     p_access->info.i_size, p_cache );
+    free( psz_headers );
+
+    /* The chunks are fetched by the range engine from now on */
+    if( p_sys->p_range )
+        Disconnect( p_access );
+}
+
 /*****************************************************************************
  * Disconnect:
  *****************************************************************************/
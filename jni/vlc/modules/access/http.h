@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * http.h: HTTP input module internals
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_ACCESS_HTTP_H
+#define VLC_ACCESS_HTTP_H 1
+
+#define CONNECTIONS_TEXT N_("Parallel connections")
+#define CONNECTIONS_LONGTEXT N_( \
+    "Number of connections used to fetch seekable files with range " \
+    "requests. The fetched ranges are kept in memory, so that seeking " \
+    "back into them does not fetch them again. 0 reads the file through " \
+    "a single sequential request." )
+
+#define READAHEAD_TEXT N_("Read-ahead (seconds)")
+#define READAHEAD_LONGTEXT N_( \
+    "Media duration fetched ahead of the playback position, at the " \
+    "measured bitrate. It is halved on a network much faster than the " \
+    "media and doubled on a network barely fast enough." )
+
+#define RANGE_CACHE_TEXT N_("Range cache size (MiB)")
+#define RANGE_CACHE_LONGTEXT N_( \
+    "Memory used to keep the fetched ranges of a file." )
+
+#define CACHE_DIR_TEXT N_("Disk cache directory")
+#define CACHE_DIR_LONGTEXT N_( \
+    "Directory where the fetched ranges of seekable files are kept across " \
+    "sessions, so that playing them again only fetches the missing ranges. " \
+    "Leave empty to disable the disk cache." )
+
+#define CACHE_SIZE_TEXT N_("Disk cache size (MiB)")
+#define CACHE_SIZE_LONGTEXT N_( \
+    "Disk space used by the cache. The least recently played files are " \
+    "removed first." )
+
+/* Unit of the range requests and of the caches */
+#define HTTP_CHUNK_SIZE (256 * 1024)
+
+/* Disk cache: the chunks of a file are kept in a sparse file, keyed by the
+ * URL and invalidated when the validator (ETag or Last-Modified) changes */
+typedef struct http_cache_t http_cache_t;
+
+http_cache_t *http_cache_New( access_t *, const char *psz_url,
+                              const char *psz_validator, uint64_t i_size );
+void http_cache_Delete( http_cache_t * );
+
+bool http_cache_Has( http_cache_t *, int i_chunk );
+/* It fails if the chunk vanished, which is then forgotten */
+int  http_cache_Read( http_cache_t *, uint64_t i_pos, uint8_t *, size_t );
+void http_cache_Store( http_cache_t *, int i_chunk, const uint8_t *, size_t );
+
+/* Range engine: the file is fetched in chunks by range requests over a
+ * few persistent connections, and the chunks are kept in a sparse cache.
+ * It owns the disk cache, if any. */
+typedef struct http_range_t http_range_t;
+
+http_range_t *http_range_New( access_t *, const vlc_url_t *p_url,
+                              const vlc_url_t *p_proxy, bool b_ssl,
+                              const char *psz_headers, uint64_t i_size,
+                              http_cache_t *p_cache );
+void http_range_Delete( http_range_t * );
+
+/* It returns the bytes read, 0 at the end of the file or when the access
+ * is killed, and -1 when the server cannot serve ranges anymore */
+ssize_t http_range_Read( http_range_t *, uint64_t i_pos, uint8_t *, size_t );
+
+/* The data at i_pos will be read next */
+void http_range_Seek( http_range_t *, uint64_t i_pos );
+
+#endif
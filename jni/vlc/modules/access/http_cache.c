@@ -0,0 +1,437 @@
+/*****************************************************************************
+ * http_cache.c: HTTP persistent cache of the fetched ranges
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_access.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include "http.h"
+
+/* Each cached file is a sparse data file, with the chunks at their offset
+ * in the source, and an index. The index holds, in host byte order:
+ *  - the magic,
+ *  - the validator of the source (strong ETag or Last-Modified),
+ *  - the source size, the chunk size and the chunk count,
+ *  - a bitmap of the chunks present in the data file.
+ * The index modification date is the last use of the entry. */
+#define CACHE_MAGIC         "VLCHTC01"
+#define CACHE_INDEX_EXT     ".idx"
+#define CACHE_DATA_EXT      ".data"
+#define CACHE_VALIDATOR_MAX 1024
+/* Chunks stored between two index updates */
+#define CACHE_SYNC_CHUNKS   16
+
+struct http_cache_t
+{
+    access_t *p_access;
+
+    char     *psz_dir;
+    char     *psz_hash;
+    char     *psz_validator;
+    uint64_t  i_size;
+    int       i_chunk;
+    int       fd;
+
+    vlc_mutex_t lock;
+    uint8_t  *p_bitmap;
+    uint64_t  i_stored;
+    uint64_t  i_max;
+    int       i_dirty;
+};
+
+/*****************************************************************************
+ * Index
+ *****************************************************************************/
+static char *CachePath( const char *psz_dir, const char *psz_hash,
+                        const char *psz_ext )
+{
+    char *psz_path;
+    if( asprintf( &psz_path, "%s"DIR_SEP"%s%s", psz_dir, psz_hash, psz_ext ) < 0 )
+        return NULL;
+    return psz_path;
+}
+
+static size_t BitmapSize( int i_chunk )
+{
+    return ( i_chunk + 7 ) / 8;
+}
+
+static bool BitmapHas( const uint8_t *p_bitmap, int i )
+{
+    return p_bitmap[i / 8] & ( 1 << ( i % 8 ) );
+}
+
+static size_t ChunkSize( const http_cache_t *p_cache, int i_chunk )
+{
+    const uint64_t i_start = (uint64_t)i_chunk * HTTP_CHUNK_SIZE;
+    return __MIN( p_cache->i_size - i_start, HTTP_CHUNK_SIZE );
+}
+
+/* Load the bitmap of a matching index, any difference invalidates it */
+static int IndexLoad( http_cache_t *p_cache )
+{
+    char *psz_path = CachePath( p_cache->psz_dir, p_cache->psz_hash, CACHE_INDEX_EXT );
+    if( !psz_path )
+        return VLC_ENOMEM;
+    FILE *p_file = vlc_fopen( psz_path, "rb" );
+    free( psz_path );
+    if( !p_file )
+        return VLC_EGENERIC;
+
+    char psz_magic[sizeof(CACHE_MAGIC) - 1];
+    char psz_validator[CACHE_VALIDATOR_MAX];
+    int32_t i_validator, i_chunk_size, i_chunk;
+    int64_t i_size;
+    int i_ret = VLC_EGENERIC;
+
+    if( fread( psz_magic, sizeof(psz_magic), 1, p_file ) != 1 ||
+        memcmp( psz_magic, CACHE_MAGIC, sizeof(psz_magic) ) ||
+        fread( &i_validator, sizeof(i_validator), 1, p_file ) != 1 ||
+        i_validator <= 0 || i_validator >= CACHE_VALIDATOR_MAX ||
+        fread( psz_validator, i_validator, 1, p_file ) != 1 ||
+        fread( &i_size, sizeof(i_size), 1, p_file ) != 1 ||
+        fread( &i_chunk_size, sizeof(i_chunk_size), 1, p_file ) != 1 ||
+        fread( &i_chunk, sizeof(i_chunk), 1, p_file ) != 1 )
+        goto exit;
+    psz_validator[i_validator] = '\0';
+
+    if( strcmp( psz_validator, p_cache->psz_validator ) ||
+        (uint64_t)i_size != p_cache->i_size ||
+        i_chunk_size != HTTP_CHUNK_SIZE || i_chunk != p_cache->i_chunk ||
+        fread( p_cache->p_bitmap, BitmapSize( i_chunk ), 1, p_file ) != 1 )
+        goto exit;
+
+    for( int i = 0; i < i_chunk; i++ )
+    {
+        if( BitmapHas( p_cache->p_bitmap, i ) )
+            p_cache->i_stored += ChunkSize( p_cache, i );
+    }
+    i_ret = VLC_SUCCESS;
+
+exit:
+    if( i_ret )
+        memset( p_cache->p_bitmap, 0, BitmapSize( p_cache->i_chunk ) );
+    fclose( p_file );
+    return i_ret;
+}
+
+static int FileSync( int fd )
+{
+#if defined(__APPLE__) || defined(__ANDROID__)
+    return fsync( fd );
+#else
+    return fdatasync( fd );
+#endif
+}
+
+/* Written aside and renamed, so that a crash leaves the previous index.
+ * The chunks it lists are flushed first: after a crash, a sparse file
+ * would read back zeros for the ones that never reached the disk.
+ * Called with the lock held. */
+static void IndexStore( http_cache_t *p_cache )
+{
+    if( FileSync( p_cache->fd ) )
+    {
+        msg_Warn( p_cache->p_access, "cannot flush the cache data (%m)" );
+        return;
+    }
+
+    char *psz_path = CachePath( p_cache->psz_dir, p_cache->psz_hash, CACHE_INDEX_EXT );
+    char *psz_tmp = CachePath( p_cache->psz_dir, p_cache->psz_hash, ".tmp" );
+    FILE *p_file = psz_tmp ? vlc_fopen( psz_tmp, "wb" ) : NULL;
+
+    if( p_file )
+    {
+        const int32_t i_validator = strlen( p_cache->psz_validator );
+        const int64_t i_size = p_cache->i_size;
+        const int32_t i_chunk_size = HTTP_CHUNK_SIZE;
+        const int32_t i_chunk = p_cache->i_chunk;
+
+        fwrite( CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1, 1, p_file );
+        fwrite( &i_validator, sizeof(i_validator), 1, p_file );
+        fwrite( p_cache->psz_validator, i_validator, 1, p_file );
+        fwrite( &i_size, sizeof(i_size), 1, p_file );
+        fwrite( &i_chunk_size, sizeof(i_chunk_size), 1, p_file );
+        fwrite( &i_chunk, sizeof(i_chunk), 1, p_file );
+        fwrite( p_cache->p_bitmap, BitmapSize( i_chunk ), 1, p_file );
+
+        const bool b_error = fflush( p_file ) || ferror( p_file ) ||
+                             FileSync( fileno( p_file ) );
+        if( fclose( p_file ) || b_error || !psz_path ||
+            vlc_rename( psz_tmp, psz_path ) )
+        {
+            msg_Warn( p_cache->p_access, "cannot write the cache index" );
+            vlc_unlink( psz_tmp );
+        }
+    }
+    p_cache->i_dirty = 0;
+    free( psz_tmp );
+    free( psz_path );
+}
+
+/*****************************************************************************
+ * Eviction
+ *****************************************************************************/
+typedef struct
+{
+    char    *psz_hash;
+    time_t   i_used;
+    uint64_t i_bytes;
+} cache_entry_t;
+
+static int EntryCompare( const void *a, const void *b )
+{
+    const cache_entry_t *p_a = a, *p_b = b;
+    return ( p_a->i_used > p_b->i_used ) - ( p_a->i_used < p_b->i_used );
+}
+
+static void EntryRemove( const char *psz_dir, const char *psz_hash )
+{
+    char *psz_path = CachePath( psz_dir, psz_hash, CACHE_INDEX_EXT );
+    if( psz_path )
+        vlc_unlink( psz_path );
+    free( psz_path );
+    psz_path = CachePath( psz_dir, psz_hash, CACHE_DATA_EXT );
+    if( psz_path )
+        vlc_unlink( psz_path );
+    free( psz_path );
+}
+
+/* Remove the least recently used other entries until the whole cache
+ * fits in its budget */
+static void CacheTrim( http_cache_t *p_cache )
+{
+    DIR *p_dir = vlc_opendir( p_cache->psz_dir );
+    if( !p_dir )
+        return;
+
+    cache_entry_t *p_entry = NULL;
+    int i_entry = 0;
+    uint64_t i_total = p_cache->i_stored;
+    char *psz_name;
+
+    while( ( psz_name = vlc_readdir( p_dir ) ) != NULL )
+    {
+        const size_t i_name = strlen( psz_name );
+        const size_t i_ext = strlen( CACHE_INDEX_EXT );
+        struct stat st_index, st_data;
+
+        if( i_name <= i_ext || strcmp( &psz_name[i_name - i_ext], CACHE_INDEX_EXT ) )
+        {
+            free( psz_name );
+            continue;
+        }
+        psz_name[i_name - i_ext] = '\0';
+
+        char *psz_index = CachePath( p_cache->psz_dir, psz_name, CACHE_INDEX_EXT );
+        char *psz_data = CachePath( p_cache->psz_dir, psz_name, CACHE_DATA_EXT );
+        if( strcmp( psz_name, p_cache->psz_hash ) && psz_index && psz_data &&
+            !vlc_stat( psz_index, &st_index ) )
+        {
+            cache_entry_t *p_new = realloc( p_entry, ( i_entry + 1 ) * sizeof(*p_entry) );
+            if( p_new )
+            {
+                p_entry = p_new;
+                p_entry[i_entry].psz_hash = psz_name;
+                p_entry[i_entry].i_used = st_index.st_mtime;
+                /* The data files are sparse */
+                p_entry[i_entry].i_bytes = vlc_stat( psz_data, &st_data ) ? 0 :
+                                           (uint64_t)st_data.st_blocks * 512;
+                i_total += p_entry[i_entry].i_bytes;
+                i_entry++;
+                psz_name = NULL;
+            }
+        }
+        free( psz_index );
+        free( psz_data );
+        free( psz_name );
+    }
+    closedir( p_dir );
+
+    if( i_entry > 0 )
+        qsort( p_entry, i_entry, sizeof(*p_entry), EntryCompare );
+    for( int i = 0; i < i_entry; i++ )
+    {
+        if( i_total > p_cache->i_max )
+        {
+            msg_Dbg( p_cache->p_access, "evicting cache entry %s", p_entry[i].psz_hash );
+            EntryRemove( p_cache->psz_dir, p_entry[i].psz_hash );
+            i_total -= __MIN( i_total, p_entry[i].i_bytes );
+        }
+        free( p_entry[i].psz_hash );
+    }
+    free( p_entry );
+}
+
+/*****************************************************************************
+ * Cache
+ *****************************************************************************/
+http_cache_t *http_cache_New( access_t *p_access, const char *psz_url,
+                              const char *psz_validator, uint64_t i_size )
+{
+    if( !psz_validator || !*psz_validator ||
+        strlen( psz_validator ) >= CACHE_VALIDATOR_MAX || i_size == 0 )
+        return NULL;
+
+    const int64_t i_max = var_InheritInteger( p_access, "http-cache-size" );
+    char *psz_dir = var_InheritString( p_access, "http-cache-dir" );
+    if( i_max <= 0 || !psz_dir || !*psz_dir )
+    {
+        free( psz_dir );
+        return NULL;
+    }
+    if( vlc_mkdir( psz_dir, 0700 ) && errno != EEXIST )
+    {
+        msg_Warn( p_access, "cannot create %s (%m)", psz_dir );
+        free( psz_dir );
+        return NULL;
+    }
+
+    http_cache_t *p_cache = calloc( 1, sizeof(*p_cache) );
+    if( !p_cache )
+    {
+        free( psz_dir );
+        return NULL;
+    }
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_url, strlen( psz_url ) );
+    EndMD5( &md5 );
+
+    p_cache->p_access = p_access;
+    p_cache->psz_dir = psz_dir;
+    p_cache->psz_hash = psz_md5_hash( &md5 );
+    p_cache->psz_validator = strdup( psz_validator );
+    p_cache->i_size = i_size;
+    p_cache->i_chunk = ( i_size + HTTP_CHUNK_SIZE - 1 ) / HTTP_CHUNK_SIZE;
+    p_cache->i_max = (uint64_t)i_max * 1024 * 1024;
+    p_cache->fd = -1;
+    p_cache->p_bitmap = calloc( 1, BitmapSize( p_cache->i_chunk ) );
+    vlc_mutex_init( &p_cache->lock );
+
+    char *psz_data = p_cache->psz_hash ?
+                     CachePath( psz_dir, p_cache->psz_hash, CACHE_DATA_EXT ) : NULL;
+    if( !psz_data || !p_cache->psz_validator || !p_cache->p_bitmap )
+    {
+        free( psz_data );
+        http_cache_Delete( p_cache );
+        return NULL;
+    }
+
+    /* A changed source invalidates all of its data */
+    if( IndexLoad( p_cache ) )
+        vlc_unlink( psz_data );
+    p_cache->fd = vlc_open( psz_data, O_RDWR | O_CREAT, 0600 );
+    free( psz_data );
+    if( p_cache->fd == -1 )
+    {
+        msg_Warn( p_access, "cannot open the cache data (%m)" );
+        http_cache_Delete( p_cache );
+        return NULL;
+    }
+
+    /* Mark the entry as used and make room for it */
+    IndexStore( p_cache );
+    CacheTrim( p_cache );
+
+    msg_Dbg( p_access, "cache entry %s holds %"PRIu64" of %"PRIu64" bytes",
+             p_cache->psz_hash, p_cache->i_stored, i_size );
+    return p_cache;
+}
+
+void http_cache_Delete( http_cache_t *p_cache )
+{
+    if( p_cache->fd != -1 )
+    {
+        if( p_cache->i_dirty > 0 )
+            IndexStore( p_cache );
+        close( p_cache->fd );
+        CacheTrim( p_cache );
+    }
+    vlc_mutex_destroy( &p_cache->lock );
+    free( p_cache->p_bitmap );
+    free( p_cache->psz_validator );
+    free( p_cache->psz_hash );
+    free( p_cache->psz_dir );
+    free( p_cache );
+}
+
+bool http_cache_Has( http_cache_t *p_cache, int i_chunk )
+{
+    vlc_mutex_lock( &p_cache->lock );
+    const bool b_has = BitmapHas( p_cache->p_bitmap, i_chunk );
+    vlc_mutex_unlock( &p_cache->lock );
+    return b_has;
+}
+
+int http_cache_Read( http_cache_t *p_cache, uint64_t i_pos,
+                     uint8_t *p_buffer, size_t i_len )
+{
+    if( pread( p_cache->fd, p_buffer, i_len, i_pos ) == (ssize_t)i_len )
+        return VLC_SUCCESS;
+
+    /* Truncated or removed behind our back, the chunk will be fetched */
+    const int i_chunk = i_pos / HTTP_CHUNK_SIZE;
+    vlc_mutex_lock( &p_cache->lock );
+    if( BitmapHas( p_cache->p_bitmap, i_chunk ) )
+    {
+        p_cache->p_bitmap[i_chunk / 8] &= ~( 1 << ( i_chunk % 8 ) );
+        p_cache->i_stored -= ChunkSize( p_cache, i_chunk );
+        p_cache->i_dirty++;
+    }
+    vlc_mutex_unlock( &p_cache->lock );
+    return VLC_EGENERIC;
+}
+
+void http_cache_Store( http_cache_t *p_cache, int i_chunk,
+                       const uint8_t *p_data, size_t i_data )
+{
+    vlc_mutex_lock( &p_cache->lock );
+    const bool b_skip = BitmapHas( p_cache->p_bitmap, i_chunk ) ||
+                        p_cache->i_stored + i_data > p_cache->i_max;
+    vlc_mutex_unlock( &p_cache->lock );
+    if( b_skip )
+        return;
+
+    if( pwrite( p_cache->fd, p_data, i_data,
+                (uint64_t)i_chunk * HTTP_CHUNK_SIZE ) != (ssize_t)i_data )
+        return;
+
+    vlc_mutex_lock( &p_cache->lock );
+    p_cache->p_bitmap[i_chunk / 8] |= 1 << ( i_chunk % 8 );
+    p_cache->i_stored += i_data;
+    if( ++p_cache->i_dirty >= CACHE_SYNC_CHUNKS )
+        IndexStore( p_cache );
+    vlc_mutex_unlock( &p_cache->lock );
+}
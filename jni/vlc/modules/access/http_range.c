@@ -0,0 +1,614 @@
+/*****************************************************************************
+ * http_range.c: HTTP parallel range requests and sparse cache
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_access.h>
+#include <vlc_network.h>
+#include <vlc_url.h>
+#include <vlc_tls.h>
+
+#include "http.h"
+
+/* Beyond that, the chunk table itself would be too large */
+#define CHUNK_COUNT_MAX     (1 << 20)
+/* Minimum read-ahead, when the bitrate is still unknown */
+#define CHUNK_AHEAD_MIN     4
+
+/* Consecutive failed requests before giving up */
+#define FAILURES_MAX        8
+#define RETRY_DELAY         (CLOCK_FREQ / 2)
+
+enum
+{
+    CHUNK_EMPTY,
+    CHUNK_PENDING,
+    CHUNK_DONE,
+};
+
+typedef struct
+{
+    uint8_t *p_data;
+    int      i_state;
+    mtime_t  i_used;        /* last read or download, for the eviction */
+} http_chunk_t;
+
+typedef struct
+{
+    http_range_t *p_range;
+    vlc_thread_t  thread;
+
+    /* Owned by the thread, released by http_range_Delete() */
+    int           fd;
+    vlc_tls_t    *p_tls;
+    v_socket_t   *p_vs;
+    uint8_t      *p_buffer;
+} http_worker_t;
+
+struct http_range_t
+{
+    access_t     *p_access;
+
+    /* Requests */
+    char         *psz_host;         /* to connect to */
+    int           i_port;
+    bool          b_ssl;
+    char         *psz_tls_host;
+    char         *psz_request;      /* request line and fixed headers */
+    uint64_t      i_size;
+
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;             /* a chunk was fetched */
+    vlc_cond_t    work;             /* a chunk may need to be fetched */
+
+    http_chunk_t *p_chunk;
+    int           i_chunk;
+    size_t        i_cached;
+    size_t        i_cache_max;
+
+    /* Read-ahead */
+    int           i_read_chunk;     /* playback position */
+    int           i_readahead;      /* seconds */
+    uint64_t      i_read_bytes;
+    mtime_t       i_read_date;
+    int64_t       i_read_rate;      /* bytes per second */
+    int64_t       i_net_rate;       /* bytes per second per connection */
+
+    int           i_failures;
+    bool          b_error;
+
+    int           i_worker;
+    http_worker_t *p_worker;
+
+    http_cache_t *p_cache;          /* chunks kept on disk, may be NULL */
+};
+
+/*****************************************************************************
+ * Chunks
+ *****************************************************************************/
+static size_t ChunkSize( const http_range_t *p_range, int i_chunk )
+{
+    const uint64_t i_start = (uint64_t)i_chunk * HTTP_CHUNK_SIZE;
+    return __MIN( p_range->i_size - i_start, HTTP_CHUNK_SIZE );
+}
+
+/* Number of chunks to keep ahead of the playback position, from the media
+ * bitrate and the speed of the connections */
+static int ChunkWindow( const http_range_t *p_range )
+{
+    const int64_t i_read = p_range->i_read_rate;
+    const int64_t i_net = p_range->i_net_rate * p_range->i_worker;
+    int64_t i_seconds = p_range->i_readahead;
+
+    if( i_read <= 0 )
+        return CHUNK_AHEAD_MIN;
+    if( i_net > 4 * i_read )
+        i_seconds /= 2;
+    else if( 2 * i_net < 3 * i_read )
+        i_seconds *= 2;
+
+    int64_t i_window = i_read * i_seconds / HTTP_CHUNK_SIZE + 1;
+    i_window = __MAX( i_window, CHUNK_AHEAD_MIN );
+    i_window = __MIN( i_window, (int64_t)( p_range->i_cache_max / 2 / HTTP_CHUNK_SIZE ) );
+    return __MAX( i_window, 1 );
+}
+
+/* The next chunk to fetch, from the playback position onward, the chunks
+ * of the disk cache are read from it instead */
+static int ChunkPick( http_range_t *p_range )
+{
+    if( p_range->b_error )
+        return -1;
+
+    const int i_end = __MIN( p_range->i_chunk,
+                             p_range->i_read_chunk + ChunkWindow( p_range ) );
+    for( int i = p_range->i_read_chunk; i < i_end; i++ )
+    {
+        if( p_range->p_chunk[i].i_state == CHUNK_EMPTY &&
+            ( !p_range->p_cache || !http_cache_Has( p_range->p_cache, i ) ) )
+            return i;
+    }
+    return -1;
+}
+
+/* Free the least recently used chunks outside of the read-ahead window
+ * until the cache fits its budget */
+static void ChunkEvict( http_range_t *p_range )
+{
+    const int i_first = p_range->i_read_chunk;
+    const int i_last = i_first + ChunkWindow( p_range );
+
+    while( p_range->i_cached > p_range->i_cache_max )
+    {
+        int i_victim = -1;
+        for( int i = 0; i < p_range->i_chunk; i++ )
+        {
+            const http_chunk_t *c = &p_range->p_chunk[i];
+            if( c->i_state != CHUNK_DONE || ( i >= i_first && i < i_last ) )
+                continue;
+            if( i_victim < 0 || c->i_used < p_range->p_chunk[i_victim].i_used )
+                i_victim = i;
+        }
+        if( i_victim < 0 )
+            break;
+
+        http_chunk_t *c = &p_range->p_chunk[i_victim];
+        free( c->p_data );
+        c->p_data = NULL;
+        c->i_state = CHUNK_EMPTY;
+        p_range->i_cached -= ChunkSize( p_range, i_victim );
+    }
+}
+
+/*****************************************************************************
+ * Connections
+ *****************************************************************************/
+static void WorkerDisconnect( http_worker_t *p_worker )
+{
+    if( p_worker->p_tls )
+    {
+        vlc_tls_ClientDelete( p_worker->p_tls );
+        p_worker->p_tls = NULL;
+        p_worker->p_vs = NULL;
+    }
+    if( p_worker->fd != -1 )
+    {
+        net_Close( p_worker->fd );
+        p_worker->fd = -1;
+    }
+}
+
+static int WorkerConnect( http_worker_t *p_worker )
+{
+    http_range_t *p_range = p_worker->p_range;
+    access_t *p_access = p_range->p_access;
+
+    p_worker->fd = net_ConnectTCP( p_access, p_range->psz_host, p_range->i_port );
+    if( p_worker->fd == -1 )
+        return VLC_EGENERIC;
+    setsockopt( p_worker->fd, SOL_SOCKET, SO_KEEPALIVE, &(int){ 1 }, sizeof (int) );
+
+    if( p_range->b_ssl )
+    {
+        p_worker->p_tls = vlc_tls_ClientCreate( VLC_OBJECT(p_access), p_worker->fd,
+                                                p_range->psz_tls_host );
+        if( !p_worker->p_tls )
+        {
+            WorkerDisconnect( p_worker );
+            return VLC_EGENERIC;
+        }
+        p_worker->p_vs = &p_worker->p_tls->sock;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Fetch one range over the worker connection, which is kept open when the
+ * server allows it. *pb_fatal is set when the server ignores the range. */
+static int WorkerRequest( http_worker_t *p_worker, uint64_t i_start,
+                          uint8_t *p_data, size_t i_data, bool *pb_fatal )
+{
+    http_range_t *p_range = p_worker->p_range;
+    access_t *p_access = p_range->p_access;
+    const int fd = p_worker->fd;
+    const v_socket_t *p_vs = p_worker->p_vs;
+
+    if( net_Printf( p_access, fd, p_vs,
+                    "%sRange: bytes=%"PRIu64"-%"PRIu64"\r\n\r\n",
+                    p_range->psz_request, i_start, i_start + i_data - 1 ) < 0 )
+        return VLC_EGENERIC;
+
+    char *psz = net_Gets( p_access, fd, p_vs );
+    if( !psz )
+        return VLC_EGENERIC;
+
+    int i_code = 0;
+    bool b_close = false;
+    if( !strncmp( psz, "HTTP/1.", 7 ) && strlen( psz ) >= 12 )
+    {
+        i_code = atoi( &psz[9] );
+        b_close = psz[7] == '0';
+    }
+    free( psz );
+
+    uint64_t i_length = UINT64_MAX;
+    uint64_t i_range = UINT64_MAX;
+    bool b_chunked = false;
+    for( ;; )
+    {
+        psz = net_Gets( p_access, fd, p_vs );
+        if( !psz )
+            return VLC_EGENERIC;
+        if( !*psz )
+        {
+            free( psz );
+            break;
+        }
+
+        char *p = strchr( psz, ':' );
+        if( p )
+        {
+            *p++ = '\0';
+            while( *p == ' ' )
+                p++;
+            if( !strcasecmp( psz, "Content-Length" ) )
+                i_length = strtoull( p, NULL, 10 );
+            else if( !strcasecmp( psz, "Content-Range" ) )
+                sscanf( p, "bytes %"SCNu64"-", &i_range );
+            else if( !strcasecmp( psz, "Connection" ) )
+                b_close = !strncasecmp( p, "close", 5 );
+            else if( !strcasecmp( psz, "Transfer-Encoding" ) )
+                b_chunked = !strncasecmp( p, "chunked", 7 );
+        }
+        free( psz );
+    }
+
+    if( i_code != 206 || i_range != i_start || i_length != i_data || b_chunked )
+    {
+        msg_Warn( p_access, "range %"PRIu64" refused (%d)", i_start, i_code );
+        *pb_fatal = i_code == 200;
+        return VLC_EGENERIC;
+    }
+
+    if( net_Read( p_access, fd, p_vs, p_data, i_data, true ) != (ssize_t)i_data )
+        return VLC_EGENERIC;
+
+    if( b_close )
+        WorkerDisconnect( p_worker );
+    return VLC_SUCCESS;
+}
+
+static int WorkerFetch( http_worker_t *p_worker, int i_chunk,
+                        uint8_t *p_data, size_t i_data, bool *pb_fatal )
+{
+    const uint64_t i_start = (uint64_t)i_chunk * HTTP_CHUNK_SIZE;
+
+    /* A kept open connection may have been closed by the server since,
+     * so a failure on it is retried once on a new connection */
+    const bool b_reused = p_worker->fd != -1;
+    for( int i_try = 0; i_try < ( b_reused ? 2 : 1 ); i_try++ )
+    {
+        if( p_worker->fd == -1 && WorkerConnect( p_worker ) )
+            return VLC_EGENERIC;
+        if( !WorkerRequest( p_worker, i_start, p_data, i_data, pb_fatal ) )
+            return VLC_SUCCESS;
+        WorkerDisconnect( p_worker );
+        if( *pb_fatal )
+            break;
+    }
+    return VLC_EGENERIC;
+}
+
+static void *WorkerThread( void *p_data )
+{
+    http_worker_t *p_worker = p_data;
+    http_range_t *p_range = p_worker->p_range;
+
+    for( ;; )
+    {
+        int i_chunk;
+
+        vlc_mutex_lock( &p_range->lock );
+        mutex_cleanup_push( &p_range->lock );
+        while( ( i_chunk = ChunkPick( p_range ) ) < 0 )
+            vlc_cond_wait( &p_range->work, &p_range->lock );
+        p_range->p_chunk[i_chunk].i_state = CHUNK_PENDING;
+        vlc_cleanup_pop();
+        vlc_mutex_unlock( &p_range->lock );
+
+        const size_t i_data = ChunkSize( p_range, i_chunk );
+        const mtime_t i_start = mdate();
+        bool b_fatal = false;
+        int i_ret = VLC_ENOMEM;
+
+        p_worker->p_buffer = malloc( i_data );
+        if( p_worker->p_buffer )
+            i_ret = WorkerFetch( p_worker, i_chunk, p_worker->p_buffer, i_data,
+                                 &b_fatal );
+        if( !i_ret && p_range->p_cache )
+        {
+            const int i_canc = vlc_savecancel();
+            http_cache_Store( p_range->p_cache, i_chunk, p_worker->p_buffer, i_data );
+            vlc_restorecancel( i_canc );
+        }
+
+        vlc_mutex_lock( &p_range->lock );
+        http_chunk_t *c = &p_range->p_chunk[i_chunk];
+        if( !i_ret )
+        {
+            const mtime_t i_duration = __MAX( mdate() - i_start, 1 );
+            const int64_t i_rate = i_data * CLOCK_FREQ / i_duration;
+
+            c->p_data = p_worker->p_buffer;
+            c->i_state = CHUNK_DONE;
+            c->i_used = mdate();
+            p_range->i_cached += i_data;
+            p_range->i_net_rate = p_range->i_net_rate > 0 ?
+                                  ( 3 * p_range->i_net_rate + i_rate ) / 4 : i_rate;
+            p_range->i_failures = 0;
+            ChunkEvict( p_range );
+        }
+        else
+        {
+            free( p_worker->p_buffer );
+            c->i_state = CHUNK_EMPTY;
+            if( b_fatal || ++p_range->i_failures >= FAILURES_MAX )
+                p_range->b_error = true;
+        }
+        p_worker->p_buffer = NULL;
+        vlc_cond_broadcast( &p_range->wait );
+        vlc_cond_broadcast( &p_range->work );
+        vlc_mutex_unlock( &p_range->lock );
+
+        if( i_ret )
+            msleep( RETRY_DELAY );
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * Engine
+ *****************************************************************************/
+http_range_t *http_range_New( access_t *p_access, const vlc_url_t *p_url,
+                              const vlc_url_t *p_proxy, bool b_ssl,
+                              const char *psz_headers, uint64_t i_size,
+                              http_cache_t *p_cache )
+{
+    const int i_worker = var_InheritInteger( p_access, "http-connections" );
+    const int64_t i_chunk = ( i_size + HTTP_CHUNK_SIZE - 1 ) / HTTP_CHUNK_SIZE;
+
+    /* HTTPS through a proxy would need a tunnel per connection */
+    if( i_worker <= 0 || i_size == 0 || i_chunk > CHUNK_COUNT_MAX ||
+        ( b_ssl && p_proxy ) )
+    {
+        if( p_cache )
+            http_cache_Delete( p_cache );
+        return NULL;
+    }
+
+    http_range_t *p_range = calloc( 1, sizeof(*p_range) );
+    if( !p_range )
+    {
+        if( p_cache )
+            http_cache_Delete( p_cache );
+        return NULL;
+    }
+
+    vlc_mutex_init( &p_range->lock );
+    vlc_cond_init( &p_range->wait );
+    vlc_cond_init( &p_range->work );
+    p_range->p_access = p_access;
+    p_range->p_cache = p_cache;
+    p_range->b_ssl = b_ssl;
+    p_range->i_size = i_size;
+    p_range->i_chunk = i_chunk;
+    p_range->i_cache_max = __MAX( var_InheritInteger( p_access, "http-range-cache" ), 1 )
+                           * 1024 * 1024;
+    p_range->i_readahead = __MAX( var_InheritInteger( p_access, "http-readahead" ), 1 );
+
+    const char *psz_path = p_url->psz_path && *p_url->psz_path ? p_url->psz_path : "/";
+    const int i_default_port = b_ssl ? 443 : 80;
+    char *psz_host;
+    if( p_url->i_port != i_default_port )
+    {
+        if( asprintf( &psz_host, "%s:%d", p_url->psz_host, p_url->i_port ) < 0 )
+            psz_host = NULL;
+    }
+    else
+        psz_host = strdup( p_url->psz_host );
+
+    int i_ret = -1;
+    if( psz_host )
+    {
+        if( p_proxy )
+            i_ret = asprintf( &p_range->psz_request,
+                              "GET http://%s%s HTTP/1.1\r\nHost: %s\r\n%s",
+                              psz_host, psz_path, psz_host, psz_headers );
+        else
+            i_ret = asprintf( &p_range->psz_request,
+                              "GET %s HTTP/1.1\r\nHost: %s\r\n%s",
+                              psz_path, psz_host, psz_headers );
+    }
+    free( psz_host );
+
+    const vlc_url_t *p_srv = p_proxy ? p_proxy : p_url;
+    p_range->psz_host = strdup( p_srv->psz_host );
+    p_range->i_port = p_srv->i_port;
+    p_range->psz_tls_host = strdup( p_url->psz_host );
+    p_range->p_chunk = calloc( i_chunk, sizeof(*p_range->p_chunk) );
+    p_range->p_worker = calloc( i_worker, sizeof(*p_range->p_worker) );
+    if( i_ret < 0 || !p_range->psz_host || !p_range->psz_tls_host ||
+        !p_range->p_chunk || !p_range->p_worker )
+    {
+        if( i_ret < 0 )
+            p_range->psz_request = NULL;
+        http_range_Delete( p_range );
+        return NULL;
+    }
+
+    p_range->i_read_date = mdate();
+
+    for( int i = 0; i < i_worker; i++ )
+    {
+        http_worker_t *p_worker = &p_range->p_worker[p_range->i_worker];
+
+        p_worker->p_range = p_range;
+        p_worker->fd = -1;
+        if( vlc_clone( &p_worker->thread, WorkerThread, p_worker,
+                       VLC_THREAD_PRIORITY_INPUT ) )
+            break;
+        p_range->i_worker++;
+    }
+    if( p_range->i_worker <= 0 )
+    {
+        http_range_Delete( p_range );
+        return NULL;
+    }
+
+    msg_Dbg( p_access, "fetching %"PRIu64" bytes over %d connections",
+             i_size, p_range->i_worker );
+    return p_range;
+}
+
+void http_range_Delete( http_range_t *p_range )
+{
+    for( int i = 0; i < p_range->i_worker; i++ )
+        vlc_cancel( p_range->p_worker[i].thread );
+    for( int i = 0; i < p_range->i_worker; i++ )
+    {
+        http_worker_t *p_worker = &p_range->p_worker[i];
+
+        vlc_join( p_worker->thread, NULL );
+        WorkerDisconnect( p_worker );
+        free( p_worker->p_buffer );
+    }
+    vlc_cond_destroy( &p_range->work );
+    vlc_cond_destroy( &p_range->wait );
+    vlc_mutex_destroy( &p_range->lock );
+
+    if( p_range->p_cache )
+        http_cache_Delete( p_range->p_cache );
+    if( p_range->p_chunk )
+    {
+        for( int i = 0; i < p_range->i_chunk; i++ )
+            free( p_range->p_chunk[i].p_data );
+    }
+    free( p_range->p_chunk );
+    free( p_range->p_worker );
+    free( p_range->psz_request );
+    free( p_range->psz_tls_host );
+    free( p_range->psz_host );
+    free( p_range );
+}
+
+/* Called with the lock held */
+static void ReadPosition( http_range_t *p_range, int i_chunk )
+{
+    if( p_range->i_read_chunk == i_chunk )
+        return;
+    p_range->i_read_chunk = i_chunk;
+    vlc_cond_broadcast( &p_range->work );
+}
+
+ssize_t http_range_Read( http_range_t *p_range, uint64_t i_pos,
+                         uint8_t *p_buffer, size_t i_len )
+{
+    if( i_pos >= p_range->i_size )
+        return 0;
+
+    const int i_chunk = i_pos / HTTP_CHUNK_SIZE;
+    const size_t i_offset = i_pos % HTTP_CHUNK_SIZE;
+    http_chunk_t *c = &p_range->p_chunk[i_chunk];
+    bool b_disk = false;
+    ssize_t i_read;
+
+    vlc_mutex_lock( &p_range->lock );
+    ReadPosition( p_range, i_chunk );
+
+    while( c->i_state != CHUNK_DONE )
+    {
+        if( p_range->p_cache && http_cache_Has( p_range->p_cache, i_chunk ) )
+        {
+            b_disk = true;
+            break;
+        }
+        if( p_range->b_error )
+            break;
+        if( !vlc_object_alive( p_range->p_access ) )
+        {
+            vlc_mutex_unlock( &p_range->lock );
+            return 0;
+        }
+        vlc_cond_timedwait( &p_range->wait, &p_range->lock,
+                            mdate() + CLOCK_FREQ / 10 );
+    }
+
+    if( c->i_state == CHUNK_DONE || b_disk )
+    {
+        i_read = __MIN( i_len, ChunkSize( p_range, i_chunk ) - i_offset );
+        if( !b_disk )
+        {
+            memcpy( p_buffer, &c->p_data[i_offset], i_read );
+            c->i_used = mdate();
+        }
+
+        /* Consumption rate, averaged over about a second */
+        const mtime_t i_now = mdate();
+        p_range->i_read_bytes += i_read;
+        if( i_now - p_range->i_read_date >= CLOCK_FREQ )
+        {
+            const int64_t i_rate = p_range->i_read_bytes * CLOCK_FREQ /
+                                   ( i_now - p_range->i_read_date );
+            p_range->i_read_rate = p_range->i_read_rate > 0 ?
+                                   ( 3 * p_range->i_read_rate + i_rate ) / 4 : i_rate;
+            p_range->i_read_bytes = 0;
+            p_range->i_read_date = i_now;
+        }
+    }
+    else
+        i_read = -1;
+    vlc_mutex_unlock( &p_range->lock );
+
+    /* The disk is read without blocking the workers */
+    if( b_disk && http_cache_Read( p_range->p_cache, i_pos, p_buffer, i_read ) )
+    {
+        /* The chunk was forgotten by the cache, it will be fetched */
+        vlc_mutex_lock( &p_range->lock );
+        vlc_cond_broadcast( &p_range->work );
+        vlc_mutex_unlock( &p_range->lock );
+        return http_range_Read( p_range, i_pos, p_buffer, i_len );
+    }
+    return i_read;
+}
+
+void http_range_Seek( http_range_t *p_range, uint64_t i_pos )
+{
+    if( i_pos >= p_range->i_size )
+        return;
+
+    vlc_mutex_lock( &p_range->lock );
+    ReadPosition( p_range, i_pos / HTTP_CHUNK_SIZE );
+    vlc_mutex_unlock( &p_range->lock );
+}
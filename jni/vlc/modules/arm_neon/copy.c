@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * copy.c: ARM NEON memory and plane copies
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <string.h>
+#ifdef __ARM_NEON__
+#   include <arm_neon.h>
+#endif
+
+#include "copy.h"
+
+#ifdef __ARM_NEON__
+/* 4 cache lines ahead works best on Cortex-A8/A9 */
+#define PREFETCH_DISTANCE (64 * 4)
+
+/* The bulk of the copy, i_size being a multiple of 64 */
+static inline void CopyBlocks( uint8_t *p_dst, const uint8_t *p_src,
+                               size_t i_size )
+{
+    for( ; i_size > 0; i_size -= 64, p_src += 64, p_dst += 64 )
+    {
+        __builtin_prefetch( p_src + PREFETCH_DISTANCE );
+
+        const uint8x16_t a = vld1q_u8( p_src );
+        const uint8x16_t b = vld1q_u8( p_src + 16 );
+        const uint8x16_t c = vld1q_u8( p_src + 32 );
+        const uint8x16_t d = vld1q_u8( p_src + 48 );
+        vst1q_u8( p_dst, a );
+        vst1q_u8( p_dst + 16, b );
+        vst1q_u8( p_dst + 32, c );
+        vst1q_u8( p_dst + 48, d );
+    }
+}
+
+static inline void CopyLine( uint8_t *p_dst, const uint8_t *p_src,
+                             size_t i_size )
+{
+    /* Small copies are not worth the setup */
+    if( i_size >= 128 )
+    {
+        /* Align the destination on 16 bytes for the write buffer */
+        const size_t i_head = -(uintptr_t)p_dst & 15;
+
+        memcpy( p_dst, p_src, i_head );
+        p_dst  += i_head;
+        p_src  += i_head;
+        i_size -= i_head;
+
+        const size_t i_body = i_size & ~(size_t)63;
+        CopyBlocks( p_dst, p_src, i_body );
+        p_dst  += i_body;
+        p_src  += i_body;
+        i_size -= i_body;
+    }
+    memcpy( p_dst, p_src, i_size );
+}
+
+void *copy_MemcpyNEON( void *p_dst, const void *p_src, size_t i_size )
+{
+    __builtin_prefetch( p_src );
+    CopyLine( p_dst, p_src, i_size );
+    return p_dst;
+}
+
+void copy_PlaneNEON( uint8_t *p_dst, size_t i_dst_pitch,
+                     const uint8_t *p_src, size_t i_src_pitch,
+                     size_t i_width, size_t i_lines )
+{
+    for( ; i_lines > 0; i_lines-- )
+    {
+        /* The block loop only prefetches inside the current line */
+        __builtin_prefetch( p_src + i_src_pitch );
+        __builtin_prefetch( p_src + i_src_pitch + 64 );
+
+        CopyLine( p_dst, p_src, i_width );
+        p_src += i_src_pitch;
+        p_dst += i_dst_pitch;
+    }
+}
+#endif
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ * copy.h: ARM NEON memory and plane copies
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_ARM_NEON_COPY_H
+#define VLC_ARM_NEON_COPY_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __ARM_NEON__
+/**
+ * memcpy() replacement moving 64 bytes per iteration with the source
+ * prefetched ahead.
+ */
+void *copy_MemcpyNEON( void *p_dst, const void *p_src, size_t i_size );
+
+/**
+ * Copy i_lines lines of i_width bytes between two pitched planes, the next
+ * source line being prefetched while the current one is copied.
+ */
+void copy_PlaneNEON( uint8_t *p_dst, size_t i_dst_pitch,
+                     const uint8_t *p_src, size_t i_src_pitch,
+                     size_t i_width, size_t i_lines );
+#endif
+
+#endif
@@ -0,0 +1,54 @@
+/*****************************************************************************
+ * memcpy.c : ARM NEON memcpy and plane copy module
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_cpu.h>
+
+#include "copy.h"
+
+static int Activate( vlc_object_t *p_this )
+{
+    VLC_UNUSED(p_this);
+#ifdef __ARM_NEON__
+    if( !(vlc_CPU() & CPU_CAPABILITY_NEON) )
+        return VLC_EGENERIC;
+
+    vlc_fastmem_register( copy_MemcpyNEON );
+    vlc_fastplane_register( copy_PlaneNEON );
+
+    return VLC_SUCCESS;
+#else
+    return VLC_EGENERIC;
+#endif
+}
+
+vlc_module_begin ()
+    set_category( CAT_ADVANCED )
+    set_subcategory( SUBCAT_ADVANCED_MISC )
+    set_description( N_("ARM NEON memcpy") )
+    add_shortcut( "neon", "memcpyneon" )
+    set_capability( "memcpy", 100 )
+    set_callbacks( Activate, NULL )
+vlc_module_end ()
@@ -25,7 +25,33 @@ LOCAL_C_INCLUDES += \
     $(EXTROOT)/libass/include
 
 LOCAL_SRC_FILES := \
-    libass.c
+    libass.c \
+    libass_blend.c
+
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_ARM_MODE := arm
+ifeq ($(BUILD_WITH_NEON),1)
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_MODULE := danmaku_plugin
+
+LOCAL_CFLAGS += \
+    -std=c99 \
+    -DHAVE_CONFIG_H \
+    -DMODULE_STRING=\"danmaku\" \
+    -DMODULE_NAME=danmaku
+
+LOCAL_C_INCLUDES += \
+    $(VLCROOT) \
+    $(VLCROOT)/include \
+    $(VLCROOT)/src
+
+LOCAL_SRC_FILES := \
+    danmaku.c
 
 include $(BUILD_STATIC_LIBRARY)
 
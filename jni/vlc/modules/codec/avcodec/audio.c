@@ -310,7 +310,7 @@ aout_buffer_t * DecodeAudio ( decoder_t *p_dec, block_t **pp_block )
         return NULL;
     }
 
-    if( (p_block->i_flags & BLOCK_FLAG_PRIVATE_REALLOCATED) == 0 )
+    if( (p_block->i_flags & (BLOCK_FLAG_PRIVATE_REALLOCATED|BLOCK_FLAG_PADDED)) == 0 )
     {
         *pp_block = p_block = block_Realloc( p_block, 0, p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
         if( !p_block )
@@ -130,14 +130,16 @@ subpicture_t *DecodeSubtitle(decoder_t *dec, block_t **block_ptr)
         return NULL;
     }
 
-    *block_ptr =
-    block      = block_Realloc(block,
-                               0,
-                               block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE);
-    if (!block)
-        return NULL;
-    block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
-    memset(&block->p_buffer[block->i_buffer], 0, FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!(block->i_flags & BLOCK_FLAG_PADDED)) {
+        *block_ptr =
+        block      = block_Realloc(block,
+                                   0,
+                                   block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!block)
+            return NULL;
+        block->i_buffer -= FF_INPUT_BUFFER_PADDING_SIZE;
+        memset(&block->p_buffer[block->i_buffer], 0, FF_INPUT_BUFFER_PADDING_SIZE);
+    }
 
     /* */
     AVSubtitle subtitle;
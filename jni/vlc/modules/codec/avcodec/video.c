@@ -81,9 +81,11 @@ struct decoder_sys_t
     int i_decode_called_count;
     mtime_t i_decode_total_time;
     mtime_t i_decode_average_time;
-    mtime_t i_decode_last_time;
     mtime_t i_display_date_head;
-    int i_decode_may_suck;
+    /* for the decode ahead queue occupancy */
+    mtime_t i_frame_period;
+    mtime_t i_last_pts;
+    bool b_skip_pred;
 #endif
 
     /* for direct rendering */
@@ -432,9 +434,10 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     p_sys->i_decode_called_count = 0;
     p_sys->i_decode_total_time = 0;
     p_sys->i_decode_average_time = 0;
-    p_sys->i_decode_last_time = 0;
     p_sys->i_display_date_head = 0;
-    p_sys->i_decode_may_suck = 0;
+    p_sys->i_frame_period = 0;
+    p_sys->i_last_pts = VLC_TS_INVALID;
+    p_sys->b_skip_pred = false;
 #endif
 
     return VLC_SUCCESS;
@@ -476,6 +479,12 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         p_sys->i_pts = VLC_TS_INVALID; /* To make sure we recover properly */
 
         p_sys->i_late_frames = 0;
+#ifdef ANDROID
+        /* The queued pictures are flushed too */
+        p_sys->i_display_date_head = 0;
+        p_sys->i_last_pts = VLC_TS_INVALID;
+        p_sys->b_skip_pred = false;
+#endif
 
         if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
             avcodec_flush_buffers( p_context );
@@ -555,14 +564,27 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
 #endif
     }
 #else
+    /* The decoded pictures wait for their display in a queue of
+     * i_pictures_ahead pictures, how far ahead of the display the last
+     * one is tells how much of it is filled. The non reference pictures are
+     * skipped once it is almost drained, and until it is half filled again,
+     * so that a single picture slow to decode (an I frame) only eats a part
+     * of the queue instead of causing skips. */
     mtime_t i_time_now = mdate();
-    mtime_t i_time_adv = p_sys->i_display_date_head > 0 ? (p_sys->i_display_date_head - p_sys->i_decode_average_time - i_time_now) : 0;
-    p_sys->i_decode_may_suck = (i_time_adv < 0) ? (p_sys->i_decode_may_suck + 1) : 0;
-    bool b_skip_pred = (p_sys->i_decode_may_suck > 0);
+    const mtime_t i_frame_period = p_sys->i_frame_period > 0 ?
+                                   p_sys->i_frame_period : INT64_C(40000);
+    const mtime_t i_queue = __MAX( p_dec->i_pictures_ahead, 2 ) * i_frame_period;
+    if( p_sys->i_display_date_head > 0 )
+    {
+        const mtime_t i_time_adv = p_sys->i_display_date_head - i_time_now;
+        if( i_time_adv < __MAX( i_queue / 4, p_sys->i_decode_average_time ) )
+            p_sys->b_skip_pred = true;
+        else if( i_time_adv >= i_queue / 2 )
+            p_sys->b_skip_pred = false;
+    }
     bool b_skip_late = (p_sys->i_late_frames > 4);
-    bool b_no_skip_pred = (p_sys->i_decode_last_time < p_sys->i_decode_average_time);
     bool b_no_skip_late = (i_time_now + p_sys->i_decode_average_time - p_sys->i_late_frames_start < 200000);
-    bool b_skip = ( (!p_dec->b_pace_control) &&  ((b_skip_pred && !b_no_skip_pred) || (b_skip_late && !b_no_skip_late)) );
+    bool b_skip = ( (!p_dec->b_pace_control) &&  (p_sys->b_skip_pred || (b_skip_late && !b_no_skip_late)) );
     p_context->skip_frame = b_skip ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
     if( !(p_block->i_flags & BLOCK_FLAG_PREROLL) )
         b_drawpicture = 1;
@@ -575,12 +597,13 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
     /*
      * Do the actual decoding now */
 
-    /* Don't forget that ffmpeg requires a little more bytes
-     * that the real frame size */
     if( p_block->i_buffer > 0 )
-    {
         p_sys->b_flush = ( p_block->i_flags & BLOCK_FLAG_END_OF_SEQUENCE ) != 0;
 
+    /* Don't forget that ffmpeg requires a little more bytes
+     * that the real frame size, unless the demuxer has padded it */
+    if( p_block->i_buffer > 0 && !( p_block->i_flags & BLOCK_FLAG_PADDED ) )
+    {
         p_block = block_Realloc( p_block, 0,
                             p_block->i_buffer + FF_INPUT_BUFFER_PADDING_SIZE );
         if( !p_block )
@@ -639,7 +662,6 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         p_sys->i_decode_called_count += 1;
         p_sys->i_decode_total_time += i_decode_time;
         p_sys->i_decode_average_time = (p_sys->i_decode_total_time / p_sys->i_decode_called_count);
-        p_sys->i_decode_last_time = i_decode_time;
 #endif
 
         wait_mt( p_sys );
@@ -746,6 +768,16 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
 
 #ifdef ANDROID
         p_sys->i_display_date_head = i_display_date;
+        if( i_pts > VLC_TS_INVALID )
+        {
+            /* Smoothed duration of the pictures, in display order */
+            const mtime_t i_period = i_pts - p_sys->i_last_pts;
+            if( p_sys->i_last_pts > VLC_TS_INVALID &&
+                i_period > 0 && i_period < CLOCK_FREQ )
+                p_sys->i_frame_period = p_sys->i_frame_period > 0 ?
+                    (7 * p_sys->i_frame_period + i_period) / 8 : i_period;
+            p_sys->i_last_pts = i_pts;
+        }
 #endif
 
         if( i_display_date > 0 && i_display_date <= mdate() )
@@ -0,0 +1,873 @@
+/*****************************************************************************
+ * danmaku.c: scrolling comments (danmaku) decoder
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <string.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_codec.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Create ( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+#define MAX_TEXT N_("Maximum number of comments")
+#define MAX_LONGTEXT N_( \
+    "Maximum number of comments displayed at the same time. New comments " \
+    "are dropped above it." )
+#define DURATION_TEXT N_("Comment duration")
+#define DURATION_LONGTEXT N_( \
+    "Time (in seconds) a scrolling comment takes to cross the screen, it " \
+    "is also the time a top or bottom comment stays visible." )
+
+vlc_module_begin ()
+    set_shortname( N_("Danmaku"))
+    set_description( N_("Scrolling comments (danmaku) renderer") )
+    set_capability( "decoder", 50 )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_SCODEC )
+    add_integer( "danmaku-max", 300, MAX_TEXT, MAX_LONGTEXT, true )
+    add_float( "danmaku-duration", 4.0, DURATION_TEXT, DURATION_LONGTEXT, true )
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static subpicture_t *DecodeBlock( decoder_t *, block_t ** );
+
+/* Comments are laid out for a 384 lines high screen (the size of the
+ * original flash players), font sizes are given for it */
+#define LAYOUT_HEIGHT 384
+#define LANE_SIZE     25
+
+/* A comment that could not be placed within LATE_MAX is dropped */
+#define LATE_MAX      (250*1000)
+
+/* Rasterisation budget of one frame, comments over it are delayed (and
+ * then dropped as late) so that the video never waits for the text */
+#define RASTER_MAX_COUNT 16
+#define RASTER_MAX_TIME  (8*1000)
+
+/* Comments less than COALESCE_DELAY apart share the same subpicture */
+#define COALESCE_DELAY (200*1000)
+
+enum
+{
+    MODE_SCROLL,
+    MODE_REVERSE,
+    MODE_TOP,
+    MODE_BOTTOM,
+};
+
+typedef struct
+{
+    mtime_t    i_start;     /* stream date */
+    int        i_mode;
+    int        i_size;      /* font size in layout pixels */
+    uint32_t   i_color;     /* 0xRRGGBB */
+    char       *psz_text;
+
+    /* Valid once laid out */
+    mtime_t    i_shown;     /* stream date at which it entered the screen */
+    picture_t  *p_picture;  /* cached RGBA bitmap */
+    int        i_lane;
+    int        i_lanes;
+} comment_t;
+
+/* */
+struct decoder_sys_t
+{
+    mtime_t        i_max_stop;
+    mtime_t        i_last_start;
+
+    /* The following fields of decoder_sys_t are shared between decoder and spu units */
+    vlc_mutex_t    lock;
+    int            i_refcount;
+
+    filter_t       *p_text;
+    int            i_max;
+    mtime_t        i_duration;
+
+    /* Display the layout was done for */
+    int            i_width;
+    int            i_height;
+    int            i_lane_height;
+    int            i_lane_count;
+
+    /* Received comments, in start order, waiting to be laid out */
+    comment_t      **pp_pending;
+    int            i_pending;
+    int            i_pending_max;
+
+    /* Laid out comments */
+    comment_t      **pp_active;
+    int            i_active;
+
+    /* Last comment of each lane (or NULL), per lane kind */
+    comment_t      **pp_lane_scroll;
+    comment_t      **pp_lane_reverse;
+    comment_t      **pp_lane_top;
+    comment_t      **pp_lane_bottom;
+
+    unsigned       i_dropped;
+};
+static void DecSysRelease( decoder_sys_t *p_sys );
+static void DecSysHold( decoder_sys_t *p_sys );
+
+/* */
+static int SubpictureValidate( subpicture_t *,
+                               bool, const video_format_t *,
+                               bool, const video_format_t *,
+                               mtime_t );
+static void SubpictureUpdate( subpicture_t *,
+                              const video_format_t *,
+                              const video_format_t *,
+                              mtime_t );
+static void SubpictureDestroy( subpicture_t * );
+
+struct subpicture_updater_sys_t
+{
+    decoder_sys_t *p_dec_sys;
+    mtime_t       i_pts;
+
+    mtime_t       i_date;
+};
+
+static comment_t *CommentNew( const char *, mtime_t );
+static void CommentDelete( comment_t * );
+static void LayoutReset( decoder_sys_t * );
+
+/*****************************************************************************
+ * Create: Open danmaku decoder.
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    decoder_t *p_dec = (decoder_t *)p_this;
+    decoder_sys_t *p_sys;
+
+    if( p_dec->fmt_in.i_codec != VLC_CODEC_DANMAKU )
+        return VLC_EGENERIC;
+
+    p_dec->pf_decode_sub = DecodeBlock;
+
+    p_dec->p_sys = p_sys = calloc( 1, sizeof( decoder_sys_t ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    /* */
+    vlc_mutex_init( &p_sys->lock );
+    p_sys->i_refcount = 1;
+    p_sys->i_max_stop = VLC_TS_INVALID;
+    p_sys->i_last_start = VLC_TS_INVALID;
+    p_sys->i_max = __MAX( var_InheritInteger( p_dec, "danmaku-max" ), 1 );
+    p_sys->i_duration = __MAX( var_InheritFloat( p_dec, "danmaku-duration" ), 0.5 ) * CLOCK_FREQ;
+
+    p_sys->pp_active = calloc( p_sys->i_max, sizeof(*p_sys->pp_active) );
+    if( !p_sys->pp_active )
+    {
+        DecSysRelease( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    /* The comments are rasterised once by the text renderer, then only
+     * moved around */
+    filter_t *p_text = p_sys->p_text =
+        vlc_object_create( p_dec, sizeof(*p_text) );
+    if( !p_text )
+    {
+        DecSysRelease( p_sys );
+        return VLC_ENOMEM;
+    }
+    es_format_Init( &p_text->fmt_in, VIDEO_ES, 0 );
+    es_format_Init( &p_text->fmt_out, VIDEO_ES, 0 );
+    p_text->fmt_out.video.i_width          =
+    p_text->fmt_out.video.i_visible_width  = 32;
+    p_text->fmt_out.video.i_height         =
+    p_text->fmt_out.video.i_visible_height = 32;
+
+    p_text->p_module = module_need( p_text, "text renderer", "$text-renderer", false );
+    if( !p_text->p_module )
+    {
+        msg_Warn( p_dec, "no text renderer found" );
+        DecSysRelease( p_sys );
+        return VLC_EGENERIC;
+    }
+    var_Create( p_text, "spu-elapsed",   VLC_VAR_TIME );
+    var_Create( p_text, "text-rerender", VLC_VAR_BOOL );
+
+    p_dec->fmt_out.i_cat = SPU_ES;
+    p_dec->fmt_out.i_codec = VLC_CODEC_RGBA;
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: finish
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    decoder_t *p_dec = (decoder_t *)p_this;
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->i_dropped > 0 )
+        msg_Dbg( p_dec, "%u comments dropped", p_sys->i_dropped );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    DecSysRelease( p_sys );
+}
+
+static void DecSysHold( decoder_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->i_refcount++;
+    vlc_mutex_unlock( &p_sys->lock );
+}
+static void DecSysRelease( decoder_sys_t *p_sys )
+{
+    /* */
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->i_refcount--;
+    if( p_sys->i_refcount > 0 )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return;
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+    vlc_mutex_destroy( &p_sys->lock );
+
+    if( p_sys->pp_active )
+        LayoutReset( p_sys );
+    for( int i = 0; i < p_sys->i_pending; i++ )
+        CommentDelete( p_sys->pp_pending[i] );
+    free( p_sys->pp_pending );
+    free( p_sys->pp_active );
+    free( p_sys->pp_lane_scroll );
+    free( p_sys->pp_lane_reverse );
+    free( p_sys->pp_lane_top );
+    free( p_sys->pp_lane_bottom );
+
+    if( p_sys->p_text )
+    {
+        if( p_sys->p_text->p_module )
+            module_unneed( p_sys->p_text, p_sys->p_text->p_module );
+        vlc_object_release( p_sys->p_text );
+    }
+
+    free( p_sys );
+}
+
+/****************************************************************************
+ * DecodeBlock:
+ ****************************************************************************/
+static subpicture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    subpicture_t *p_spu = NULL;
+    block_t *p_block;
+
+    if( !pp_block || *pp_block == NULL )
+        return NULL;
+
+    p_block = *pp_block;
+    *pp_block = NULL;
+    if( p_block->i_flags & (BLOCK_FLAG_DISCONTINUITY|BLOCK_FLAG_CORRUPTED) )
+    {
+        p_sys->i_max_stop = VLC_TS_INVALID;
+        p_sys->i_last_start = VLC_TS_INVALID;
+
+        /* Everything queued or on screen is from before the seek */
+        vlc_mutex_lock( &p_sys->lock );
+        for( int i = 0; i < p_sys->i_pending; i++ )
+            CommentDelete( p_sys->pp_pending[i] );
+        p_sys->i_pending = 0;
+        LayoutReset( p_sys );
+        vlc_mutex_unlock( &p_sys->lock );
+
+        block_Release( p_block );
+        return NULL;
+    }
+
+    if( p_block->i_buffer == 0 || p_block->p_buffer[p_block->i_buffer-1] != '\0' )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    comment_t *p_comment = CommentNew( (const char *)p_block->p_buffer,
+                                       p_block->i_pts );
+    if( !p_comment )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->i_pending >= p_sys->i_pending_max )
+    {
+        const int i_max = __MAX( 2 * p_sys->i_pending_max, 64 );
+        comment_t **pp_pending = realloc( p_sys->pp_pending,
+                                          i_max * sizeof(*pp_pending) );
+        if( !pp_pending )
+        {
+            vlc_mutex_unlock( &p_sys->lock );
+            CommentDelete( p_comment );
+            block_Release( p_block );
+            return NULL;
+        }
+        p_sys->pp_pending = pp_pending;
+        p_sys->i_pending_max = i_max;
+    }
+    p_sys->pp_pending[p_sys->i_pending++] = p_comment;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    /* The comments are drawn by the updater of the latest subpicture, a new
+     * one is only needed when the current one would not last long enough */
+    if( p_sys->i_last_start > VLC_TS_INVALID &&
+        p_block->i_pts >= p_sys->i_last_start &&
+        p_block->i_pts < p_sys->i_last_start + COALESCE_DELAY )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    subpicture_updater_sys_t *p_spu_sys = malloc( sizeof(*p_spu_sys) );
+    if( !p_spu_sys )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    subpicture_updater_t updater = {
+        .pf_validate = SubpictureValidate,
+        .pf_update   = SubpictureUpdate,
+        .pf_destroy  = SubpictureDestroy,
+        .p_sys       = p_spu_sys,
+    };
+    p_spu = decoder_NewSubpicture( p_dec, &updater );
+    if( !p_spu )
+    {
+        msg_Warn( p_dec, "can't get spu buffer" );
+        free( p_spu_sys );
+        block_Release( p_block );
+        return NULL;
+    }
+
+    p_spu_sys->p_dec_sys = p_sys;
+    p_spu_sys->i_pts = p_block->i_pts;
+    p_spu_sys->i_date = VLC_TS_INVALID;
+
+    /* Covers every comment coalesced into it */
+    p_spu->i_start = p_block->i_pts;
+    p_spu->i_stop = __MAX( p_sys->i_max_stop, p_block->i_pts + 2 * p_sys->i_duration );
+    p_spu->b_ephemer = true;
+    p_spu->b_absolute = true;
+
+    p_sys->i_max_stop = p_spu->i_stop;
+    p_sys->i_last_start = p_block->i_pts;
+
+    DecSysHold( p_sys ); /* Keep a reference for the returned subpicture */
+
+    block_Release( p_block );
+
+    return p_spu;
+}
+
+/****************************************************************************
+ * Comments
+ ****************************************************************************/
+
+/* The subtitle demuxer sends "mode,size,color\ntext" */
+static comment_t *CommentNew( const char *psz_data, mtime_t i_start )
+{
+    int i_mode, i_size;
+    unsigned i_color;
+
+    const char *psz_text = strchr( psz_data, '\n' );
+    if( !psz_text || *++psz_text == '\0' ||
+        sscanf( psz_data, "%d,%d,%u", &i_mode, &i_size, &i_color ) != 3 )
+        return NULL;
+
+    switch( i_mode )
+    {
+    case 1: case 2: case 3:
+        i_mode = MODE_SCROLL;
+        break;
+    case 4:
+        i_mode = MODE_BOTTOM;
+        break;
+    case 5:
+        i_mode = MODE_TOP;
+        break;
+    case 6:
+        i_mode = MODE_REVERSE;
+        break;
+    default:
+        /* Positioned and scripted comments are not supported */
+        return NULL;
+    }
+
+    comment_t *p_comment = calloc( 1, sizeof(*p_comment) );
+    if( !p_comment )
+        return NULL;
+    p_comment->psz_text = strdup( psz_text );
+    if( !p_comment->psz_text )
+    {
+        free( p_comment );
+        return NULL;
+    }
+    p_comment->i_start = i_start;
+    p_comment->i_mode  = i_mode;
+    p_comment->i_size  = __MAX( __MIN( i_size, 4 * LANE_SIZE ), 1 );
+    p_comment->i_color = i_color & 0xffffff;
+    return p_comment;
+}
+
+static void CommentDelete( comment_t *p_comment )
+{
+    if( p_comment->p_picture )
+        picture_Release( p_comment->p_picture );
+    free( p_comment->psz_text );
+    free( p_comment );
+}
+
+/* Rasterise the comment once, in RGBA */
+static int CommentRender( decoder_sys_t *p_sys, comment_t *p_comment )
+{
+    video_format_t fmt;
+    video_format_Init( &fmt, VLC_CODEC_TEXT );
+
+    subpicture_region_t *p_in = subpicture_region_New( &fmt );
+    subpicture_region_t *p_out = subpicture_region_New( &fmt );
+    if( !p_in || !p_out )
+        goto error;
+
+    p_in->psz_text = strdup( p_comment->psz_text );
+    p_in->p_style = text_style_New();
+    if( !p_in->psz_text || !p_in->p_style )
+        goto error;
+    p_in->p_style->i_font_size  = __MAX( p_comment->i_size * p_sys->i_height / LAYOUT_HEIGHT, 8 );
+    p_in->p_style->i_font_color = p_comment->i_color;
+    p_in->p_style->i_font_alpha = 0xff;
+
+    const vlc_fourcc_t p_chroma_list[] = { VLC_CODEC_RGBA, 0 };
+    if( p_sys->p_text->pf_render_text( p_sys->p_text, p_out, p_in, p_chroma_list ) ||
+        !p_out->p_picture || p_out->fmt.i_chroma != VLC_CODEC_RGBA )
+        goto error;
+
+    p_comment->p_picture = p_out->p_picture;
+    p_out->p_picture = NULL;
+
+    subpicture_region_Delete( p_in );
+    subpicture_region_Delete( p_out );
+    return VLC_SUCCESS;
+
+error:
+    subpicture_region_Delete( p_in );
+    subpicture_region_Delete( p_out );
+    return VLC_EGENERIC;
+}
+
+static int CommentWidth( const comment_t *p_comment )
+{
+    return p_comment->p_picture->format.i_visible_width;
+}
+
+/* A view on the visible columns of the cached bitmap, without copy */
+static void CommentPictureRelease( picture_t *p_picture )
+{
+    if( --p_picture->i_refcount > 0 )
+        return;
+    picture_Release( (picture_t *)p_picture->p_release_sys );
+    p_picture->p_release_sys = NULL;
+    picture_Delete( p_picture );
+}
+
+static picture_t *CommentPictureCrop( picture_t *p_src, int i_x, int i_width )
+{
+    video_format_t fmt = p_src->format;
+    fmt.i_width  =
+    fmt.i_visible_width = i_width;
+    fmt.i_x_offset = 0;
+
+    picture_resource_t rsc;
+    memset( &rsc, 0, sizeof(rsc) );
+    rsc.p[0].p_pixels = &p_src->p[0].p_pixels[i_x * p_src->p[0].i_pixel_pitch];
+    rsc.p[0].i_lines  = p_src->p[0].i_lines;
+    rsc.p[0].i_pitch  = p_src->p[0].i_pitch;
+
+    picture_t *p_picture = picture_NewFromResource( &fmt, &rsc );
+    if( !p_picture )
+        return NULL;
+    p_picture->pf_release = CommentPictureRelease;
+    p_picture->p_release_sys =
+        (picture_release_sys_t *)picture_Hold( p_src );
+    return p_picture;
+}
+
+/****************************************************************************
+ * Layout
+ ****************************************************************************/
+static mtime_t CommentStop( const decoder_sys_t *p_sys, const comment_t *p_comment )
+{
+    return p_comment->i_shown + p_sys->i_duration;
+}
+
+/* Position of the left of the comment at i_date */
+static int CommentX( const decoder_sys_t *p_sys, const comment_t *p_comment,
+                     mtime_t i_date )
+{
+    const int i_width = CommentWidth( p_comment );
+    const int64_t i_run = (int64_t)(p_sys->i_width + i_width) *
+                          (i_date - p_comment->i_shown) / p_sys->i_duration;
+
+    switch( p_comment->i_mode )
+    {
+    case MODE_SCROLL:
+        return p_sys->i_width - i_run;
+    case MODE_REVERSE:
+        return i_run - i_width;
+    default:
+        return ( p_sys->i_width - i_width ) / 2;
+    }
+}
+
+/* Can p_new enter a scrolling lane at i_date after p_last ? */
+static bool LaneScrollFree( const decoder_sys_t *p_sys,
+                            const comment_t *p_last, const comment_t *p_new,
+                            mtime_t i_date )
+{
+    if( !p_last )
+        return true;
+
+    const int64_t i_width = p_sys->i_width;
+    const int64_t i_last = CommentWidth( p_last );
+    const int64_t i_elapsed = i_date - p_last->i_shown;
+    const int64_t i_left = CommentStop( p_sys, p_last ) - i_date;
+
+    if( i_left <= 0 )
+        return true;
+    /* The last one must have fully entered the screen */
+    if( i_elapsed * ( i_width + i_last ) < i_last * p_sys->i_duration )
+        return false;
+    /* and p_new must not catch it up before it leaves */
+    return i_left * ( i_width + CommentWidth( p_new ) ) <= i_width * p_sys->i_duration;
+}
+
+static bool LaneStaticFree( const decoder_sys_t *p_sys,
+                            const comment_t *p_last, mtime_t i_date )
+{
+    return !p_last || CommentStop( p_sys, p_last ) <= i_date;
+}
+
+/* Find the first run of free lanes for the comment, -1 if none */
+static int LaneFind( decoder_sys_t *p_sys, comment_t *p_comment, mtime_t i_date )
+{
+    comment_t **pp_lane;
+    switch( p_comment->i_mode )
+    {
+    case MODE_SCROLL:  pp_lane = p_sys->pp_lane_scroll; break;
+    case MODE_REVERSE: pp_lane = p_sys->pp_lane_reverse; break;
+    case MODE_TOP:     pp_lane = p_sys->pp_lane_top; break;
+    default:           pp_lane = p_sys->pp_lane_bottom; break;
+    }
+
+    const int i_height = p_comment->p_picture->format.i_visible_height;
+    const int i_lanes = __MAX( ( i_height + p_sys->i_lane_height - 1 ) / p_sys->i_lane_height, 1 );
+
+    for( int i_lane = 0; i_lane + i_lanes <= p_sys->i_lane_count; i_lane++ )
+    {
+        int i;
+        for( i = 0; i < i_lanes; i++ )
+        {
+            const comment_t *p_last = pp_lane[i_lane + i];
+            const bool b_free = p_comment->i_mode == MODE_SCROLL ||
+                                p_comment->i_mode == MODE_REVERSE
+                ? LaneScrollFree( p_sys, p_last, p_comment, i_date )
+                : LaneStaticFree( p_sys, p_last, i_date );
+            if( !b_free )
+                break;
+        }
+        if( i < i_lanes )
+        {
+            i_lane += i;
+            continue;
+        }
+        for( i = 0; i < i_lanes; i++ )
+            pp_lane[i_lane + i] = p_comment;
+        p_comment->i_lane = i_lane;
+        p_comment->i_lanes = i_lanes;
+        return i_lane;
+    }
+    return -1;
+}
+
+static void LaneRemove( decoder_sys_t *p_sys, const comment_t *p_comment )
+{
+    comment_t **pp_lanes[] = {
+        p_sys->pp_lane_scroll, p_sys->pp_lane_reverse,
+        p_sys->pp_lane_top, p_sys->pp_lane_bottom,
+    };
+    for( unsigned k = 0; k < sizeof(pp_lanes)/sizeof(*pp_lanes); k++ )
+    {
+        for( int i = 0; i < p_comment->i_lanes; i++ )
+        {
+            if( pp_lanes[k][p_comment->i_lane + i] == p_comment )
+                pp_lanes[k][p_comment->i_lane + i] = NULL;
+        }
+    }
+}
+
+/* Drop everything on screen, the pending comments are kept */
+static void LayoutReset( decoder_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_active; i++ )
+        CommentDelete( p_sys->pp_active[i] );
+    p_sys->i_active = 0;
+    for( int i = 0; i < p_sys->i_lane_count; i++ )
+    {
+        p_sys->pp_lane_scroll[i] = NULL;
+        p_sys->pp_lane_reverse[i] = NULL;
+        p_sys->pp_lane_top[i] = NULL;
+        p_sys->pp_lane_bottom[i] = NULL;
+    }
+}
+
+static int LayoutSetup( decoder_sys_t *p_sys, int i_width, int i_height )
+{
+    LayoutReset( p_sys );
+
+    p_sys->i_width = i_width;
+    p_sys->i_height = i_height;
+    p_sys->i_lane_height = __MAX( LANE_SIZE * i_height / LAYOUT_HEIGHT, 1 );
+    p_sys->i_lane_count = i_height / p_sys->i_lane_height;
+
+    comment_t ***ppp_lanes[] = {
+        &p_sys->pp_lane_scroll, &p_sys->pp_lane_reverse,
+        &p_sys->pp_lane_top, &p_sys->pp_lane_bottom,
+    };
+    for( unsigned k = 0; k < sizeof(ppp_lanes)/sizeof(*ppp_lanes); k++ )
+    {
+        free( *ppp_lanes[k] );
+        *ppp_lanes[k] = calloc( __MAX( p_sys->i_lane_count, 1 ), sizeof(comment_t *) );
+        if( !*ppp_lanes[k] )
+        {
+            p_sys->i_lane_count = 0;
+            return VLC_ENOMEM;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+/* Advance the layout to i_date, returns true if something is on screen */
+static bool LayoutUpdate( decoder_sys_t *p_sys, mtime_t i_date )
+{
+    /* Remove the comments that are done */
+    for( int i = 0; i < p_sys->i_active; )
+    {
+        comment_t *p_comment = p_sys->pp_active[i];
+        if( CommentStop( p_sys, p_comment ) > i_date &&
+            p_comment->i_shown <= i_date )
+        {
+            i++;
+            continue;
+        }
+        LaneRemove( p_sys, p_comment );
+        CommentDelete( p_comment );
+        p_sys->pp_active[i] = p_sys->pp_active[--p_sys->i_active];
+    }
+
+    /* Lay out the comments that are due, within the frame budget */
+    const mtime_t i_deadline = mdate() + RASTER_MAX_TIME;
+    int i_raster = 0;
+    int i_done = 0;
+    for( ; i_done < p_sys->i_pending; i_done++ )
+    {
+        comment_t *p_comment = p_sys->pp_pending[i_done];
+
+        if( p_comment->i_start > i_date )
+            break;
+        if( i_raster >= RASTER_MAX_COUNT || mdate() >= i_deadline )
+        {
+            /* Out of time: retry on the next frame, unless too late */
+            if( i_date - p_comment->i_start <= LATE_MAX )
+                break;
+            p_sys->i_dropped++;
+            CommentDelete( p_comment );
+            continue;
+        }
+        if( i_date - p_comment->i_start > LATE_MAX ||
+            p_sys->i_active >= p_sys->i_max ||
+            p_sys->i_lane_count <= 0 )
+        {
+            p_sys->i_dropped++;
+            CommentDelete( p_comment );
+            continue;
+        }
+
+        i_raster++;
+        p_comment->i_shown = i_date;
+        if( CommentRender( p_sys, p_comment ) ||
+            LaneFind( p_sys, p_comment, i_date ) < 0 )
+        {
+            p_sys->i_dropped++;
+            CommentDelete( p_comment );
+            continue;
+        }
+        p_sys->pp_active[p_sys->i_active++] = p_comment;
+    }
+    if( i_done > 0 )
+    {
+        p_sys->i_pending -= i_done;
+        memmove( p_sys->pp_pending, &p_sys->pp_pending[i_done],
+                 p_sys->i_pending * sizeof(*p_sys->pp_pending) );
+    }
+
+    return p_sys->i_active > 0;
+}
+
+/****************************************************************************
+ *
+ ****************************************************************************/
+static int SubpictureValidate( subpicture_t *p_subpic,
+                               bool b_fmt_src, const video_format_t *p_fmt_src,
+                               bool b_fmt_dst, const video_format_t *p_fmt_dst,
+                               mtime_t i_ts )
+{
+    VLC_UNUSED( b_fmt_src ); VLC_UNUSED( p_fmt_src );
+
+    subpicture_updater_sys_t *p_upd_sys = p_subpic->updater.p_sys;
+    decoder_sys_t *p_sys = p_upd_sys->p_dec_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+
+    /* The bitmaps are rendered for the display size, redo the layout when
+     * it changes */
+    if( p_sys->i_width != (int)p_fmt_dst->i_width ||
+        p_sys->i_height != (int)p_fmt_dst->i_height ||
+        p_sys->i_lane_count <= 0 )
+        LayoutSetup( p_sys, p_fmt_dst->i_width, p_fmt_dst->i_height );
+
+    /* */
+    const mtime_t i_date = p_upd_sys->i_pts + (i_ts - p_subpic->i_start);
+    const bool b_visible = LayoutUpdate( p_sys, i_date );
+
+    /* Nothing moves: keep the current regions */
+    if( !b_visible && !p_subpic->p_region && !b_fmt_dst )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_SUCCESS;
+    }
+    p_upd_sys->i_date = i_date;
+
+    /* The lock is released by SubpictureUpdate */
+    return VLC_EGENERIC;
+}
+
+static void SubpictureUpdate( subpicture_t *p_subpic,
+                              const video_format_t *p_fmt_src,
+                              const video_format_t *p_fmt_dst,
+                              mtime_t i_ts )
+{
+    VLC_UNUSED( p_fmt_src ); VLC_UNUSED( p_fmt_dst ); VLC_UNUSED( i_ts );
+
+    subpicture_updater_sys_t *p_upd_sys = p_subpic->updater.p_sys;
+    decoder_sys_t *p_sys = p_upd_sys->p_dec_sys;
+    const mtime_t i_date = p_upd_sys->i_date;
+
+    /* */
+    p_subpic->i_original_picture_width  = p_sys->i_width;
+    p_subpic->i_original_picture_height = p_sys->i_height;
+
+    /* One region per comment, sharing the cached bitmap: only the visible
+     * part is given to the blender, which would otherwise move the regions
+     * inside the picture */
+    subpicture_region_t **pp_region_last = &p_subpic->p_region;
+    for( int i = 0; i < p_sys->i_active; i++ )
+    {
+        comment_t *p_comment = p_sys->pp_active[i];
+        picture_t *p_src = p_comment->p_picture;
+
+        const int i_width = CommentWidth( p_comment );
+        const int i_x = CommentX( p_sys, p_comment, i_date );
+        const int i_x0 = __MAX( i_x, 0 );
+        const int i_x1 = __MIN( i_x + i_width, p_sys->i_width );
+        if( i_x0 >= i_x1 )
+            continue;
+
+        int i_y = p_comment->i_lane * p_sys->i_lane_height;
+        if( p_comment->i_mode == MODE_BOTTOM )
+            i_y = p_sys->i_height - i_y - p_comment->i_lanes * p_sys->i_lane_height;
+        const int i_height = __MIN( (int)p_src->format.i_visible_height,
+                                    p_sys->i_height - __MAX( i_y, 0 ) );
+        if( i_height <= 0 )
+            continue;
+
+        picture_t *p_picture = i_x0 == i_x && i_x1 == i_x + i_width
+                             ? picture_Hold( p_src )
+                             : CommentPictureCrop( p_src, i_x0 - i_x, i_x1 - i_x0 );
+        if( !p_picture )
+            continue;
+
+        video_format_t fmt;
+        video_format_Init( &fmt, VLC_CODEC_TEXT );
+        subpicture_region_t *r = subpicture_region_New( &fmt );
+        if( !r )
+        {
+            picture_Release( p_picture );
+            break;
+        }
+        r->fmt = p_picture->format;
+        r->fmt.i_height =
+        r->fmt.i_visible_height = i_height;
+        r->p_picture = p_picture;
+        r->i_x = i_x0;
+        r->i_y = __MAX( i_y, 0 );
+        r->i_align = SUBPICTURE_ALIGN_TOP | SUBPICTURE_ALIGN_LEFT;
+
+        /* */
+        *pp_region_last = r;
+        pp_region_last = &r->p_next;
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+static void SubpictureDestroy( subpicture_t *p_subpic )
+{
+    subpicture_updater_sys_t *p_sys = p_subpic->updater.p_sys;
+
+    DecSysRelease( p_sys->p_dec_sys );
+    free( p_sys );
+}
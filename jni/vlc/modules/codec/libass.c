@@ -39,9 +39,12 @@
 #include <vlc_codec.h>
 #include <vlc_input.h>
 #include <vlc_dialog.h>
+#include <vlc_cpu.h>
 
 #include <ass/ass.h>
 
+#include "libass_blend.h"
+
 #if defined(WIN32)
 #   include <vlc_charset.h>
 #endif
@@ -82,6 +85,8 @@ struct decoder_sys_t
 
     /* */
     ASS_Track      *p_track;
+
+    libass_blend_line_t pf_blend;
 };
 static void DecSysRelease( decoder_sys_t *p_sys );
 static void DecSysHold( decoder_sys_t *p_sys );
@@ -116,7 +121,8 @@ typedef struct
 } rectangle_t;
 
 static int BuildRegions( rectangle_t *p_region, int i_max_region, ASS_Image *p_img_list, int i_width, int i_height );
-static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img );
+static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img,
+                        libass_blend_line_t pf_blend );
 
 //#define DEBUG_REGION
 
@@ -145,6 +151,11 @@ static int Create( vlc_object_t *p_this )
     p_sys->p_library  = NULL;
     p_sys->p_renderer = NULL;
     p_sys->p_track    = NULL;
+    p_sys->pf_blend   = libass_BlendLineC;
+#ifdef __ARM_NEON__
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+        p_sys->pf_blend = libass_BlendLineNEON;
+#endif
 
     /* Create libass library */
     ASS_Library *p_library = p_sys->p_library = ass_library_init();
@@ -470,7 +481,7 @@ static void SubpictureUpdate( subpicture_t *p_subpic,
         r->i_align = SUBPICTURE_ALIGN_TOP | SUBPICTURE_ALIGN_LEFT;
 
         /* */
-        RegionDraw( r, p_img );
+        RegionDraw( r, p_img, p_sys->pf_blend );
 
         /* */
         *pp_region_last = r;
@@ -639,7 +650,8 @@ static int BuildRegions( rectangle_t *p_region, int i_max_region, ASS_Image *p_i
     return i_region;
 }
 
-static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img )
+static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img,
+                        libass_blend_line_t pf_blend )
 {
     const plane_t *p = &p_region->p_picture->p[0];
     const int i_x = p_region->i_x;
@@ -647,6 +659,8 @@ static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img )
     const int i_width  = p_region->fmt.i_width;
     const int i_height = p_region->fmt.i_height;
 
+    /* Composite in premultiplied alpha, then go back to straight RGBA
+     * (native endianness, but RGBA ordering) */
     memset( p->p_pixels, 0x00, p->i_pitch * p->i_lines );
     for( ; p_img != NULL; p_img = p_img->next )
     {
@@ -654,44 +668,12 @@ static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img )
             p_img->dst_y < i_y || p_img->dst_y + p_img->h > i_y + i_height )
             continue;
 
-        const unsigned r = (p_img->color >> 24)&0xff;
-        const unsigned g = (p_img->color >> 16)&0xff;
-        const unsigned b = (p_img->color >>  8)&0xff;
-        const unsigned a = (p_img->color      )&0xff;
-        int x, y;
-
-        for( y = 0; y < p_img->h; y++ )
-        {
-            for( x = 0; x < p_img->w; x++ )
-            {
-                const unsigned alpha = p_img->bitmap[y*p_img->stride+x];
-                const unsigned an = (255 - a) * alpha / 255;
-
-                uint8_t *p_rgba = &p->p_pixels[(y+p_img->dst_y-i_y) * p->i_pitch + 4 * (x+p_img->dst_x-i_x)];
-                const unsigned ao = p_rgba[3];
-
-                /* Native endianness, but RGBA ordering */
-                if( ao == 0 )
-                {
-                    /* Optimized but the else{} will produce the same result */
-                    p_rgba[0] = r;
-                    p_rgba[1] = g;
-                    p_rgba[2] = b;
-                    p_rgba[3] = an;
-                }
-                else
-                {
-                    p_rgba[3] = 255 - ( 255 - p_rgba[3] ) * ( 255 - an ) / 255;
-                    if( p_rgba[3] != 0 )
-                    {
-                        p_rgba[0] = ( p_rgba[0] * ao * (255-an) / 255 + r * an ) / p_rgba[3];
-                        p_rgba[1] = ( p_rgba[1] * ao * (255-an) / 255 + g * an ) / p_rgba[3];
-                        p_rgba[2] = ( p_rgba[2] * ao * (255-an) / 255 + b * an ) / p_rgba[3];
-                    }
-                }
-            }
-        }
+        for( int y = 0; y < p_img->h; y++ )
+            pf_blend( &p->p_pixels[(y+p_img->dst_y-i_y) * p->i_pitch + 4 * (p_img->dst_x-i_x)],
+                      &p_img->bitmap[y*p_img->stride], p_img->w, p_img->color );
     }
+    for( int y = 0; y < i_height; y++ )
+        libass_Unpremultiply( &p->p_pixels[y * p->i_pitch], i_width );
 
 #ifdef DEBUG_REGION
     /* XXX Draw a box for debug */
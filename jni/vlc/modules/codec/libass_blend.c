@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * libass_blend.c: ASS_Image compositing for the libass decoder
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <stdint.h>
+#ifdef __ARM_NEON__
+#   include <arm_neon.h>
+#endif
+
+#include "libass_blend.h"
+
+/* x / 255 rounded to nearest, exact for x <= 255 * 255 */
+static inline unsigned Div255( unsigned x )
+{
+    return ( x + 128 + ( ( x + 128 ) >> 8 ) ) >> 8;
+}
+
+/*
+ * With an = opacity * coverage, the source pixel is (c * an, an) once
+ * premultiplied and "over" gives d = c * an + d * (255 - an) for every
+ * component, alpha included with c = 255.
+ */
+void libass_BlendLineC( uint8_t *p_dst, const uint8_t *p_mask,
+                        unsigned i_width, uint32_t i_color )
+{
+    const unsigned r = (i_color >> 24)&0xff;
+    const unsigned g = (i_color >> 16)&0xff;
+    const unsigned b = (i_color >>  8)&0xff;
+    const unsigned o = 255 - (i_color & 0xff);
+
+    for( unsigned x = 0; x < i_width; x++, p_dst += 4 )
+    {
+        const unsigned an = Div255( o * p_mask[x] );
+        const unsigned ian = 255 - an;
+
+        if( an == 0 )
+            continue;
+        p_dst[0] = Div255( r * an + p_dst[0] * ian );
+        p_dst[1] = Div255( g * an + p_dst[1] * ian );
+        p_dst[2] = Div255( b * an + p_dst[2] * ian );
+        p_dst[3] = Div255( 255 * an + p_dst[3] * ian );
+    }
+}
+
+#ifdef __ARM_NEON__
+/* Same rounding as Div255 on 8 lanes: (x + ((x + 128) >> 8) + 128) >> 8 */
+static inline uint8x8_t Div255NEON( uint16x8_t x )
+{
+    return vraddhn_u16( x, vrshrq_n_u16( x, 8 ) );
+}
+
+/* 8 pixels per iteration, bit exact with libass_BlendLineC */
+void libass_BlendLineNEON( uint8_t *p_dst, const uint8_t *p_mask,
+                           unsigned i_width, uint32_t i_color )
+{
+    const uint8x8_t r = vdup_n_u8( (i_color >> 24)&0xff );
+    const uint8x8_t g = vdup_n_u8( (i_color >> 16)&0xff );
+    const uint8x8_t b = vdup_n_u8( (i_color >>  8)&0xff );
+    const uint8x8_t a = vdup_n_u8( 0xff );
+    const uint8x8_t o = vdup_n_u8( 255 - (i_color & 0xff) );
+    unsigned x;
+
+    for( x = 0; x + 8 <= i_width; x += 8, p_dst += 32 )
+    {
+        const uint8x8_t an = Div255NEON( vmull_u8( o, vld1_u8( &p_mask[x] ) ) );
+        const uint8x8_t ian = vmvn_u8( an );
+        uint8x8x4_t d;
+
+        /* nothing to do for fully transparent runs (common around glyphs) */
+        if( vget_lane_u64( vreinterpret_u64_u8( an ), 0 ) == 0 )
+            continue;
+
+        d = vld4_u8( p_dst );
+        d.val[0] = Div255NEON( vmlal_u8( vmull_u8( r, an ), d.val[0], ian ) );
+        d.val[1] = Div255NEON( vmlal_u8( vmull_u8( g, an ), d.val[1], ian ) );
+        d.val[2] = Div255NEON( vmlal_u8( vmull_u8( b, an ), d.val[2], ian ) );
+        d.val[3] = Div255NEON( vmlal_u8( vmull_u8( a, an ), d.val[3], ian ) );
+        vst4_u8( p_dst, d );
+    }
+    if( x < i_width )
+        libass_BlendLineC( p_dst, &p_mask[x], i_width - x, i_color );
+}
+#endif
+
+/* 255 * 65536 / a rounded, computed at compile time */
+#define R1(a) ( (a) ? ( 255u * 65536u + (a) / 2 ) / (a) : 0 )
+#define R4(a) R1(a), R1(a+1), R1(a+2), R1(a+3)
+#define R16(a) R4(a), R4(a+4), R4(a+8), R4(a+12)
+#define R64(a) R16(a), R16(a+16), R16(a+32), R16(a+48)
+static const uint32_t p_unpremultiply[256] = {
+    R64(0), R64(64), R64(128), R64(192)
+};
+#undef R64
+#undef R16
+#undef R4
+#undef R1
+
+void libass_Unpremultiply( uint8_t *p_pixels, unsigned i_width )
+{
+    for( unsigned x = 0; x < i_width; x++, p_pixels += 4 )
+    {
+        const unsigned a = p_pixels[3];
+
+        if( a == 0 || a == 255 )
+            continue;
+        for( int i = 0; i < 3; i++ )
+        {
+            const unsigned c = ( p_pixels[i] * p_unpremultiply[a] + 32768 ) >> 16;
+            p_pixels[i] = c > 255 ? 255 : c;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/*****************************************************************************
+ * libass_blend.h: ASS_Image compositing for the libass decoder
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_LIBASS_BLEND_H
+#define VLC_LIBASS_BLEND_H 1
+
+#include <stdint.h>
+
+/*
+ * The images are composited in premultiplied alpha RGBA (no division per
+ * pixel), the region is converted back to straight alpha once at the end.
+ */
+
+/**
+ * Composite one line of an ASS_Image over a premultiplied RGBA line.
+ *
+ * @param p_dst premultiplied RGBA pixels
+ * @param p_mask the 8 bits coverage of the ASS_Image line
+ * @param i_width number of pixels
+ * @param i_color the ASS_Image color (RRGGBBTT, TT being the transparency)
+ */
+typedef void (*libass_blend_line_t)( uint8_t *p_dst, const uint8_t *p_mask,
+                                    unsigned i_width, uint32_t i_color );
+
+void libass_BlendLineC( uint8_t *, const uint8_t *, unsigned, uint32_t );
+#ifdef __ARM_NEON__
+void libass_BlendLineNEON( uint8_t *, const uint8_t *, unsigned, uint32_t );
+#endif
+
+/**
+ * Convert a premultiplied RGBA line to straight alpha, in place.
+ */
+void libass_Unpremultiply( uint8_t *p_pixels, unsigned i_width );
+
+#endif
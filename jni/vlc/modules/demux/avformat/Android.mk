@@ -24,6 +24,7 @@ LOCAL_C_INCLUDES += \
 
 LOCAL_SRC_FILES := \
     avformat.c \
+    cache.c \
     demux.c
 
 include $(BUILD_STATIC_LIBRARY)
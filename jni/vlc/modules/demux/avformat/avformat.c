@@ -41,6 +41,12 @@ vlc_module_begin ()
     set_shortname( N_("Avformat") )
     set_capability( "demux", 2 )
     set_callbacks( OpenDemux, CloseDemux )
+    add_integer( "avformat-probesize", 0, PROBESIZE_TEXT,
+                 PROBESIZE_LONGTEXT, true )
+    add_integer( "avformat-analyzeduration", 0, ANALYZEDURATION_TEXT,
+                 ANALYZEDURATION_LONGTEXT, true )
+    add_directory( "avformat-probe-cache", NULL, PROBECACHE_TEXT,
+                   PROBECACHE_LONGTEXT, true )
 
 #ifdef ENABLE_SOUT
     /* mux submodule */
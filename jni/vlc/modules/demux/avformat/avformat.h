@@ -28,9 +28,28 @@ void LibavcodecCallback( void *p_opaque, int i_level,
 int  OpenDemux ( vlc_object_t * );
 void CloseDemux( vlc_object_t * );
 
+/* Probe cache */
+struct AVFormatContext;
+char *ProbeCachePath ( demux_t *, const char *psz_url );
+int   ProbeCacheLoad ( demux_t *, struct AVFormatContext *, const char *psz_path );
+void  ProbeCacheStore( demux_t *, struct AVFormatContext *, const char *psz_path );
+
 /* Mux module */
 int  OpenMux ( vlc_object_t * );
 void CloseMux( vlc_object_t * );
 
+#define PROBESIZE_TEXT N_("Probe size")
+#define PROBESIZE_LONGTEXT N_( \
+    "Maximum amount of data in bytes read to find the stream parameters " \
+    "(0 for the libavformat default)." )
+#define ANALYZEDURATION_TEXT N_("Analyze duration")
+#define ANALYZEDURATION_LONGTEXT N_( \
+    "Maximum duration in milliseconds analyzed to find the stream " \
+    "parameters (0 for the libavformat default)." )
+#define PROBECACHE_TEXT N_("Probe cache directory")
+#define PROBECACHE_LONGTEXT N_( \
+    "Directory where the stream parameters found are kept, so that they " \
+    "need not be searched again when the same source is reopened." )
+
 #define MUX_TEXT N_("Ffmpeg mux")
 #define MUX_LONGTEXT N_("Force use of ffmpeg muxer.")
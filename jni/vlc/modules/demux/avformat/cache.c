@@ -0,0 +1,341 @@
+/*****************************************************************************
+ * cache.c: persistent cache of the libavformat stream probing
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_stream.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include <libavformat/avformat.h>
+
+#include "avformat.h"
+
+/* What av_find_stream_info() found, stored per source once it has been
+ * probed, so that reopening the same source skips the probing.
+ *
+ * The file holds, in host byte order:
+ *  - the magic and the libavformat version, any change invalidates it,
+ *  - the format name, the start time and the duration,
+ *  - for each stream its codec parameters and extra data. */
+#define CACHE_MAGIC "VLCAVPC1"
+#define CACHE_EXTRA_MAX (1 << 20)
+/* Bytes at the start of the source that are part of the key */
+#define CACHE_HEAD_SIZE (64 * 1024)
+
+/*****************************************************************************
+ * Key
+ *****************************************************************************/
+
+/* The cache file of the source, NULL without cache directory or without a
+ * way to tell that the source has not changed: local files are identified
+ * by their size and modification time, other sources by their size. The
+ * first bytes of the source, its headers, are part of the key as well, so
+ * that a source replaced by another one of the same size does not reuse
+ * its layout. It must be called before the source is read. */
+char *ProbeCachePath( demux_t *p_demux, const char *psz_url )
+{
+    char *psz_dir = var_InheritString( p_demux, "avformat-probe-cache" );
+    if( !psz_dir || !*psz_dir )
+    {
+        free( psz_dir );
+        return NULL;
+    }
+
+    struct md5_s md5;
+    int64_t i_size = stream_Size( p_demux->s );
+    int64_t i_mtime = 0;
+
+    if( p_demux->psz_file )
+    {
+        struct stat st;
+        if( !vlc_stat( p_demux->psz_file, &st ) )
+        {
+            i_size = st.st_size;
+            i_mtime = st.st_mtime;
+        }
+    }
+    if( i_size <= 0 )
+    {
+        free( psz_dir );
+        return NULL;
+    }
+
+    /* Already in the stream cache once the demuxer starts reading */
+    const uint8_t *p_head;
+    const int i_head = stream_Peek( p_demux->s, &p_head, CACHE_HEAD_SIZE );
+    if( i_head <= 0 )
+    {
+        free( psz_dir );
+        return NULL;
+    }
+
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_url, strlen( psz_url ) );
+    AddMD5( &md5, &i_size, sizeof(i_size) );
+    AddMD5( &md5, &i_mtime, sizeof(i_mtime) );
+    AddMD5( &md5, p_head, i_head );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_path;
+    if( !psz_hash || asprintf( &psz_path, "%s"DIR_SEP"%s", psz_dir, psz_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_hash );
+
+    if( psz_path && vlc_mkdir( psz_dir, 0700 ) && errno != EEXIST )
+        msg_Warn( p_demux, "cannot create %s (%m)", psz_dir );
+    free( psz_dir );
+    return psz_path;
+}
+
+/*****************************************************************************
+ * Serialization
+ *****************************************************************************/
+static void Write32( FILE *p_file, int32_t i_value )
+{
+    fwrite( &i_value, sizeof(i_value), 1, p_file );
+}
+
+static void Write64( FILE *p_file, int64_t i_value )
+{
+    fwrite( &i_value, sizeof(i_value), 1, p_file );
+}
+
+static int Read32( FILE *p_file, int32_t *pi_value )
+{
+    return fread( pi_value, sizeof(*pi_value), 1, p_file ) == 1 ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+static int Read64( FILE *p_file, int64_t *pi_value )
+{
+    return fread( pi_value, sizeof(*pi_value), 1, p_file ) == 1 ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+/* The parameters of a stream, in their on disk order */
+typedef struct
+{
+    int32_t i_codec_type;
+    int32_t i_codec_id;
+    int32_t i_codec_tag;
+    int32_t i_bit_rate;
+    int32_t i_channels;
+    int32_t i_sample_rate;
+    int32_t i_bits_per_coded_sample;
+    int32_t i_block_align;
+    int32_t i_width;
+    int32_t i_height;
+    int32_t i_pix_fmt;
+    int32_t i_time_base_num;
+    int32_t i_time_base_den;
+    int32_t i_ticks_per_frame;
+    int32_t i_extra;
+} cache_stream_t;
+
+/*****************************************************************************
+ * Load
+ *****************************************************************************/
+
+/* Fill the codec contexts of a freshly opened context from the cache
+ * instead of av_find_stream_info(). Nothing is changed unless the cache
+ * matches what the demuxer has already found in the header. */
+int ProbeCacheLoad( demux_t *p_demux, AVFormatContext *ic, const char *psz_path )
+{
+    FILE *p_file = vlc_fopen( psz_path, "rb" );
+    if( !p_file )
+        return VLC_EGENERIC;
+
+    char psz_magic[sizeof(CACHE_MAGIC) - 1];
+    char psz_name[32];
+    int32_t i_version, i_name, i_streams;
+    int64_t i_start_time, i_duration;
+    cache_stream_t *p_streams = NULL;
+    uint8_t **pp_extra = NULL;
+    int i_ret = VLC_EGENERIC;
+
+    if( fread( psz_magic, sizeof(psz_magic), 1, p_file ) != 1 ||
+        memcmp( psz_magic, CACHE_MAGIC, sizeof(psz_magic) ) ||
+        Read32( p_file, &i_version ) || i_version != LIBAVFORMAT_VERSION_INT ||
+        Read32( p_file, &i_name ) || i_name <= 0 || i_name >= (int)sizeof(psz_name) ||
+        fread( psz_name, i_name, 1, p_file ) != 1 ||
+        Read64( p_file, &i_start_time ) || Read64( p_file, &i_duration ) ||
+        Read32( p_file, &i_streams ) )
+        goto exit;
+    psz_name[i_name] = '\0';
+
+    if( strcmp( psz_name, ic->iformat->name ) ||
+        i_streams <= 0 || (unsigned)i_streams != ic->nb_streams )
+        goto exit;
+
+    p_streams = calloc( i_streams, sizeof(*p_streams) );
+    pp_extra = calloc( i_streams, sizeof(*pp_extra) );
+    if( !p_streams || !pp_extra )
+        goto exit;
+
+    /* Read and check everything before touching the context */
+    for( int i = 0; i < i_streams; i++ )
+    {
+        cache_stream_t *p = &p_streams[i];
+        const AVCodecContext *cc = ic->streams[i]->codec;
+
+        if( fread( p, sizeof(*p), 1, p_file ) != 1 ||
+            p->i_extra < 0 || p->i_extra > CACHE_EXTRA_MAX ||
+            p->i_codec_id == CODEC_ID_NONE ||
+            ( cc->codec_type != AVMEDIA_TYPE_UNKNOWN &&
+              cc->codec_type != p->i_codec_type ) ||
+            ( cc->codec_id != CODEC_ID_NONE && cc->codec_id != p->i_codec_id ) )
+            goto exit;
+
+        if( p->i_extra > 0 )
+        {
+            pp_extra[i] = av_mallocz( p->i_extra + FF_INPUT_BUFFER_PADDING_SIZE );
+            if( !pp_extra[i] || fread( pp_extra[i], p->i_extra, 1, p_file ) != 1 )
+                goto exit;
+        }
+    }
+
+    for( int i = 0; i < i_streams; i++ )
+    {
+        const cache_stream_t *p = &p_streams[i];
+        AVCodecContext *cc = ic->streams[i]->codec;
+
+        cc->codec_type = p->i_codec_type;
+        cc->codec_id = p->i_codec_id;
+        cc->codec_tag = p->i_codec_tag;
+        cc->bit_rate = p->i_bit_rate;
+        cc->channels = p->i_channels;
+        cc->sample_rate = p->i_sample_rate;
+        cc->bits_per_coded_sample = p->i_bits_per_coded_sample;
+        cc->block_align = p->i_block_align;
+        cc->width = p->i_width;
+        cc->height = p->i_height;
+        cc->pix_fmt = p->i_pix_fmt;
+        cc->time_base.num = p->i_time_base_num;
+        cc->time_base.den = p->i_time_base_den;
+        cc->ticks_per_frame = p->i_ticks_per_frame;
+        if( pp_extra[i] )
+        {
+            av_free( cc->extradata );
+            cc->extradata = pp_extra[i];
+            cc->extradata_size = p->i_extra;
+            pp_extra[i] = NULL;
+        }
+    }
+    ic->start_time = i_start_time;
+    ic->duration = i_duration;
+
+    msg_Dbg( p_demux, "stream layout loaded from %s", psz_path );
+    i_ret = VLC_SUCCESS;
+
+exit:
+    if( pp_extra )
+    {
+        for( int i = 0; i < i_streams; i++ )
+            av_free( pp_extra[i] );
+        free( pp_extra );
+    }
+    free( p_streams );
+    fclose( p_file );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Store
+ *****************************************************************************/
+
+/* Save the probed layout, written aside and renamed so that concurrent
+ * readers never see a partial file */
+void ProbeCacheStore( demux_t *p_demux, AVFormatContext *ic, const char *psz_path )
+{
+    const size_t i_name = strlen( ic->iformat->name );
+    char *psz_tmp;
+
+    if( ic->nb_streams <= 0 || i_name >= 32 )
+        return;
+    for( unsigned i = 0; i < ic->nb_streams; i++ )
+    {
+        /* Not worth remembering an incomplete probe */
+        if( ic->streams[i]->codec->codec_id == CODEC_ID_NONE )
+            return;
+    }
+
+    if( asprintf( &psz_tmp, "%s.%p", psz_path, (void *)p_demux ) == -1 )
+        return;
+    FILE *p_file = vlc_fopen( psz_tmp, "wb" );
+    if( !p_file )
+    {
+        free( psz_tmp );
+        return;
+    }
+
+    fwrite( CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1, 1, p_file );
+    Write32( p_file, LIBAVFORMAT_VERSION_INT );
+    Write32( p_file, i_name );
+    fwrite( ic->iformat->name, i_name, 1, p_file );
+    Write64( p_file, ic->start_time );
+    Write64( p_file, ic->duration );
+    Write32( p_file, ic->nb_streams );
+
+    for( unsigned i = 0; i < ic->nb_streams; i++ )
+    {
+        const AVCodecContext *cc = ic->streams[i]->codec;
+        const cache_stream_t stream = {
+            .i_codec_type = cc->codec_type,
+            .i_codec_id = cc->codec_id,
+            .i_codec_tag = cc->codec_tag,
+            .i_bit_rate = cc->bit_rate,
+            .i_channels = cc->channels,
+            .i_sample_rate = cc->sample_rate,
+            .i_bits_per_coded_sample = cc->bits_per_coded_sample,
+            .i_block_align = cc->block_align,
+            .i_width = cc->width,
+            .i_height = cc->height,
+            .i_pix_fmt = cc->pix_fmt,
+            .i_time_base_num = cc->time_base.num,
+            .i_time_base_den = cc->time_base.den,
+            .i_ticks_per_frame = cc->ticks_per_frame,
+            .i_extra = cc->extradata ? __MIN( cc->extradata_size, CACHE_EXTRA_MAX ) : 0,
+        };
+        fwrite( &stream, sizeof(stream), 1, p_file );
+        if( stream.i_extra > 0 )
+            fwrite( cc->extradata, stream.i_extra, 1, p_file );
+    }
+
+    const bool b_error = ferror( p_file );
+    if( fclose( p_file ) || b_error || vlc_rename( psz_tmp, psz_path ) )
+    {
+        msg_Warn( p_demux, "cannot write %s", psz_path );
+        vlc_unlink( psz_tmp );
+    }
+    else
+        msg_Dbg( p_demux, "stream layout saved to %s", psz_path );
+    free( psz_tmp );
+}
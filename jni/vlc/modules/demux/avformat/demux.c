@@ -48,6 +48,14 @@
 
 //#define AVFORMAT_DEBUG 1
 
+/* I/O buffer of local files and of other sources */
+#define IO_BUFFER_FILE      (256 * 1024)
+#define IO_BUFFER_NETWORK   (64 * 1024)
+/* Remote sources are read by about this duration of data at once */
+#define IO_READ_DURATION    (CLOCK_FREQ / 4)
+#define IO_READ_MIN         (4 * 1024)
+#define IO_READ_DEFAULT     (32 * 1024)
+
 /* Version checking */
 #if defined(HAVE_FFMPEG_AVFORMAT_H) || defined(HAVE_LIBAVFORMAT_AVFORMAT_H)
 
@@ -63,6 +71,7 @@ struct demux_sys_t
     ByteIOContext   io;
     int             io_buffer_size;
     uint8_t        *io_buffer;
+    int             io_read_size;
 
     AVInputFormat  *fmt;
     AVFormatContext *ic;
@@ -93,6 +102,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args );
 
 static int IORead( void *opaque, uint8_t *buf, int buf_size );
 static int64_t IOSeek( void *opaque, int64_t offset, int whence );
+static void IOSetReadSize( demux_t *p_demux );
+
+static block_t *PacketBlockNew( AVPacket *p_pkt );
 
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order );
 static void UpdateSeekPoint( demux_t *p_demux, int64_t i_time );
@@ -110,6 +122,7 @@ int OpenDemux( vlc_object_t *p_this )
     int64_t       i_start_time = -1;
     bool          b_can_seek;
     char         *psz_url;
+    char         *psz_cache;
 
     if( p_demux->psz_file )
         psz_url = strdup( p_demux->psz_file );
@@ -198,8 +211,9 @@ int OpenDemux( vlc_object_t *p_this )
     p_sys->p_title = NULL;
 
     /* Create I/O wrapper */
-    p_sys->io_buffer_size = 32768;  /* FIXME */
+    p_sys->io_buffer_size = p_demux->psz_file ? IO_BUFFER_FILE : IO_BUFFER_NETWORK;
     p_sys->io_buffer = malloc( p_sys->io_buffer_size );
+    p_sys->io_read_size = p_demux->psz_file ? p_sys->io_buffer_size : IO_READ_DEFAULT;
     p_sys->url.priv_data = p_demux;
     p_sys->url.prot = &p_sys->prot;
     p_sys->url.prot->name = "VLC I/O wrapper";
@@ -229,11 +243,15 @@ int OpenDemux( vlc_object_t *p_this )
     }
 
 
+    /* Its key is made of the first bytes, they are peeked before reading */
+    psz_cache = ProbeCachePath( p_demux, psz_url );
+
     /* Open it */
     if( av_open_input_stream( &p_sys->ic, &p_sys->io, psz_url,
                               p_sys->fmt, NULL ) )
     {
         msg_Err( p_demux, "av_open_input_stream failed" );
+        free( psz_cache );
         free( psz_url );
         CloseDemux( p_this );
         return VLC_EGENERIC;
@@ -241,12 +259,29 @@ int OpenDemux( vlc_object_t *p_this )
     free( psz_url );
     psz_url = NULL;
 
-    vlc_avcodec_lock(); /* avformat calls avcodec behind our back!!! */
-    if( av_find_stream_info( p_sys->ic ) < 0 )
+    /* Bound the probing, it reads and decodes ahead of the first frame */
+    const int i_probesize = var_InheritInteger( p_demux, "avformat-probesize" );
+    const int i_analyzeduration = var_InheritInteger( p_demux, "avformat-analyzeduration" );
+    if( i_probesize > 0 )
+        p_sys->ic->probesize = i_probesize;
+    if( i_analyzeduration > 0 )
+        p_sys->ic->max_analyze_duration = (int64_t)i_analyzeduration * AV_TIME_BASE / 1000;
+
+    if( !psz_cache || ProbeCacheLoad( p_demux, p_sys->ic, psz_cache ) )
     {
-        msg_Warn( p_demux, "av_find_stream_info failed" );
+        int i_ret;
+
+        vlc_avcodec_lock(); /* avformat calls avcodec behind our back!!! */
+        i_ret = av_find_stream_info( p_sys->ic );
+        vlc_avcodec_unlock();
+
+        if( i_ret < 0 )
+            msg_Warn( p_demux, "av_find_stream_info failed" );
+        else if( psz_cache )
+            ProbeCacheStore( p_demux, p_sys->ic, psz_cache );
     }
-    vlc_avcodec_unlock();
+    free( psz_cache );
+    IOSetReadSize( p_demux );
 
     for( i = 0; i < p_sys->ic->nb_streams; i++ )
     {
@@ -556,7 +591,7 @@ static int Demux( demux_t *p_demux )
             return 1;
         }
     }
-    else
+    else if( ( p_frame = PacketBlockNew( &pkt ) ) == NULL )
     {
         if( ( p_frame = block_New( p_demux, pkt.size ) ) == NULL )
         {
@@ -635,6 +670,44 @@ static void UpdateSeekPoint( demux_t *p_demux, int64_t i_time )
     }
 }
 
+/* Blocks pointing to the data of a packet, which is freed with them */
+typedef struct
+{
+    block_t  self;
+    AVPacket packet;
+} packet_block_t;
+
+static void PacketBlockRelease( block_t *p_block )
+{
+    packet_block_t *p_pb = (packet_block_t *)p_block;
+
+    av_free_packet( &p_pb->packet );
+    free( p_pb );
+}
+
+/* Hand the packet data over to a block without copying it. The data of
+ * packets owning it has been padded and zeroed by libavformat, so the
+ * decoders need not reallocate it. On success p_pkt does not own the data
+ * anymore but its other fields are left untouched. */
+static block_t *PacketBlockNew( AVPacket *p_pkt )
+{
+    if( p_pkt->size <= 0 || av_dup_packet( p_pkt ) ||
+        p_pkt->destruct != av_destruct_packet )
+        return NULL;
+
+    packet_block_t *p_pb = malloc( sizeof(*p_pb) );
+    if( !p_pb )
+        return NULL;
+
+    p_pb->packet = *p_pkt;
+    block_Init( &p_pb->self, p_pkt->data, p_pkt->size );
+    p_pb->self.pf_release = PacketBlockRelease;
+    p_pb->self.i_flags = BLOCK_FLAG_PADDED;
+
+    p_pkt->destruct = NULL;
+    return &p_pb->self;
+}
+
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order )
 {
     if( p_pkt->size <= 0 )
@@ -862,10 +935,41 @@ static int IORead( void *opaque, uint8_t *buf, int buf_size )
     URLContext *p_url = opaque;
     demux_t *p_demux = p_url->priv_data;
     if( buf_size < 0 ) return -1;
+    /* libavformat copes with short reads, they only wait for less data */
+    if( buf_size > p_demux->p_sys->io_read_size )
+        buf_size = p_demux->p_sys->io_read_size;
     int i_ret = stream_Read( p_demux->s, buf, buf_size );
     return i_ret ? i_ret : -1;
 }
 
+/* Size the reads from the bitrate once it is known: a remote source is
+ * read by IO_READ_DURATION of data at once, so that a large read on a slow
+ * link does not delay the packets already received */
+static void IOSetReadSize( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const AVFormatContext *ic = p_sys->ic;
+    int64_t i_bitrate = ic->bit_rate;
+
+    if( p_demux->psz_file )
+        return;
+
+    if( i_bitrate <= 0 )
+    {
+        for( unsigned i = 0; i < ic->nb_streams; i++ )
+            i_bitrate += ic->streams[i]->codec->bit_rate;
+    }
+    if( i_bitrate <= 0 && ic->duration > 0 && ic->duration != (int64_t)AV_NOPTS_VALUE )
+        i_bitrate = stream_Size( p_demux->s ) * 8 * AV_TIME_BASE / ic->duration;
+    if( i_bitrate <= 0 )
+        return;
+
+    const int64_t i_size = i_bitrate / 8 * IO_READ_DURATION / CLOCK_FREQ;
+    p_sys->io_read_size = __MAX( __MIN( i_size, p_sys->io_buffer_size ), IO_READ_MIN );
+    msg_Dbg( p_demux, "reading by %d bytes (%"PRId64" kbit/s)",
+             p_sys->io_read_size, i_bitrate / 1000 );
+}
+
 static int64_t IOSeek( void *opaque, int64_t offset, int whence )
 {
     URLContext *p_url = opaque;
@@ -0,0 +1,1238 @@
+/*****************************************************************************
+ * flv.c: Flash Video demuxer
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_demux.h>
+#include <vlc_access.h>
+#include <vlc_charset.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+vlc_module_begin ()
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_DEMUX )
+    set_description( N_("FLV demuxer") )
+    set_capability( "demux", 150 )
+    set_callbacks( Open, Close )
+    add_shortcut( "flv" )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Demux  ( demux_t * );
+static int Control( demux_t *, int, va_list );
+
+#define FLV_TAG_AUDIO   8
+#define FLV_TAG_VIDEO   9
+#define FLV_TAG_SCRIPT  18
+
+/* "FLV", version, flags and the size of the header */
+#define FLV_HEADER_SIZE     9
+/* Larger header sizes are bogus */
+#define FLV_HEADER_SIZE_MAX 1024
+
+/* Tag header, plus the first byte of the data used to validate it */
+#define FLV_TAG_HEADER_SIZE 11
+#define FLV_TAG_CHECK_SIZE  (FLV_TAG_HEADER_SIZE + 1)
+/* Each tag is followed by its own size */
+#define FLV_TAG_FOOTER_SIZE 4
+
+/* Maximum number of bytes skipped to find a tag after a lost sync */
+#define FLV_RESYNC_MAX      (1024 * 1024)
+#define FLV_RESYNC_PEEK     4096
+
+/* Minimum interval between two index entries built from audio only files */
+#define FLV_INDEX_INTERVAL  CLOCK_FREQ
+
+typedef struct
+{
+    int      i_type;
+    uint32_t i_size;    /* of the data */
+    mtime_t  i_time;    /* in microseconds */
+    int64_t  i_offset;  /* of the header */
+} flv_tag_t;
+
+/* Seek index: the tag offset of the key frames */
+typedef struct
+{
+    mtime_t i_time;
+    int64_t i_offset;
+} flv_index_entry_t;
+
+typedef struct
+{
+    int               i_entry;
+    int               i_entry_max;
+    flv_index_entry_t *p_entry;
+} flv_index_t;
+
+static void IndexInit( flv_index_t * );
+static void IndexClean( flv_index_t * );
+static void IndexAppend( flv_index_t *, mtime_t i_time, int64_t i_offset );
+static const flv_index_entry_t *IndexFind( const flv_index_t *, mtime_t i_time );
+
+typedef struct
+{
+    es_out_id_t *p_es;
+    es_format_t fmt;
+    mtime_t     i_dts;  /* of the last block sent */
+} flv_track_t;
+
+struct demux_sys_t
+{
+    flv_track_t audio;
+    flv_track_t video;
+
+    int64_t     i_data_start;
+    mtime_t     i_pcr;
+    mtime_t     i_time;
+    mtime_t     i_length;
+    double      f_fps;
+    bool        b_seekable;
+
+    /* The index comes from onMetaData when it has one (it is then complete),
+     * otherwise it is built while playing */
+    flv_index_t index;
+    bool        b_index_complete;
+
+    /* Concatenated files (see the concat access): each segment starts with
+     * its own header and timestamps, that are shifted to follow the
+     * previous segment */
+    int         i_segment;
+    int64_t     i_segment_base;     /* offset of its header */
+    mtime_t     i_segment_time;     /* added to its timestamps */
+    mtime_t     i_segment_length;   /* from its onMetaData, 0 if unknown */
+    mtime_t     i_segment_end;      /* largest timestamp seen */
+
+    /* Durations of all the segments, when given with them */
+    int         i_duration;
+    mtime_t     *pi_duration;
+};
+
+static int  TagHeaderRead( demux_t *, flv_tag_t * );
+static void DemuxAudio( demux_t *, const flv_tag_t *, block_t * );
+static void DemuxVideo( demux_t *, const flv_tag_t *, block_t * );
+static void MetaDataParse( demux_t *, const uint8_t *, size_t );
+static int  Seek( demux_t *, mtime_t i_time );
+static int  SegmentStart( demux_t *, mtime_t i_time );
+static int  SegmentNext( demux_t * );
+static mtime_t SegmentTime( const demux_sys_t *, int i_segment );
+static int  SegmentFind( const demux_sys_t *, mtime_t i_time );
+static void DurationsParse( demux_t * );
+static bool IsHeader( const uint8_t * );
+
+/*****************************************************************************
+ * Open: check file and initializes structures
+ *****************************************************************************/
+static int Open( vlc_object_t * p_this )
+{
+    demux_t     *p_demux = (demux_t*)p_this;
+    demux_sys_t *p_sys;
+    const uint8_t *p_peek;
+
+    /* "FLV", version 1, flags, header size */
+    if( stream_Peek( p_demux->s, &p_peek, FLV_HEADER_SIZE ) < FLV_HEADER_SIZE ||
+        !IsHeader( p_peek ) )
+        return VLC_EGENERIC;
+
+    p_sys = malloc( sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_sys->audio.p_es = NULL;
+    es_format_Init( &p_sys->audio.fmt, UNKNOWN_ES, 0 );
+    p_sys->audio.i_dts = VLC_TS_INVALID;
+    p_sys->video.p_es = NULL;
+    es_format_Init( &p_sys->video.fmt, UNKNOWN_ES, 0 );
+    p_sys->video.i_dts = VLC_TS_INVALID;
+    p_sys->i_pcr = VLC_TS_INVALID;
+    p_sys->i_time = 0;
+    p_sys->i_length = 0;
+    p_sys->f_fps = 0.0;
+    stream_Control( p_demux->s, STREAM_CAN_SEEK, &p_sys->b_seekable );
+    IndexInit( &p_sys->index );
+    p_sys->b_index_complete = false;
+    p_sys->i_segment = 0;
+    p_sys->i_duration = 0;
+    p_sys->pi_duration = NULL;
+
+    p_demux->pf_demux = Demux;
+    p_demux->pf_control = Control;
+    p_demux->p_sys = p_sys;
+
+    DurationsParse( p_demux );
+    if( SegmentStart( p_demux, 0 ) )
+    {
+        Close( p_this );
+        return VLC_EGENERIC;
+    }
+    p_sys->i_data_start = stream_Tell( p_demux->s );
+
+    msg_Dbg( p_demux, "FLV length %"PRId64"s, %d index entries%s, %d segments",
+             p_sys->i_length / CLOCK_FREQ, p_sys->index.i_entry,
+             p_sys->b_index_complete ? " (onMetaData)" : "",
+             __MAX( p_sys->i_duration, 1 ) );
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Close: frees unused data
+ *****************************************************************************/
+static void Close( vlc_object_t * p_this )
+{
+    demux_t     *p_demux = (demux_t*)p_this;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    es_format_Clean( &p_sys->audio.fmt );
+    es_format_Clean( &p_sys->video.fmt );
+    IndexClean( &p_sys->index );
+    free( p_sys->pi_duration );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Demux: reads and demuxes one tag
+ *****************************************************************************
+ * Returns -1 in case of error, 0 in case of EOF, 1 otherwise
+ *****************************************************************************/
+static int Demux( demux_t *p_demux )
+{
+    flv_tag_t tag;
+    block_t *p_data;
+
+    if( TagHeaderRead( p_demux, &tag ) )
+        return 0;
+
+    /* The size of the tag that follows the data is not needed */
+    p_data = stream_Block( p_demux->s, tag.i_size + FLV_TAG_FOOTER_SIZE );
+    if( !p_data )
+        return 0;
+    if( p_data->i_buffer < tag.i_size )
+    {
+        block_Release( p_data );
+        return 0;
+    }
+    p_data->i_buffer = tag.i_size;
+    p_demux->p_sys->i_time = tag.i_time;
+    if( tag.i_time > p_demux->p_sys->i_segment_end )
+        p_demux->p_sys->i_segment_end = tag.i_time;
+
+    switch( tag.i_type )
+    {
+    case FLV_TAG_AUDIO:
+        DemuxAudio( p_demux, &tag, p_data );
+        break;
+    case FLV_TAG_VIDEO:
+        DemuxVideo( p_demux, &tag, p_data );
+        break;
+    default:
+        MetaDataParse( p_demux, p_data->p_buffer, p_data->i_buffer );
+        block_Release( p_data );
+        break;
+    }
+    return 1;
+}
+
+/*****************************************************************************
+ * Control:
+ *****************************************************************************/
+static int Control( demux_t *p_demux, int i_query, va_list args )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int64_t i_size = stream_Size( p_demux->s );
+    double f, *pf;
+    int64_t *pi64;
+
+    switch( i_query )
+    {
+    case DEMUX_GET_POSITION:
+        pf = (double*)va_arg( args, double * );
+        if( p_sys->i_length > 0 )
+            *pf = (double)p_sys->i_time / (double)p_sys->i_length;
+        else if( i_size > p_sys->i_data_start )
+            *pf = (double)( stream_Tell( p_demux->s ) - p_sys->i_data_start ) /
+                  (double)( i_size - p_sys->i_data_start );
+        else
+            *pf = 0.0;
+        return VLC_SUCCESS;
+
+    case DEMUX_SET_POSITION:
+        f = (double)va_arg( args, double );
+        if( p_sys->i_length > 0 )
+            return Seek( p_demux, f * p_sys->i_length );
+        if( !p_sys->b_seekable || i_size <= p_sys->i_data_start )
+            return VLC_EGENERIC;
+
+        /* No length, no time: the next tag after the byte position */
+        if( stream_Seek( p_demux->s, p_sys->i_data_start +
+                         f * ( i_size - p_sys->i_data_start ) ) )
+            return VLC_EGENERIC;
+        p_sys->i_pcr = VLC_TS_INVALID;
+        p_sys->audio.i_dts = p_sys->video.i_dts = VLC_TS_INVALID;
+        return VLC_SUCCESS;
+
+    case DEMUX_GET_TIME:
+        pi64 = (int64_t*)va_arg( args, int64_t * );
+        *pi64 = p_sys->i_time;
+        return VLC_SUCCESS;
+
+    case DEMUX_SET_TIME:
+        return Seek( p_demux, (int64_t)va_arg( args, int64_t ) );
+
+    case DEMUX_GET_LENGTH:
+        pi64 = (int64_t*)va_arg( args, int64_t * );
+        if( p_sys->i_length <= 0 )
+            return VLC_EGENERIC;
+        *pi64 = p_sys->i_length;
+        return VLC_SUCCESS;
+
+    case DEMUX_GET_FPS:
+        pf = (double*)va_arg( args, double * );
+        if( p_sys->f_fps <= 0.0 )
+            return VLC_EGENERIC;
+        *pf = p_sys->f_fps;
+        return VLC_SUCCESS;
+
+    default:
+        return VLC_EGENERIC;
+    }
+}
+
+/*****************************************************************************
+ * Seek: to the last key frame before i_time
+ *****************************************************************************/
+static int Seek( demux_t *p_demux, mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int64_t i_size = stream_Size( p_demux->s );
+    int64_t i_offset;
+    bool b_switched = false;
+
+    if( !p_sys->b_seekable )
+        return VLC_EGENERIC;
+
+    /* Another segment: the access knows where it starts */
+    const int i_segment = SegmentFind( p_sys, i_time );
+    if( i_segment >= 0 && i_segment != p_sys->i_segment )
+    {
+        if( stream_Control( p_demux->s, STREAM_CONTROL_ACCESS,
+                            ACCESS_SET_SEEKPOINT, i_segment ) )
+            return VLC_EGENERIC;
+        p_sys->i_segment = i_segment;
+        if( SegmentStart( p_demux, SegmentTime( p_sys, i_segment ) ) )
+            return VLC_EGENERIC;
+
+        p_sys->i_pcr = VLC_TS_INVALID;
+        p_sys->audio.i_dts = p_sys->video.i_dts = VLC_TS_INVALID;
+        p_sys->i_time = p_sys->i_segment_time;
+        if( i_time - p_sys->i_segment_time < FLV_INDEX_INTERVAL )
+            return VLC_SUCCESS;
+        b_switched = true;
+    }
+
+    const flv_index_entry_t *p_entry = IndexFind( &p_sys->index, i_time );
+    const flv_index_entry_t *p_last = p_sys->index.i_entry > 0 ?
+        &p_sys->index.p_entry[p_sys->index.i_entry - 1] : NULL;
+
+    if( p_entry && ( p_sys->b_index_complete || p_entry != p_last ||
+                     i_time - p_last->i_time < FLV_INDEX_INTERVAL ) )
+    {
+        /* One seek straight to the key frame tag */
+        i_offset = p_entry->i_offset;
+    }
+    else if( p_sys->i_duration <= 0 && p_sys->i_length > 0 &&
+             i_size > p_sys->i_data_start )
+    {
+        /* Past what has been indexed: estimate the offset from the
+         * length, the next tag will be found from there */
+        i_offset = p_sys->i_data_start +
+                   (double)i_time / p_sys->i_length * ( i_size - p_sys->i_data_start );
+        if( p_last && i_offset < p_last->i_offset )
+            i_offset = p_last->i_offset;
+    }
+    else if( p_entry )
+    {
+        i_offset = p_entry->i_offset;
+    }
+    else
+    {
+        /* Without an index, the start of the new segment is the best that
+         * can be done, and the stream is already there */
+        return b_switched ? VLC_SUCCESS : VLC_EGENERIC;
+    }
+
+    if( stream_Seek( p_demux->s, i_offset ) )
+        return b_switched ? VLC_SUCCESS : VLC_EGENERIC;
+
+    p_sys->i_pcr = VLC_TS_INVALID;
+    p_sys->audio.i_dts = p_sys->video.i_dts = VLC_TS_INVALID;
+    p_sys->i_time = p_entry && i_offset == p_entry->i_offset ? p_entry->i_time : i_time;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Segments
+ *****************************************************************************/
+static bool IsHeader( const uint8_t *p )
+{
+    const uint32_t i_header_size = GetDWBE( &p[5] );
+
+    return !memcmp( p, "FLV", 3 ) && p[3] == 1 &&
+           i_header_size >= FLV_HEADER_SIZE && i_header_size < FLV_HEADER_SIZE_MAX;
+}
+
+/* Read the header of a segment and its onMetaData, its timestamps will
+ * start at i_time */
+static int SegmentStart( demux_t *p_demux, mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_peek;
+    flv_tag_t tag;
+
+    if( stream_Peek( p_demux->s, &p_peek, FLV_HEADER_SIZE ) < FLV_HEADER_SIZE ||
+        !IsHeader( p_peek ) )
+        return VLC_EGENERIC;
+
+    const uint32_t i_header_size = GetDWBE( &p_peek[5] );
+    p_sys->i_segment_base = stream_Tell( p_demux->s );
+    if( stream_Read( p_demux->s, NULL, i_header_size + FLV_TAG_FOOTER_SIZE ) !=
+        (int)(i_header_size + FLV_TAG_FOOTER_SIZE) )
+        return VLC_EGENERIC;
+
+    p_sys->i_segment_time = i_time;
+    p_sys->i_segment_length = 0;
+    p_sys->i_segment_end = i_time;
+    IndexClean( &p_sys->index );
+    p_sys->b_index_complete = false;
+
+    /* Load onMetaData now, so that the length and the index are known
+     * before the first seek */
+    if( stream_Peek( p_demux->s, &p_peek, 1 ) == 1 &&
+        p_peek[0] == FLV_TAG_SCRIPT && !TagHeaderRead( p_demux, &tag ) )
+    {
+        block_t *p_data = stream_Block( p_demux->s, tag.i_size + FLV_TAG_FOOTER_SIZE );
+        if( p_data )
+        {
+            MetaDataParse( p_demux, p_data->p_buffer,
+                           __MIN( p_data->i_buffer, tag.i_size ) );
+            block_Release( p_data );
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+/* A new header where a tag was expected: the next segment */
+static int SegmentNext( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mtime_t i_time;
+
+    if( p_sys->i_segment + 1 < p_sys->i_duration )
+        i_time = SegmentTime( p_sys, p_sys->i_segment + 1 );
+    else if( p_sys->i_segment_length > 0 )
+        i_time = p_sys->i_segment_time + p_sys->i_segment_length;
+    else
+        i_time = p_sys->i_segment_end;
+    /* Never go back in time */
+    i_time = __MAX( i_time, p_sys->i_segment_end );
+
+    p_sys->i_segment++;
+    msg_Dbg( p_demux, "segment %d starts at %"PRId64"ms",
+             p_sys->i_segment + 1, i_time / 1000 );
+    return SegmentStart( p_demux, i_time );
+}
+
+/* Start time of a segment from the given durations */
+static mtime_t SegmentTime( const demux_sys_t *p_sys, int i_segment )
+{
+    mtime_t i_time = 0;
+
+    for( int i = 0; i < i_segment && i < p_sys->i_duration; i++ )
+        i_time += p_sys->pi_duration[i];
+    return i_time;
+}
+
+/* Segment containing i_time, -1 without durations */
+static int SegmentFind( const demux_sys_t *p_sys, mtime_t i_time )
+{
+    mtime_t i_end = 0;
+
+    for( int i = 0; i < p_sys->i_duration; i++ )
+    {
+        i_end += p_sys->pi_duration[i];
+        if( i_time < i_end )
+            return i;
+    }
+    return p_sys->i_duration - 1;
+}
+
+/* Comma separated durations in seconds of the concatenated segments */
+static void DurationsParse( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    char *psz_durations = var_InheritString( p_demux, "concat-durations" );
+    const char *psz = psz_durations;
+
+    while( psz && *psz )
+    {
+        char *psz_end;
+        const double f_duration = us_strtod( psz, &psz_end );
+        if( psz_end == psz || f_duration <= 0.0 )
+            break;
+
+        mtime_t *pi_duration = realloc( p_sys->pi_duration,
+                                        ( p_sys->i_duration + 1 ) * sizeof(*pi_duration) );
+        if( !pi_duration )
+            break;
+        p_sys->pi_duration = pi_duration;
+        p_sys->pi_duration[p_sys->i_duration++] = f_duration * CLOCK_FREQ;
+        psz = *psz_end == ',' ? psz_end + 1 : NULL;
+    }
+    free( psz_durations );
+
+    if( p_sys->i_duration > 0 )
+        p_sys->i_length = SegmentTime( p_sys, p_sys->i_duration );
+}
+
+/*****************************************************************************
+ * Tags
+ *****************************************************************************/
+static bool TagHeaderCheck( const uint8_t *p )
+{
+    const uint32_t i_size = ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+
+    /* The stream id is always 0 */
+    if( i_size == 0 || p[8] || p[9] || p[10] )
+        return false;
+
+    switch( p[0] )
+    {
+    case FLV_TAG_AUDIO:
+        /* 9, 12 and 13 are reserved */
+        return ( p[11] >> 4 ) != 9 && ( p[11] >> 4 ) != 12 && ( p[11] >> 4 ) != 13;
+    case FLV_TAG_VIDEO:
+        /* Frame type 1-5, codec 2-7 */
+        return ( p[11] >> 4 ) >= 1 && ( p[11] >> 4 ) <= 5 &&
+               ( p[11] & 0x0f ) >= 2 && ( p[11] & 0x0f ) <= 7;
+    case FLV_TAG_SCRIPT:
+        return p[11] == 0x02; /* AMF string */
+    default:
+        return false;
+    }
+}
+
+static int Resync( demux_t *p_demux )
+{
+    msg_Warn( p_demux, "lost sync, looking for the next tag" );
+
+    for( int i_skipped = 0; i_skipped < FLV_RESYNC_MAX; )
+    {
+        const uint8_t *p_peek;
+        const int i_peek = stream_Peek( p_demux->s, &p_peek, FLV_RESYNC_PEEK );
+        int i;
+
+        if( i_peek < FLV_TAG_CHECK_SIZE )
+            return VLC_EGENERIC;
+
+        for( i = 1; i + FLV_TAG_CHECK_SIZE <= i_peek; i++ )
+        {
+            if( TagHeaderCheck( &p_peek[i] ) || IsHeader( &p_peek[i] ) )
+                break;
+        }
+        if( stream_Read( p_demux->s, NULL, i ) != i )
+            return VLC_EGENERIC;
+        if( i + FLV_TAG_CHECK_SIZE <= i_peek )
+            return VLC_SUCCESS;
+        i_skipped += i;
+    }
+    return VLC_EGENERIC;
+}
+
+static int TagHeaderRead( demux_t *p_demux, flv_tag_t *p_tag )
+{
+    const uint8_t *p_peek;
+
+    for( ;; )
+    {
+        if( stream_Peek( p_demux->s, &p_peek, FLV_TAG_CHECK_SIZE ) < FLV_TAG_CHECK_SIZE )
+            return VLC_EGENERIC;
+        if( TagHeaderCheck( p_peek ) )
+            break;
+        if( IsHeader( p_peek ) )
+        {
+            if( SegmentNext( p_demux ) )
+                return VLC_EGENERIC;
+            continue;
+        }
+        if( Resync( p_demux ) )
+            return VLC_EGENERIC;
+    }
+
+    p_tag->i_type = p_peek[0];
+    p_tag->i_size = ( p_peek[1] << 16 ) | ( p_peek[2] << 8 ) | p_peek[3];
+    /* Milliseconds on 24 bits, extended by the 8 upper bits */
+    p_tag->i_time = p_demux->p_sys->i_segment_time +
+                    (mtime_t)( ( (uint32_t)p_peek[7] << 24 ) | ( p_peek[4] << 16 ) |
+                               ( p_peek[5] << 8 ) | p_peek[6] ) * 1000;
+    p_tag->i_offset = stream_Tell( p_demux->s );
+
+    if( stream_Read( p_demux->s, NULL, FLV_TAG_HEADER_SIZE ) != FLV_TAG_HEADER_SIZE )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
+/* (Re)create the ES of a track when its format changes, takes p_fmt */
+static void TrackSetFormat( demux_t *p_demux, flv_track_t *p_track, es_format_t *p_fmt )
+{
+    const es_format_t *p_old = &p_track->fmt;
+
+    if( p_track->p_es &&
+        p_old->i_codec == p_fmt->i_codec &&
+        p_old->audio.i_rate == p_fmt->audio.i_rate &&
+        p_old->audio.i_channels == p_fmt->audio.i_channels &&
+        p_old->i_extra == p_fmt->i_extra &&
+        ( p_fmt->i_extra <= 0 || !memcmp( p_old->p_extra, p_fmt->p_extra, p_fmt->i_extra ) ) )
+    {
+        es_format_Clean( p_fmt );
+        return;
+    }
+
+    if( p_track->p_es )
+    {
+        msg_Dbg( p_demux, "format change for codec %4.4s", (const char *)&p_fmt->i_codec );
+        es_out_Del( p_demux->out, p_track->p_es );
+    }
+    es_format_Clean( &p_track->fmt );
+    p_track->fmt = *p_fmt;
+    p_track->p_es = es_out_Add( p_demux->out, &p_track->fmt );
+}
+
+static void TrackSend( demux_t *p_demux, flv_track_t *p_track, block_t *p_block )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mtime_t i_pcr = p_block->i_dts;
+
+    /* The audio and video tags are only roughly interleaved: follow the
+     * late track, unless it has stopped */
+    p_track->i_dts = p_block->i_dts;
+    if( p_sys->audio.i_dts > VLC_TS_INVALID && p_sys->audio.i_dts < i_pcr &&
+        p_block->i_dts - p_sys->audio.i_dts < CLOCK_FREQ )
+        i_pcr = p_sys->audio.i_dts;
+    if( p_sys->video.i_dts > VLC_TS_INVALID && p_sys->video.i_dts < i_pcr &&
+        p_block->i_dts - p_sys->video.i_dts < CLOCK_FREQ )
+        i_pcr = p_sys->video.i_dts;
+
+    if( i_pcr > p_sys->i_pcr )
+    {
+        p_sys->i_pcr = i_pcr;
+        es_out_Control( p_demux->out, ES_OUT_SET_PCR, i_pcr );
+    }
+    es_out_Send( p_demux->out, p_track->p_es, p_block );
+}
+
+static void DemuxAudio( demux_t *p_demux, const flv_tag_t *p_tag, block_t *p_data )
+{
+    static const unsigned pi_rate[4] = { 5512, 11025, 22050, 44100 };
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t i_flags = p_data->p_buffer[0];
+    size_t i_header = 1;
+    es_format_t fmt;
+
+    es_format_Init( &fmt, AUDIO_ES, 0 );
+    fmt.audio.i_rate = pi_rate[( i_flags >> 2 ) & 0x03];
+    fmt.audio.i_bitspersample = ( i_flags & 0x02 ) ? 16 : 8;
+    fmt.audio.i_channels = ( i_flags & 0x01 ) + 1;
+
+    switch( i_flags >> 4 )
+    {
+    case 0: /* PCM, native endian (written by little endian encoders) */
+    case 3:
+        fmt.i_codec = fmt.audio.i_bitspersample == 16 ? VLC_CODEC_S16L : VLC_CODEC_U8;
+        fmt.audio.i_blockalign = fmt.audio.i_channels * fmt.audio.i_bitspersample / 8;
+        break;
+    case 1:
+        fmt.i_codec = VLC_CODEC_ADPCM_SWF;
+        break;
+    case 2:
+        fmt.i_codec = VLC_CODEC_MPGA;
+        fmt.b_packetized = false;
+        break;
+    case 14:
+        fmt.i_codec = VLC_CODEC_MPGA;
+        fmt.b_packetized = false;
+        fmt.audio.i_rate = 8000;
+        break;
+    case 4:
+        fmt.audio.i_rate = 16000;
+        fmt.audio.i_channels = 1;
+        fmt.i_codec = VLC_CODEC_NELLYMOSER;
+        break;
+    case 5:
+        fmt.audio.i_rate = 8000;
+        fmt.audio.i_channels = 1;
+        fmt.i_codec = VLC_CODEC_NELLYMOSER;
+        break;
+    case 6:
+        fmt.i_codec = VLC_CODEC_NELLYMOSER;
+        break;
+    case 7:
+        fmt.i_codec = VLC_CODEC_ALAW;
+        break;
+    case 8:
+        fmt.i_codec = VLC_CODEC_MULAW;
+        break;
+    case 10:
+        /* The rate and channels of the flags are meaningless for AAC */
+        fmt.i_codec = VLC_CODEC_MP4A;
+        fmt.audio.i_rate = 0;
+        fmt.audio.i_channels = 0;
+        i_header = 2;
+        if( p_data->i_buffer < 2 )
+            goto drop;
+        if( p_data->p_buffer[1] == 0 )
+        {
+            /* Sequence header: the AudioSpecificConfig */
+            fmt.i_extra = p_data->i_buffer - 2;
+            fmt.p_extra = malloc( fmt.i_extra );
+            if( fmt.i_extra > 0 && fmt.p_extra )
+                memcpy( fmt.p_extra, &p_data->p_buffer[2], fmt.i_extra );
+            else
+                fmt.i_extra = 0;
+            TrackSetFormat( p_demux, &p_sys->audio, &fmt );
+            goto drop;
+        }
+        break;
+    case 11:
+        fmt.audio.i_rate = 16000;
+        fmt.audio.i_channels = 1;
+        fmt.i_codec = VLC_CODEC_SPEEX;
+        break;
+    default:
+        goto drop;
+    }
+
+    /* AAC frames are useless before the sequence header */
+    if( fmt.i_codec == VLC_CODEC_MP4A )
+    {
+        es_format_Clean( &fmt );
+        if( !p_sys->audio.p_es )
+            goto drop;
+    }
+    else
+    {
+        TrackSetFormat( p_demux, &p_sys->audio, &fmt );
+    }
+    if( !p_sys->audio.p_es || p_data->i_buffer <= i_header )
+        goto drop;
+
+    /* Audio only files have no key frame to index */
+    if( !p_sys->b_index_complete && !p_sys->video.p_es &&
+        ( p_sys->index.i_entry <= 0 ||
+          p_tag->i_time - p_sys->index.p_entry[p_sys->index.i_entry-1].i_time >= FLV_INDEX_INTERVAL ) )
+        IndexAppend( &p_sys->index, p_tag->i_time, p_tag->i_offset );
+
+    p_data->p_buffer += i_header;
+    p_data->i_buffer -= i_header;
+    p_data->i_dts =
+    p_data->i_pts = VLC_TS_0 + p_tag->i_time;
+    TrackSend( p_demux, &p_sys->audio, p_data );
+    return;
+
+drop:
+    block_Release( p_data );
+}
+
+static void DemuxVideo( demux_t *p_demux, const flv_tag_t *p_tag, block_t *p_data )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int i_frame_type = p_data->p_buffer[0] >> 4;
+    mtime_t i_cts = 0;
+    size_t i_header = 1;
+    es_format_t fmt;
+
+    /* Video info/command frame */
+    if( i_frame_type == 5 )
+        goto drop;
+
+    es_format_Init( &fmt, VIDEO_ES, 0 );
+    switch( p_data->p_buffer[0] & 0x0f )
+    {
+    case 2:
+        fmt.i_codec = VLC_CODEC_FLV1;
+        break;
+    case 3:
+        fmt.i_codec = VLC_CODEC_FLASHSV;
+        break;
+    case 4:
+    case 5:
+        /* The first byte is the size adjustment that libavcodec expects
+         * as extra data */
+        fmt.i_codec = ( p_data->p_buffer[0] & 0x0f ) == 4 ? VLC_CODEC_VP6F : VLC_CODEC_VP6A;
+        i_header = 2;
+        if( p_data->i_buffer < 2 )
+            goto drop;
+        fmt.i_extra = 1;
+        fmt.p_extra = malloc( 1 );
+        if( fmt.p_extra )
+            *(uint8_t *)fmt.p_extra = p_data->p_buffer[1];
+        else
+            fmt.i_extra = 0;
+        break;
+    case 7:
+        fmt.i_codec = VLC_CODEC_H264;
+        i_header = 5;
+        if( p_data->i_buffer < 5 )
+            goto drop;
+        if( p_data->p_buffer[1] == 0 )
+        {
+            /* Sequence header: the AVCDecoderConfigurationRecord */
+            fmt.i_extra = p_data->i_buffer - 5;
+            fmt.p_extra = malloc( fmt.i_extra );
+            if( fmt.i_extra > 0 && fmt.p_extra )
+                memcpy( fmt.p_extra, &p_data->p_buffer[5], fmt.i_extra );
+            else
+                fmt.i_extra = 0;
+            TrackSetFormat( p_demux, &p_sys->video, &fmt );
+            goto drop;
+        }
+        if( p_data->p_buffer[1] != 1 )
+        {
+            es_format_Clean( &fmt );
+            goto drop;
+        }
+        /* Signed composition time offset in milliseconds */
+        i_cts = ( p_data->p_buffer[2] << 16 ) | ( p_data->p_buffer[3] << 8 ) |
+                p_data->p_buffer[4];
+        if( i_cts & 0x800000 )
+            i_cts -= 0x1000000;
+        i_cts *= 1000;
+        break;
+    default:
+        goto drop;
+    }
+
+    /* AVC NAL units are useless before the sequence header */
+    if( fmt.i_codec == VLC_CODEC_H264 )
+    {
+        es_format_Clean( &fmt );
+        if( !p_sys->video.p_es )
+            goto drop;
+    }
+    else
+    {
+        TrackSetFormat( p_demux, &p_sys->video, &fmt );
+    }
+    if( !p_sys->video.p_es || p_data->i_buffer <= i_header )
+        goto drop;
+
+    if( i_frame_type == 1 )
+    {
+        p_data->i_flags |= BLOCK_FLAG_TYPE_I;
+        if( !p_sys->b_index_complete )
+            IndexAppend( &p_sys->index, p_tag->i_time, p_tag->i_offset );
+    }
+
+    p_data->p_buffer += i_header;
+    p_data->i_buffer -= i_header;
+    p_data->i_dts = VLC_TS_0 + p_tag->i_time;
+    p_data->i_pts = VLC_TS_0 + p_tag->i_time + i_cts;
+    TrackSend( p_demux, &p_sys->video, p_data );
+    return;
+
+drop:
+    block_Release( p_data );
+}
+
+/*****************************************************************************
+ * AMF0 parsing of onMetaData
+ *****************************************************************************/
+enum
+{
+    AMF_NUMBER = 0x00,
+    AMF_BOOLEAN = 0x01,
+    AMF_STRING = 0x02,
+    AMF_OBJECT = 0x03,
+    AMF_NULL = 0x05,
+    AMF_UNDEFINED = 0x06,
+    AMF_REFERENCE = 0x07,
+    AMF_ECMA_ARRAY = 0x08,
+    AMF_OBJECT_END = 0x09,
+    AMF_STRICT_ARRAY = 0x0a,
+    AMF_DATE = 0x0b,
+    AMF_LONG_STRING = 0x0c,
+};
+#define AMF_DEPTH_MAX 16
+
+typedef struct
+{
+    const uint8_t *p;
+    size_t        i_left;
+} amf_reader_t;
+
+static const uint8_t *AmfGet( amf_reader_t *r, size_t i_size )
+{
+    const uint8_t *p = r->p;
+
+    if( r->i_left < i_size )
+    {
+        r->i_left = 0;
+        return NULL;
+    }
+    r->p += i_size;
+    r->i_left -= i_size;
+    return p;
+}
+
+static double AmfDouble( const uint8_t *p )
+{
+    union { uint64_t i; double f; } u;
+
+    u.i = GetQWBE( p );
+    return u.f;
+}
+
+/* A string without its type marker, as used for the object keys */
+static bool AmfString( amf_reader_t *r, const char **ppsz, size_t *pi_length )
+{
+    const uint8_t *p = AmfGet( r, 2 );
+
+    if( !p )
+        return false;
+    *pi_length = GetWBE( p );
+    *ppsz = (const char *)AmfGet( r, *pi_length );
+    return *ppsz != NULL;
+}
+
+static bool AmfIsKey( const char *psz_key, size_t i_key, const char *psz_name )
+{
+    return i_key == strlen( psz_name ) && !memcmp( psz_key, psz_name, i_key );
+}
+
+static int AmfSkip( amf_reader_t *r, int i_depth )
+{
+    const uint8_t *p = AmfGet( r, 1 );
+    const char *psz_key;
+    size_t i_key;
+
+    if( !p || i_depth > AMF_DEPTH_MAX )
+        goto error;
+
+    switch( *p )
+    {
+    case AMF_NUMBER:
+        return AmfGet( r, 8 ) ? VLC_SUCCESS : VLC_EGENERIC;
+    case AMF_BOOLEAN:
+        return AmfGet( r, 1 ) ? VLC_SUCCESS : VLC_EGENERIC;
+    case AMF_STRING:
+        return AmfString( r, &psz_key, &i_key ) ? VLC_SUCCESS : VLC_EGENERIC;
+    case AMF_LONG_STRING:
+        if( !( p = AmfGet( r, 4 ) ) )
+            return VLC_EGENERIC;
+        return AmfGet( r, GetDWBE( p ) ) ? VLC_SUCCESS : VLC_EGENERIC;
+    case AMF_NULL:
+    case AMF_UNDEFINED:
+        return VLC_SUCCESS;
+    case AMF_REFERENCE:
+        return AmfGet( r, 2 ) ? VLC_SUCCESS : VLC_EGENERIC;
+    case AMF_DATE:
+        return AmfGet( r, 10 ) ? VLC_SUCCESS : VLC_EGENERIC;
+    case AMF_ECMA_ARRAY:
+        /* The count is only a hint, the end marker is authoritative */
+        if( !AmfGet( r, 4 ) )
+            return VLC_EGENERIC;
+        /* fall through */
+    case AMF_OBJECT:
+        for( ;; )
+        {
+            if( !AmfString( r, &psz_key, &i_key ) )
+                return VLC_EGENERIC;
+            if( i_key == 0 && r->i_left > 0 && r->p[0] == AMF_OBJECT_END )
+                return AmfGet( r, 1 ) ? VLC_SUCCESS : VLC_EGENERIC;
+            if( AmfSkip( r, i_depth + 1 ) )
+                return VLC_EGENERIC;
+        }
+    case AMF_STRICT_ARRAY:
+    {
+        if( !( p = AmfGet( r, 4 ) ) )
+            return VLC_EGENERIC;
+        for( uint32_t i_count = GetDWBE( p ); i_count > 0; i_count-- )
+        {
+            if( AmfSkip( r, i_depth + 1 ) )
+                return VLC_EGENERIC;
+        }
+        return VLC_SUCCESS;
+    }
+    default:
+        goto error;
+    }
+
+error:
+    /* Do not go on parsing from the middle of a value */
+    r->i_left = 0;
+    return VLC_EGENERIC;
+}
+
+/* Read the next key of an object, false at its end or on error */
+static bool AmfObjectNext( amf_reader_t *r, const char **ppsz_key, size_t *pi_key )
+{
+    if( !AmfString( r, ppsz_key, pi_key ) )
+        return false;
+    if( *pi_key == 0 && r->i_left > 0 && r->p[0] == AMF_OBJECT_END )
+    {
+        AmfGet( r, 1 );
+        return false;
+    }
+    return true;
+}
+
+/* Read a number value, any other value is skipped */
+static bool AmfNumber( amf_reader_t *r, double *pf )
+{
+    const uint8_t *p;
+
+    if( r->i_left < 1 || r->p[0] != AMF_NUMBER )
+    {
+        AmfSkip( r, 0 );
+        return false;
+    }
+    AmfGet( r, 1 );
+    if( !( p = AmfGet( r, 8 ) ) )
+        return false;
+    *pf = AmfDouble( p );
+    return true;
+}
+
+/* keyframes: { filepositions: [...], times: [...] } */
+static void KeyframesParse( demux_t *p_demux, amf_reader_t *r )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_times = NULL, *p_positions = NULL;
+    uint32_t i_times = 0, i_positions = 0;
+    const char *psz_key;
+    size_t i_key;
+
+    if( r->i_left < 1 || r->p[0] != AMF_OBJECT )
+    {
+        AmfSkip( r, 0 );
+        return;
+    }
+    AmfGet( r, 1 );
+
+    while( AmfObjectNext( r, &psz_key, &i_key ) )
+    {
+        const uint8_t **pp_array = NULL;
+        uint32_t *pi_count = NULL;
+
+        if( AmfIsKey( psz_key, i_key, "times" ) )
+        {
+            pp_array = &p_times;
+            pi_count = &i_times;
+        }
+        else if( AmfIsKey( psz_key, i_key, "filepositions" ) )
+        {
+            pp_array = &p_positions;
+            pi_count = &i_positions;
+        }
+        if( pp_array && r->i_left >= 5 && r->p[0] == AMF_STRICT_ARRAY )
+        {
+            *pi_count = GetDWBE( &r->p[1] );
+            *pp_array = &r->p[5];
+        }
+        /* Also checks that the whole array is there */
+        if( AmfSkip( r, 0 ) )
+            return;
+    }
+    if( !p_times || !p_positions )
+        return;
+
+    /* Arrays of numbers: 9 bytes per entry as long as the types match */
+    flv_index_t index;
+    IndexInit( &index );
+    for( uint32_t i = 0; i < __MIN( i_times, i_positions ); i++ )
+    {
+        const uint8_t *p_time = &p_times[9 * i];
+        const uint8_t *p_position = &p_positions[9 * i];
+
+        if( p_time[0] != AMF_NUMBER || p_position[0] != AMF_NUMBER )
+            break;
+
+        const double f_time = AmfDouble( &p_time[1] );
+        const double f_position = AmfDouble( &p_position[1] );
+        /* The positions are relative to the segment */
+        if( f_time < 0.0 || f_position < FLV_HEADER_SIZE )
+            continue;
+        IndexAppend( &index, p_sys->i_segment_time + f_time * CLOCK_FREQ,
+                     p_sys->i_segment_base + f_position );
+    }
+
+    if( index.i_entry <= 0 )
+    {
+        IndexClean( &index );
+        return;
+    }
+    IndexClean( &p_sys->index );
+    p_sys->index = index;
+    p_sys->b_index_complete = true;
+}
+
+static void MetaDataParse( demux_t *p_demux, const uint8_t *p_data, size_t i_data )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    amf_reader_t r = { p_data, i_data };
+    const uint8_t *p;
+    const char *psz_key;
+    size_t i_key;
+
+    /* "onMetaData" followed by an ECMA array or an object */
+    if( !( p = AmfGet( &r, 1 ) ) || *p != AMF_STRING ||
+        !AmfString( &r, &psz_key, &i_key ) ||
+        !AmfIsKey( psz_key, i_key, "onMetaData" ) )
+        return;
+    if( !( p = AmfGet( &r, 1 ) ) )
+        return;
+    if( *p == AMF_ECMA_ARRAY )
+    {
+        if( !AmfGet( &r, 4 ) )
+            return;
+    }
+    else if( *p != AMF_OBJECT )
+    {
+        return;
+    }
+
+    while( AmfObjectNext( &r, &psz_key, &i_key ) )
+    {
+        double f;
+
+        if( AmfIsKey( psz_key, i_key, "duration" ) )
+        {
+            if( AmfNumber( &r, &f ) && f > 0.0 )
+            {
+                p_sys->i_segment_length = f * CLOCK_FREQ;
+                if( p_sys->i_duration <= 0 && p_sys->i_segment == 0 )
+                    p_sys->i_length = p_sys->i_segment_length;
+            }
+        }
+        else if( AmfIsKey( psz_key, i_key, "framerate" ) )
+        {
+            if( AmfNumber( &r, &f ) && f > 0.0 )
+                p_sys->f_fps = f;
+        }
+        else if( AmfIsKey( psz_key, i_key, "keyframes" ) )
+        {
+            if( !p_sys->b_index_complete )
+                KeyframesParse( p_demux, &r );
+            else if( AmfSkip( &r, 0 ) )
+                break;
+        }
+        else if( AmfSkip( &r, 0 ) )
+        {
+            break;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Index
+ *****************************************************************************/
+#define FLV_INDEX_SIZE_MAX 100000
+
+static void IndexInit( flv_index_t *p_index )
+{
+    p_index->i_entry = 0;
+    p_index->i_entry_max = 0;
+    p_index->p_entry = NULL;
+}
+
+static void IndexClean( flv_index_t *p_index )
+{
+    free( p_index->p_entry );
+    IndexInit( p_index );
+}
+
+static void IndexAppend( flv_index_t *p_index, mtime_t i_time, int64_t i_offset )
+{
+    /* Only append, in time and offset order */
+    if( p_index->i_entry > 0 &&
+        ( p_index->p_entry[p_index->i_entry-1].i_time >= i_time ||
+          p_index->p_entry[p_index->i_entry-1].i_offset >= i_offset ) )
+        return;
+
+    if( p_index->i_entry >= p_index->i_entry_max )
+    {
+        if( p_index->i_entry >= FLV_INDEX_SIZE_MAX )
+        {
+            /* Avoid a too big index by halving its resolution */
+            for( int i = 0; i < p_index->i_entry / 2; i++ )
+                p_index->p_entry[i] = p_index->p_entry[2 * i];
+            p_index->i_entry /= 2;
+        }
+        else
+        {
+            const int i_max = __MIN( __MAX( 2 * p_index->i_entry_max, 256 ),
+                                     FLV_INDEX_SIZE_MAX );
+            flv_index_entry_t *p_entry = realloc( p_index->p_entry,
+                                                  i_max * sizeof(*p_entry) );
+            if( !p_entry )
+                return;
+            p_index->p_entry = p_entry;
+            p_index->i_entry_max = i_max;
+        }
+    }
+
+    p_index->p_entry[p_index->i_entry].i_time = i_time;
+    p_index->p_entry[p_index->i_entry].i_offset = i_offset;
+    p_index->i_entry++;
+}
+
+/* The last entry at or before i_time (the first one if none) */
+static const flv_index_entry_t *IndexFind( const flv_index_t *p_index, mtime_t i_time )
+{
+    int i_min = 0;
+    int i_max = p_index->i_entry - 1;
+
+    if( p_index->i_entry <= 0 )
+        return NULL;
+
+    while( i_min < i_max )
+    {
+        const int i_med = ( i_min + i_max + 1 ) / 2;
+
+        if( p_index->p_entry[i_med].i_time <= i_time )
+            i_min = i_med;
+        else
+            i_max = i_med - 1;
+    }
+    return &p_index->p_entry[i_min];
+}
@@ -78,6 +78,16 @@ static void Close( vlc_object_t * );
     "Allows you to modify the default caching value for RTSP streams. This " \
     "value should be set in millisecond units." )
 
+#define LOW_LATENCY_TEXT N_("Low latency")
+#define LOW_LATENCY_LONGTEXT N_( \
+    "Buffer only as much as the measured network jitter requires. Late " \
+    "packets are dropped instead of waited for, and H.264 frames are " \
+    "released as soon as their last packet is received." )
+
+#define JITTER_MAX_TEXT N_("Maximum jitter buffer (ms)")
+#define JITTER_MAX_LONGTEXT N_( \
+    "Upper bound of the jitter buffer in low latency mode." )
+
 #define KASENNA_TEXT N_( "Kasenna RTSP dialect")
 #define KASENNA_LONGTEXT N_( "Kasenna servers use an old and nonstandard " \
     "dialect of RTSP. With this parameter VLC will try this dialect, but "\
@@ -131,6 +141,12 @@ vlc_module_begin ()
         add_integer("rtsp-caching", 4 * DEFAULT_PTS_DELAY / 1000,
                     CACHING_TEXT, CACHING_LONGTEXT, true )
             change_safe()
+        add_bool(   "rtsp-low-latency", false, LOW_LATENCY_TEXT,
+                    LOW_LATENCY_LONGTEXT, true )
+            change_safe()
+        add_integer( "rtsp-jitter-max", 200, JITTER_MAX_TEXT,
+                     JITTER_MAX_LONGTEXT, true )
+            change_safe()
         add_bool(   "rtsp-kasenna", false, KASENNA_TEXT,
                     KASENNA_LONGTEXT, true )
             change_safe()
@@ -150,6 +166,15 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 
+/* Low latency mode: the jitter buffer is a multiple of the measured
+ * interarrival jitter, within bounds, updated every JITTER_PERIOD */
+#define JITTER_PERIOD           (CLOCK_FREQ / 2)
+#define JITTER_BUFFER_FACTOR    3
+#define JITTER_BUFFER_MIN       (CLOCK_FREQ / 50)
+#define JITTER_BUFFER_INIT      (CLOCK_FREQ / 20)
+/* Left to the decoders and the outputs */
+#define LOW_LATENCY_PTS_DELAY   (CLOCK_FREQ / 25)
+
 typedef struct
 {
     demux_t         *p_demux;
@@ -230,6 +255,15 @@ struct demux_sys_t
     int              i_live555_ret; /* live555 callback return code */
 
     float            f_seek_request;/* In case we receive a seek request while paused*/
+
+    /* Jitter buffer */
+    bool             b_low_latency;
+    mtime_t          i_jitter_max;
+    mtime_t          i_jitter_buffer;   /* delay of the PCR behind the data */
+    mtime_t          i_jitter;          /* largest measured track jitter */
+    int64_t          i_lost;            /* RTP packets never received */
+    int64_t          i_pcr_sent;
+    mtime_t          i_jitter_date;     /* next measurement */
 };
 
 
@@ -264,6 +298,8 @@ static void TaskInterruptRTSP( void * );
 
 static void* TimeoutPrevention( void * );
 
+static void JitterUpdate( demux_t * );
+
 static unsigned char* parseH264ConfigStr( char const* configStr,
                                           unsigned int& configSize );
 
@@ -327,6 +363,13 @@ static int  Open ( vlc_object_t *p_this )
     p_sys->f_seek_request = -1;
     p_sys->b_error = false;
     p_sys->i_live555_ret = 0;
+    p_sys->b_low_latency = var_InheritBool( p_demux, "rtsp-low-latency" );
+    p_sys->i_jitter_max = var_InheritInteger( p_demux, "rtsp-jitter-max" ) * 1000;
+    p_sys->i_jitter_buffer = __MIN( JITTER_BUFFER_INIT, p_sys->i_jitter_max );
+    p_sys->i_jitter = 0;
+    p_sys->i_lost = 0;
+    p_sys->i_pcr_sent = 0;
+    p_sys->i_jitter_date = 0;
 
     /* parse URL for rtsp://[user:[passwd]@]serverip:port/options */
     vlc_UrlParse( &p_sys->url, p_sys->psz_path, 0 );
@@ -692,7 +735,9 @@ static int SessionsSetup( demux_t *p_demux )
     int            i_client_port;
     int            i_return = VLC_SUCCESS;
     unsigned int   i_buffer = 0;
-    unsigned const thresh = 200000; /* RTP reorder threshold .2 second (default .1) */
+    /* RTP reorder threshold .2 second (default .1), in low latency mode
+     * packets are not waited for longer than the jitter buffer */
+    unsigned const thresh = p_sys->b_low_latency ? p_sys->i_jitter_buffer : 200000;
 
     b_rtsp_tcp    = var_CreateGetBool( p_demux, "rtsp-tcp" ) ||
                     var_InheritBool( p_demux, "rtsp-http" );
@@ -1158,6 +1203,7 @@ static int Play( demux_t *p_demux )
         }
     }
     p_sys->i_pcr = 0;
+    p_sys->i_pcr_sent = 0;
 
     /* Retrieve the starttime if possible */
     p_sys->i_npt_start = p_sys->ms->playStartTime();
@@ -1208,8 +1254,17 @@ static int Demux( demux_t *p_demux )
     }
     if( p_sys->i_pcr > 0 )
     {
-        if( b_send_pcr )
-            es_out_Control( p_demux->out, ES_OUT_SET_PCR, 1 + p_sys->i_pcr );
+        /* In low latency mode, the PCR lags behind the received data by
+         * the jitter buffer, which replaces most of the input caching */
+        int64_t i_pcr_send = p_sys->i_pcr;
+        if( p_sys->b_low_latency )
+            i_pcr_send = __MAX( p_sys->i_pcr - p_sys->i_jitter_buffer,
+                                p_sys->i_pcr_sent );
+        if( b_send_pcr && i_pcr_send > 0 )
+        {
+            es_out_Control( p_demux->out, ES_OUT_SET_PCR, 1 + i_pcr_send );
+            p_sys->i_pcr_sent = i_pcr_send;
+        }
     }
 
     /* First warn we want to read data */
@@ -1250,11 +1305,18 @@ static int Demux( demux_t *p_demux )
             tk->i_pts = VLC_TS_INVALID;
             tk->i_npt = 0.;
             p_sys->i_pcr = 0;
+            p_sys->i_pcr_sent = 0;
             p_sys->i_npt = 0.;
             i_pcr = 0;
         }
     }
 
+    if( mdate() >= p_sys->i_jitter_date )
+    {
+        JitterUpdate( p_demux );
+        p_sys->i_jitter_date = mdate() + JITTER_PERIOD;
+    }
+
     if( p_sys->b_multicast && p_sys->b_no_data &&
         ( p_sys->i_no_data_ti > 120 ) )
     {
@@ -1376,6 +1438,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                     return VLC_EGENERIC;
                 }
                 p_sys->i_pcr = 0;
+                p_sys->i_pcr_sent = 0;
 
                 /* Retrieve RTP-Info values */
                 for( i = 0; i < p_sys->i_track; i++ )
@@ -1478,6 +1541,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             /* ReSync the stream */
             p_sys->i_npt_start = 0;
             p_sys->i_pcr = 0;
+            p_sys->i_pcr_sent = 0;
             p_sys->i_npt = 0.0;
 
             *pi_int = (int)( INPUT_RATE_DEFAULT / p_sys->ms->scale() );
@@ -1528,6 +1592,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                     tk->b_rtcp_sync = false;
                     tk->i_pts = VLC_TS_INVALID;
                     p_sys->i_pcr = 0;
+                    p_sys->i_pcr_sent = 0;
                     es_out_Control( p_demux->out, ES_OUT_RESET_PCR );
                 }
             }
@@ -1553,7 +1618,21 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         case DEMUX_GET_PTS_DELAY:
             pi64 = (int64_t*)va_arg( args, int64_t * );
             *pi64 = var_GetInteger( p_demux, "rtsp-caching" ) * 1000;
+            if( p_sys->b_low_latency )
+                *pi64 = __MIN( *pi64, LOW_LATENCY_PTS_DELAY );
+            return VLC_SUCCESS;
+
+        case DEMUX_GET_NETWORK_STATS:
+        {
+            int64_t *pi_jitter = (int64_t*)va_arg( args, int64_t * );
+            int64_t *pi_lost = (int64_t*)va_arg( args, int64_t * );
+            int64_t *pi_buffer = (int64_t*)va_arg( args, int64_t * );
+            *pi_jitter = p_sys->i_jitter;
+            *pi_lost = p_sys->i_lost;
+            *pi_buffer = p_sys->b_low_latency ? p_sys->i_jitter_buffer :
+                         var_GetInteger( p_demux, "rtsp-caching" ) * 1000;
             return VLC_SUCCESS;
+        }
 
         default:
             return VLC_EGENERIC;
@@ -1867,6 +1946,10 @@ static void StreamRead( void *p_private, unsigned int i_size,
         p_block->p_buffer[2] = 0x00;
         p_block->p_buffer[3] = 0x01;
         memcpy( &p_block->p_buffer[4], tk->p_buffer, i_size );
+
+        /* The marker bit is set on the last packet of an access unit */
+        if( p_sys->b_low_latency && tk->sub->rtpSource()->curPacketMarkerBit() )
+            p_block->i_flags |= BLOCK_FLAG_END_OF_FRAME;
     }
     else if( tk->b_asf )
     {
@@ -1922,6 +2005,59 @@ static void StreamRead( void *p_private, unsigned int i_size,
     }
 }
 
+/*****************************************************************************
+ * JitterUpdate: measure the network and size the jitter buffer
+ *****************************************************************************/
+static void JitterUpdate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mtime_t i_jitter = 0;
+    int64_t i_lost = 0;
+
+    for( int i = 0; i < p_sys->i_track; i++ )
+    {
+        RTPSource *rtpSource = p_sys->track[i]->sub->rtpSource();
+        if( !rtpSource || rtpSource->timestampFrequency() == 0 )
+            continue;
+
+        /* One entry per sender SSRC, the jitter is in timestamp units */
+        RTPReceptionStatsDB::Iterator iter( rtpSource->receptionStatsDB() );
+        RTPReceptionStats *stats;
+        while( ( stats = iter.next( True ) ) != NULL )
+        {
+            const mtime_t i_track_jitter = (mtime_t)stats->jitter() * CLOCK_FREQ /
+                                           rtpSource->timestampFrequency();
+            i_jitter = __MAX( i_jitter, i_track_jitter );
+            if( stats->totNumPacketsExpected() > stats->totNumPacketsReceived() )
+                i_lost += stats->totNumPacketsExpected() - stats->totNumPacketsReceived();
+        }
+    }
+    p_sys->i_jitter = i_jitter;
+    p_sys->i_lost = i_lost;
+
+    if( !p_sys->b_low_latency )
+        return;
+
+    /* Grow at once to absorb a jitter burst, shrink slowly so that the
+     * PCR does not jump ahead of the frames in flight */
+    mtime_t i_buffer = JITTER_BUFFER_FACTOR * i_jitter;
+    i_buffer = __MAX( i_buffer, JITTER_BUFFER_MIN );
+    i_buffer = __MIN( i_buffer, p_sys->i_jitter_max );
+    if( i_buffer < p_sys->i_jitter_buffer )
+        i_buffer = p_sys->i_jitter_buffer - ( p_sys->i_jitter_buffer - i_buffer ) / 8;
+
+    if( i_buffer != p_sys->i_jitter_buffer )
+    {
+        p_sys->i_jitter_buffer = i_buffer;
+        for( int i = 0; i < p_sys->i_track; i++ )
+        {
+            RTPSource *rtpSource = p_sys->track[i]->sub->rtpSource();
+            if( rtpSource )
+                rtpSource->setPacketReorderingThresholdTime( i_buffer );
+        }
+    }
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -307,6 +307,32 @@ static int MP4_ReadBoxContainerRaw( stream_t *p_stream, MP4_Box_t *p_container )
     return 1;
 }
 
+/* Same as MP4_ReadBoxContainerRaw but for the top level boxes: the movie
+ * fragments are not loaded, the demuxer reads them one by one */
+static int MP4_ReadBoxContainerRoot( stream_t *p_stream, MP4_Box_t *p_root )
+{
+    MP4_Box_t *p_box;
+
+    do
+    {
+        if( ( p_box = MP4_ReadBox( p_stream, p_root ) ) == NULL ) break;
+
+        if( !p_root->p_first ) p_root->p_first = p_box;
+        else p_root->p_last->p_next = p_box;
+        p_root->p_last = p_box;
+
+        if( p_box->i_type == FOURCC_moov && MP4_BoxGet( p_box, "mvex" ) )
+        {
+            msg_Dbg( p_stream, "fragmented file, fragments loaded on demand" );
+            stream_Seek( p_stream, p_box->i_pos + p_box->i_size );
+            break;
+        }
+
+    } while( MP4_NextBox( p_stream, p_box ) == 1 );
+
+    return 1;
+}
+
 static int MP4_ReadBoxContainer( stream_t *p_stream, MP4_Box_t *p_container )
 {
     if( p_container->i_size <= (size_t)MP4_BOX_HEADERSIZE(p_container ) + 8 )
@@ -547,7 +573,7 @@ static int MP4_ReadBox_trun(  stream_t *p_stream, MP4_Box_t *p_box )
     MP4_GET4BYTES( p_box->data.p_trun->i_sample_count );
 
     if( p_box->data.p_trun->i_flags & MP4_TRUN_DATA_OFFSET )
-        MP4_GET8BYTES( p_box->data.p_trun->i_data_offset );
+        MP4_GET4BYTES( p_box->data.p_trun->i_data_offset );
     if( p_box->data.p_trun->i_flags & MP4_TRUN_FIRST_FLAGS )
         MP4_GET4BYTES( p_box->data.p_trun->i_first_sample_flags );
 
@@ -592,6 +618,207 @@ static void MP4_FreeBox_trun( MP4_Box_t *p_box )
     FREENULL( p_box->data.p_trun->p_samples );
 }
 
+static int MP4_ReadBox_trex( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_READBOX_ENTER( MP4_Box_data_trex_t );
+
+    MP4_GETVERSIONFLAGS( p_box->data.p_trex );
+
+    MP4_GET4BYTES( p_box->data.p_trex->i_track_ID );
+    MP4_GET4BYTES( p_box->data.p_trex->i_default_sample_description_index );
+    MP4_GET4BYTES( p_box->data.p_trex->i_default_sample_duration );
+    MP4_GET4BYTES( p_box->data.p_trex->i_default_sample_size );
+    MP4_GET4BYTES( p_box->data.p_trex->i_default_sample_flags );
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"trex\" track ID %d description %d "
+             "duration %d size %d flags 0x%x",
+             p_box->data.p_trex->i_track_ID,
+             p_box->data.p_trex->i_default_sample_description_index,
+             p_box->data.p_trex->i_default_sample_duration,
+             p_box->data.p_trex->i_default_sample_size,
+             p_box->data.p_trex->i_default_sample_flags );
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
+static int MP4_ReadBox_mehd( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_READBOX_ENTER( MP4_Box_data_mehd_t );
+
+    MP4_GETVERSIONFLAGS( p_box->data.p_mehd );
+
+    if( p_box->data.p_mehd->i_version == 1 )
+        MP4_GET8BYTES( p_box->data.p_mehd->i_fragment_duration );
+    else
+        MP4_GET4BYTES( p_box->data.p_mehd->i_fragment_duration );
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"mehd\" fragment duration %"PRId64,
+             p_box->data.p_mehd->i_fragment_duration );
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
+static int MP4_ReadBox_tfdt( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_READBOX_ENTER( MP4_Box_data_tfdt_t );
+
+    MP4_GETVERSIONFLAGS( p_box->data.p_tfdt );
+
+    if( p_box->data.p_tfdt->i_version == 1 )
+        MP4_GET8BYTES( p_box->data.p_tfdt->i_base_media_decode_time );
+    else
+        MP4_GET4BYTES( p_box->data.p_tfdt->i_base_media_decode_time );
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"tfdt\" base media decode time %"PRId64,
+             p_box->data.p_tfdt->i_base_media_decode_time );
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
+static int MP4_ReadBox_tfra( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_Box_data_tfra_t *p_tfra;
+    uint32_t i_lengths;
+    unsigned i_skip;
+
+    MP4_READBOX_ENTER( MP4_Box_data_tfra_t );
+    p_tfra = p_box->data.p_tfra;
+
+    MP4_GETVERSIONFLAGS( p_tfra );
+
+    MP4_GET4BYTES( p_tfra->i_track_ID );
+    MP4_GET4BYTES( i_lengths );
+    MP4_GET4BYTES( p_tfra->i_number_of_entries );
+
+    /* traf/trun/sample numbers are not used */
+    i_skip = ( ( i_lengths >> 4 ) & 0x03 ) + ( ( i_lengths >> 2 ) & 0x03 ) +
+             ( i_lengths & 0x03 ) + 3;
+
+    if( p_tfra->i_number_of_entries >
+        i_read / ( ( p_tfra->i_version == 1 ? 16 : 8 ) + i_skip ) )
+        p_tfra->i_number_of_entries =
+            i_read / ( ( p_tfra->i_version == 1 ? 16 : 8 ) + i_skip );
+
+    p_tfra->p_time = calloc( p_tfra->i_number_of_entries, sizeof(uint64_t) );
+    p_tfra->p_moof_offset = calloc( p_tfra->i_number_of_entries, sizeof(uint64_t) );
+    if( p_tfra->p_time == NULL || p_tfra->p_moof_offset == NULL )
+        MP4_READBOX_EXIT( 0 );
+
+    for( uint32_t i = 0; i < p_tfra->i_number_of_entries; i++ )
+    {
+        if( p_tfra->i_version == 1 )
+        {
+            MP4_GET8BYTES( p_tfra->p_time[i] );
+            MP4_GET8BYTES( p_tfra->p_moof_offset[i] );
+        }
+        else
+        {
+            MP4_GET4BYTES( p_tfra->p_time[i] );
+            MP4_GET4BYTES( p_tfra->p_moof_offset[i] );
+        }
+        if( i_read < (int64_t)i_skip )
+            break;
+        p_peek += i_skip;
+        i_read -= i_skip;
+    }
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"tfra\" track ID %d entries %d",
+             p_tfra->i_track_ID, p_tfra->i_number_of_entries );
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
+static void MP4_FreeBox_tfra( MP4_Box_t *p_box )
+{
+    FREENULL( p_box->data.p_tfra->p_time );
+    FREENULL( p_box->data.p_tfra->p_moof_offset );
+}
+
+static int MP4_ReadBox_mfro( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_READBOX_ENTER( MP4_Box_data_mfro_t );
+
+    MP4_GETVERSIONFLAGS( p_box->data.p_mfro );
+    MP4_GET4BYTES( p_box->data.p_mfro->i_size );
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"mfro\" size %d",
+             p_box->data.p_mfro->i_size );
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
+static int MP4_ReadBox_sidx( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_Box_data_sidx_t *p_sidx;
+    uint16_t i_reserved;
+
+    MP4_READBOX_ENTER( MP4_Box_data_sidx_t );
+    p_sidx = p_box->data.p_sidx;
+
+    MP4_GETVERSIONFLAGS( p_sidx );
+
+    MP4_GET4BYTES( p_sidx->i_reference_ID );
+    MP4_GET4BYTES( p_sidx->i_timescale );
+    if( p_sidx->i_version == 0 )
+    {
+        MP4_GET4BYTES( p_sidx->i_earliest_presentation_time );
+        MP4_GET4BYTES( p_sidx->i_first_offset );
+    }
+    else
+    {
+        MP4_GET8BYTES( p_sidx->i_earliest_presentation_time );
+        MP4_GET8BYTES( p_sidx->i_first_offset );
+    }
+    MP4_GET2BYTES( i_reserved );
+    VLC_UNUSED( i_reserved );
+    MP4_GET2BYTES( p_sidx->i_reference_count );
+
+    if( p_sidx->i_reference_count > i_read / 12 )
+        p_sidx->i_reference_count = i_read / 12;
+
+    p_sidx->p_reference_type =
+        calloc( p_sidx->i_reference_count, sizeof(uint8_t) );
+    p_sidx->p_referenced_size =
+        calloc( p_sidx->i_reference_count, sizeof(uint32_t) );
+    p_sidx->p_subsegment_duration =
+        calloc( p_sidx->i_reference_count, sizeof(uint32_t) );
+    if( p_sidx->p_reference_type == NULL ||
+        p_sidx->p_referenced_size == NULL ||
+        p_sidx->p_subsegment_duration == NULL )
+        MP4_READBOX_EXIT( 0 );
+
+    for( unsigned i = 0; i < p_sidx->i_reference_count; i++ )
+    {
+        uint32_t i_tmp, i_sap;
+
+        MP4_GET4BYTES( i_tmp );
+        p_sidx->p_reference_type[i] = i_tmp >> 31;
+        p_sidx->p_referenced_size[i] = i_tmp & 0x7fffffff;
+        MP4_GET4BYTES( p_sidx->p_subsegment_duration[i] );
+        MP4_GET4BYTES( i_sap );
+        VLC_UNUSED( i_sap );
+    }
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"sidx\" reference ID %d timescale %d "
+             "references %d", p_sidx->i_reference_ID, p_sidx->i_timescale,
+             p_sidx->i_reference_count );
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
+static void MP4_FreeBox_sidx( MP4_Box_t *p_box )
+{
+    FREENULL( p_box->data.p_sidx->p_reference_type );
+    FREENULL( p_box->data.p_sidx->p_referenced_size );
+    FREENULL( p_box->data.p_sidx->p_subsegment_duration );
+}
+
 
 
 static int MP4_ReadBox_tkhd(  stream_t *p_stream, MP4_Box_t *p_box )
@@ -2906,6 +3133,16 @@ static const struct
     { FOURCC_tfhd,  MP4_ReadBox_tfhd,          MP4_FreeBox_Common },
     { FOURCC_trun,  MP4_ReadBox_trun,          MP4_FreeBox_trun },
 
+    /* fragmented files */
+    { FOURCC_mvex,  MP4_ReadBoxContainer,      MP4_FreeBox_Common },
+    { FOURCC_trex,  MP4_ReadBox_trex,          MP4_FreeBox_Common },
+    { FOURCC_mehd,  MP4_ReadBox_mehd,          MP4_FreeBox_Common },
+    { FOURCC_tfdt,  MP4_ReadBox_tfdt,          MP4_FreeBox_Common },
+    { FOURCC_mfra,  MP4_ReadBoxContainer,      MP4_FreeBox_Common },
+    { FOURCC_tfra,  MP4_ReadBox_tfra,          MP4_FreeBox_tfra },
+    { FOURCC_mfro,  MP4_ReadBox_mfro,          MP4_FreeBox_Common },
+    { FOURCC_sidx,  MP4_ReadBox_sidx,          MP4_FreeBox_sidx },
+
     /* Last entry */
     { 0,             MP4_ReadBox_default,       NULL }
 };
@@ -2957,6 +3194,21 @@ static MP4_Box_t *MP4_ReadBox( stream_t *p_stream, MP4_Box_t *p_father )
     return p_box;
 }
 
+/*****************************************************************************
+ * MP4_BoxRead : read the box at the current position and go to its end
+ *****************************************************************************/
+MP4_Box_t *MP4_BoxRead( stream_t *s, MP4_Box_t *p_father )
+{
+    MP4_Box_t *p_box = MP4_ReadBox( s, p_father );
+
+    if( p_box && stream_Seek( s, p_box->i_pos + p_box->i_size ) )
+    {
+        MP4_BoxFree( s, p_box );
+        return NULL;
+    }
+    return p_box;
+}
+
 /*****************************************************************************
  * MP4_FreeBox : free memory after read with MP4_ReadBox and all
  * the children
@@ -3040,7 +3292,7 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *s )
 
     p_stream = s;
 
-    i_result = MP4_ReadBoxContainerRaw( p_stream, p_root );
+    i_result = MP4_ReadBoxContainerRoot( p_stream, p_root );
 
     if( i_result )
     {
@@ -76,6 +76,12 @@
 #define FOURCC_traf VLC_FOURCC( 't', 'r', 'a', 'f' )
 #define FOURCC_tfhd VLC_FOURCC( 't', 'f', 'h', 'd' )
 #define FOURCC_trun VLC_FOURCC( 't', 'r', 'u', 'n' )
+#define FOURCC_mehd VLC_FOURCC( 'm', 'e', 'h', 'd' )
+#define FOURCC_tfdt VLC_FOURCC( 't', 'f', 'd', 't' )
+#define FOURCC_mfra VLC_FOURCC( 'm', 'f', 'r', 'a' )
+#define FOURCC_tfra VLC_FOURCC( 't', 'f', 'r', 'a' )
+#define FOURCC_mfro VLC_FOURCC( 'm', 'f', 'r', 'o' )
+#define FOURCC_sidx VLC_FOURCC( 's', 'i', 'd', 'x' )
 #define FOURCC_cprt VLC_FOURCC( 'c', 'p', 'r', 't' )
 #define FOURCC_iods VLC_FOURCC( 'i', 'o', 'd', 's' )
 
@@ -834,6 +840,8 @@ typedef struct MP4_Box_data_mfhd_s
 #define MP4_TFHD_DFLT_SAMPLE_DURATION (1LL<<3)
 #define MP4_TFHD_DFLT_SAMPLE_SIZE     (1LL<<4)
 #define MP4_TFHD_DFLT_SAMPLE_FLAGS    (1LL<<5)
+#define MP4_TFHD_DURATION_IS_EMPTY    (1LL<<16)
+#define MP4_TFHD_DEFAULT_BASE_IS_MOOF (1LL<<17)
 typedef struct MP4_Box_data_tfhd_s
 {
     uint8_t  i_version;
@@ -870,13 +878,86 @@ typedef struct MP4_Box_data_trun_s
     uint32_t i_sample_count;
 
     /* optional fields */
-    uint32_t i_data_offset;
+    int32_t  i_data_offset;
     uint32_t i_first_sample_flags;
 
     MP4_descriptor_trun_sample_t *p_samples;
 
 } MP4_Box_data_trun_t;
 
+/* sample flags used in trex/tfhd/trun */
+#define MP4_SAMPLE_FLAG_NON_SYNC     (1<<16)
+
+typedef struct MP4_Box_data_trex_s
+{
+    uint8_t  i_version;
+    uint32_t i_flags;
+
+    uint32_t i_track_ID;
+    uint32_t i_default_sample_description_index;
+    uint32_t i_default_sample_duration;
+    uint32_t i_default_sample_size;
+    uint32_t i_default_sample_flags;
+
+} MP4_Box_data_trex_t;
+
+typedef struct MP4_Box_data_mehd_s
+{
+    uint8_t  i_version;
+    uint32_t i_flags;
+
+    uint64_t i_fragment_duration;
+
+} MP4_Box_data_mehd_t;
+
+typedef struct MP4_Box_data_tfdt_s
+{
+    uint8_t  i_version;
+    uint32_t i_flags;
+
+    uint64_t i_base_media_decode_time;
+
+} MP4_Box_data_tfdt_t;
+
+typedef struct MP4_Box_data_tfra_s
+{
+    uint8_t  i_version;
+    uint32_t i_flags;
+
+    uint32_t i_track_ID;
+    uint32_t i_number_of_entries;
+
+    uint64_t *p_time;        /* these are array */
+    uint64_t *p_moof_offset;
+
+} MP4_Box_data_tfra_t;
+
+typedef struct MP4_Box_data_mfro_s
+{
+    uint8_t  i_version;
+    uint32_t i_flags;
+
+    uint32_t i_size;
+
+} MP4_Box_data_mfro_t;
+
+typedef struct MP4_Box_data_sidx_s
+{
+    uint8_t  i_version;
+    uint32_t i_flags;
+
+    uint32_t i_reference_ID;
+    uint32_t i_timescale;
+    uint64_t i_earliest_presentation_time;
+    uint64_t i_first_offset;
+    uint16_t i_reference_count;
+
+    uint8_t  *p_reference_type;     /* these are array */
+    uint32_t *p_referenced_size;
+    uint32_t *p_subsegment_duration;
+
+} MP4_Box_data_sidx_t;
+
 
 typedef struct
 {
@@ -976,6 +1057,12 @@ typedef union MP4_Box_data_s
     MP4_Box_data_mfhd_t *p_mfhd;
     MP4_Box_data_tfhd_t *p_tfhd;
     MP4_Box_data_trun_t *p_trun;
+    MP4_Box_data_trex_t *p_trex;
+    MP4_Box_data_mehd_t *p_mehd;
+    MP4_Box_data_tfdt_t *p_tfdt;
+    MP4_Box_data_tfra_t *p_tfra;
+    MP4_Box_data_mfro_t *p_mfro;
+    MP4_Box_data_sidx_t *p_sidx;
     MP4_Box_data_tkhd_t *p_tkhd;
     MP4_Box_data_mdhd_t *p_mdhd;
     MP4_Box_data_hdlr_t *p_hdlr;
@@ -1068,6 +1155,14 @@ typedef struct MP4_Box_s
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t * );
 
+/*****************************************************************************
+ * MP4_BoxRead : read the box (and its children) at the current position
+ *****************************************************************************
+ *  Used to load the movie fragments one by one. The stream is left at the
+ *  end of the box, the returned box has to be freed with MP4_BoxFree.
+ *****************************************************************************/
+MP4_Box_t *MP4_BoxRead( stream_t *, MP4_Box_t *p_father );
+
 /*****************************************************************************
  * MP4_FreeBox : free memory allocated after read with MP4_ReadBox
  *               or MP4_BoxGetRoot, this means also children boxes
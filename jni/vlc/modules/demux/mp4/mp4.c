@@ -74,20 +74,15 @@ typedef struct
     uint32_t     i_sample_count; /* how many samples in this chunk */
     uint32_t     i_sample_first; /* index of the first sample in this chunk */
 
-    /* now provide way to calculate pts, dts, and offset without too
-        much memory and with fast access */
-
-    /* with this we can calculate dts/pts without waste memory */
+    /* dts/pts are not expanded, they are computed from the run length
+     * encoded stts/ctts tables starting at the run of the first sample of
+     * this chunk, so the index does not grow with the number of samples */
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_last_dts;    /* DTS of the last sample */
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-
-    uint32_t     *p_sample_count_pts;
-    int32_t      *p_sample_offset_pts;  /* pts-dts */
-
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
+    uint32_t     i_stts_entry;  /* stts run of the first sample */
+    uint32_t     i_stts_skip;   /* samples of that run before this chunk */
+    uint32_t     i_ctts_entry;  /* ctts run of the first sample */
+    uint32_t     i_ctts_skip;   /* samples of that run before this chunk */
 
 } mp4_chunk_t;
 
@@ -131,8 +126,11 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    uint32_t         *p_sample_size; /* points into the stsz box, not owned */
+
+    /* run length encoded timing tables (point into the stbl boxes) */
+    MP4_Box_data_stts_t *p_stts;
+    MP4_Box_data_ctts_t *p_ctts;    /* could be NULL */
 
     MP4_Box_t *p_stbl;  /* will contain all timing information */
     MP4_Box_t *p_stsd;  /* will contain all data to initialize decoder */
@@ -142,8 +140,61 @@ typedef struct
     void      *p_drms;
     MP4_Box_t *p_skcr;
 
+    /* fragmented file: samples of the loaded fragments not sent yet */
+    MP4_Box_data_trex_t *p_trex;
+    struct mp4_frag_sample_t *p_frag;
+    uint32_t   i_frag;          /* next sample to send */
+    uint32_t   i_frag_count;
+    uint32_t   i_frag_max;
+    uint64_t   i_frag_dts;      /* dts of the next sample to be loaded */
+    uint32_t   i_frag_misses;   /* consecutive moofs without a sample */
+
+    /* private stream cursor, only used for badly interleaved files */
+    stream_t  *s;
+    /* the next sample needs a new ES, advance once the current one is sent */
+    bool       b_es_pending;
+
 } mp4_track_t;
 
+/* A sample of a movie fragment (fragmented files) */
+typedef struct mp4_frag_sample_t
+{
+    uint64_t     i_pos;
+    uint32_t     i_size;
+    bool         b_sync;
+    int32_t      i_cts_offset;  /* pts-dts, track timescale */
+    uint64_t     i_dts;         /* track timescale */
+} mp4_frag_sample_t;
+
+/* Seek point of a fragmented file (from mfra or sidx) */
+typedef struct
+{
+    mtime_t      i_time;
+    uint64_t     i_offset;      /* position of the moof (or sidx) */
+} mp4_frag_index_t;
+
+/* A sample (or a bunch of audio samples) scheduled by the read planner */
+typedef struct
+{
+    mp4_track_t *p_track;
+    uint64_t     i_pos;
+    uint32_t     i_size;
+    int64_t      i_dts;
+    int64_t      i_pts_delta;
+    block_t      *p_block;
+} mp4_sample_req_t;
+
+/* Upper bound of samples planned by one Demux() call */
+#define MP4_PLAN_MAX_SAMPLES    4096
+/* Holes up to this size are read through instead of seeking over them */
+#define MP4_PLAN_MAX_GAP        (16*1024)
+/* A jump between two tracks further than this is considered bad interleaving */
+#define MP4_INTERLEAVE_DISTANCE (4*1024*1024)
+/* Number of consecutive badly interleaved windows before splitting streams */
+#define MP4_INTERLEAVE_WINDOWS  8
+/* Consecutive moofs without a sample of a track before it is not waited for */
+#define MP4_FRAG_MISSES_MAX     8
+
 
 struct demux_sys_t
 {
@@ -164,6 +215,22 @@ struct demux_sys_t
 
     /* */
     input_title_t *p_title;
+
+    /* read planner */
+    mp4_sample_req_t  *p_req;       /* samples of the window, in track order */
+    mp4_sample_req_t **pp_req_read; /* same samples, in file offset order */
+    int          i_req;
+    int          i_req_max;
+    int          i_interleave_score;
+    bool         b_track_streams;   /* each track has its own stream cursor */
+
+    /* fragmented file: the fragments are parsed while playing */
+    bool         b_fragmented;
+    bool         b_frag_eof;
+    uint64_t     i_frag_first;      /* position of the first fragment */
+    uint64_t     i_frag_next;       /* position of the next top level box */
+    mp4_frag_index_t *p_frag_index; /* seek points, sorted by time */
+    int          i_frag_index;
 };
 
 /*****************************************************************************
@@ -185,32 +252,50 @@ static void     MP4_TrackSetELST( demux_t *, mp4_track_t *, int64_t );
 static void     MP4_UpdateSeekpoint( demux_t * );
 static const char *MP4_ConvertMacCode( uint16_t );
 
-/* Return time in s of a track */
-static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+static void     MP4_PlanTrack( demux_t *, mp4_track_t * );
+static void     MP4_PlanRead( demux_t * );
+static void     MP4_PlanSend( demux_t * );
+static void     MP4_OpenTrackStreams( demux_t * );
+
+static int      DemuxFrag( demux_t * );
+static int      FragSeek( demux_t *, mtime_t );
+static void     FragLoadMfra( demux_t * );
+static void     FragTrackFlush( mp4_track_t * );
+
+/* Return the dts of the sample i_sample of a chunk (relative to the first
+ * sample of the chunk) in track timescale, edit lists not applied */
+static inline int64_t MP4_ChunkGetDTS( const mp4_track_t *p_track,
+                                       const mp4_chunk_t *ck,
+                                       uint32_t i_sample )
 {
-#define chunk p_track->chunk[p_track->i_chunk]
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
+    uint32_t i_entry = ck->i_stts_entry;
+    uint32_t i_skip  = ck->i_stts_skip;
+    int64_t  i_dts   = ck->i_first_dts;
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - chunk.i_sample_first;
-    int64_t i_dts = chunk.i_first_dts;
-
-    while( i_sample > 0 )
+    while( i_sample > 0 && i_entry < stts->i_entry_count )
     {
-        if( i_sample > chunk.p_sample_count_dts[i_index] )
-        {
-            i_dts += chunk.p_sample_count_dts[i_index] *
-                chunk.p_sample_delta_dts[i_index];
-            i_sample -= chunk.p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
+        const uint32_t i_left = stts->i_sample_count[i_entry] - i_skip;
+
+        if( i_sample <= i_left )
         {
-            i_dts += i_sample * chunk.p_sample_delta_dts[i_index];
+            i_dts += (int64_t)i_sample * stts->i_sample_delta[i_entry];
             break;
         }
+        i_dts += (int64_t)i_left * stts->i_sample_delta[i_entry];
+        i_sample -= i_left;
+        i_entry++;
+        i_skip = 0;
     }
+    return i_dts;
+}
 
-#undef chunk
+/* Return time in s of a track */
+static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+{
+    const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    int64_t i_dts = MP4_ChunkGetDTS( p_track, ck,
+                                     p_track->i_sample - ck->i_sample_first );
 
     /* now handle elst */
     if( p_track->p_elst )
@@ -238,21 +323,26 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 
 static inline int64_t MP4_TrackGetPTSDelta( mp4_track_t *p_track )
 {
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
+    const MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
+    const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    uint32_t i_sample = p_track->i_sample - ck->i_sample_first;
+    uint32_t i_entry  = ck->i_ctts_entry;
+    uint32_t i_skip   = ck->i_ctts_skip;
 
-    if( ck->p_sample_count_pts == NULL || ck->p_sample_offset_pts == NULL )
+    if( ctts == NULL )
         return -1;
 
-    for( i_index = 0;; i_index++ )
+    for( ; i_entry < ctts->i_entry_count; i_entry++, i_skip = 0 )
     {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
-            return ck->p_sample_offset_pts[i_index] * INT64_C(1000000) /
+        const uint32_t i_left = ctts->i_sample_count[i_entry] - i_skip;
+
+        if( i_sample < i_left )
+            return ctts->i_sample_offset[i_entry] * INT64_C(1000000) /
                    (int64_t)p_track->i_timescale;
 
-        i_sample -= ck->p_sample_count_pts[i_index];
+        i_sample -= i_left;
     }
+    return -1;
 }
 
 static inline int64_t MP4_GetMoviePTS(demux_sys_t *p_sys )
@@ -497,6 +587,23 @@ static int Open( vlc_object_t * p_this )
         goto error;
     memset( p_sys->track, 0, p_sys->i_tracks * sizeof( mp4_track_t ) );
 
+    /* Fragmented file: only the header has been loaded, the fragments are
+     * parsed one by one while playing */
+    MP4_Box_t *p_mvex = MP4_BoxGet( p_sys->p_root, "/moov/mvex" );
+    if( p_mvex )
+    {
+        MP4_Box_t *p_moov = MP4_BoxGet( p_sys->p_root, "/moov" );
+        MP4_Box_t *p_mehd = MP4_BoxGet( p_mvex, "mehd" );
+
+        p_sys->b_fragmented = true;
+        p_sys->i_frag_first =
+        p_sys->i_frag_next  = p_moov->i_pos + p_moov->i_size;
+        if( p_sys->i_duration == 0 && p_mehd )
+            p_sys->i_duration = p_mehd->data.p_mehd->i_fragment_duration;
+        msg_Dbg( p_demux, "fragmented file, first fragment at %"PRIu64,
+                 p_sys->i_frag_first );
+    }
+
     /* Search the first chap reference (like quicktime) and
      * check that at least 1 stream is enabled */
     p_sys->p_tref_chap = NULL;
@@ -564,6 +671,9 @@ static int Open( vlc_object_t * p_this )
     /* */
     LoadChapter( p_demux );
 
+    if( p_sys->b_fragmented )
+        FragLoadMfra( p_demux );
+
     return VLC_SUCCESS;
 
 error:
@@ -588,6 +698,9 @@ static int Demux( demux_t *p_demux )
 
     unsigned int i_track_selected;
 
+    if( p_sys->b_fragmented )
+        return DemuxFrag( p_demux );
+
     /* check for newly selected/unselected track */
     for( i_track = 0, i_track_selected = 0; i_track < p_sys->i_tracks;
          i_track++ )
@@ -646,6 +759,9 @@ static int Demux( demux_t *p_demux )
     /* we will read 100ms for each stream so ...*/
     p_sys->i_time += __MAX( p_sys->i_timescale / 10 , 1 );
 
+    /* Plan the reads of this window for all tracks, do them in file order
+     * and only then send the samples, track by track */
+    p_sys->i_req = 0;
     for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
     {
         mp4_track_t *tk = &p_sys->track[i_track];
@@ -653,112 +769,896 @@ static int Demux( demux_t *p_demux )
         if( !tk->b_ok || tk->b_chapter || !tk->b_selected || tk->i_sample >= tk->i_sample_count )
             continue;
 
-        while( MP4_TrackGetDTS( p_demux, tk ) < MP4_GetMoviePTS( p_sys ) )
+        MP4_PlanTrack( p_demux, tk );
+    }
+
+    MP4_PlanRead( p_demux );
+    MP4_PlanSend( p_demux );
+
+    return 1;
+}
+
+/*****************************************************************************
+ * Read planner
+ *****************************************************************************
+ * Samples of all the selected tracks needed for the current 100ms window are
+ * first collected, then read sorted by file offset (adjacent samples become
+ * one sequential read) and finally sent to the decoders in track order.
+ *
+ * When tracks are interleaved so badly that every window makes the stream
+ * jump far away and back (which defeats the stream cache and creates a new
+ * range request per sample over HTTP), each track gets its own stream cursor.
+ *****************************************************************************/
+static mp4_sample_req_t *MP4_PlanNewReq( demux_sys_t *p_sys )
+{
+    if( p_sys->i_req >= p_sys->i_req_max )
+    {
+        int i_max = __MAX( 2 * p_sys->i_req_max, 64 );
+        mp4_sample_req_t *p_req;
+        mp4_sample_req_t **pp_read;
+
+        if( i_max > MP4_PLAN_MAX_SAMPLES )
+            return NULL;
+
+        p_req = realloc( p_sys->p_req, i_max * sizeof(*p_req) );
+        if( !p_req )
+            return NULL;
+        p_sys->p_req = p_req;
+
+        pp_read = realloc( p_sys->pp_req_read, i_max * sizeof(*pp_read) );
+        if( !pp_read )
+            return NULL;
+        p_sys->pp_req_read = pp_read;
+
+        p_sys->i_req_max = i_max;
+    }
+    return &p_sys->p_req[p_sys->i_req++];
+}
+
+/* Is the current sample the last one of its chunk, and does the next chunk
+ * use another sample description (and then need a new ES) ? */
+static bool MP4_TrackNextSampleChangesES( mp4_track_t *tk )
+{
+    const mp4_chunk_t *ck = &tk->chunk[tk->i_chunk];
+
+    return tk->i_sample + 1 >= ck->i_sample_first + ck->i_sample_count &&
+           tk->i_chunk + 1 < tk->i_chunk_count &&
+           ck->i_sample_description_index !=
+           tk->chunk[tk->i_chunk + 1].i_sample_description_index;
+}
+
+static void MP4_PlanTrack( demux_t *p_demux, mp4_track_t *tk )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    while( MP4_TrackGetDTS( p_demux, tk ) < MP4_GetMoviePTS( p_sys ) )
+    {
+        const int i_size = MP4_TrackSampleSize( tk );
+
+        if( i_size > 0 )
         {
-#if 0
-            msg_Dbg( p_demux, "tk(%i)=%lld mv=%lld", i_track,
-                     MP4_TrackGetDTS( p_demux, tk ),
-                     MP4_GetMoviePTS( p_sys ) );
-#endif
+            mp4_sample_req_t *p_req = MP4_PlanNewReq( p_sys );
+            if( !p_req )
+                break; /* the rest will be read by the next call */
 
-            if( MP4_TrackSampleSize( tk ) > 0 )
+            p_req->p_track     = tk;
+            p_req->i_pos       = MP4_TrackGetPos( tk );
+            p_req->i_size      = i_size;
+            p_req->i_dts       = MP4_TrackGetDTS( p_demux, tk );
+            p_req->i_pts_delta = MP4_TrackGetPTSDelta( tk );
+            p_req->p_block     = NULL;
+        }
+
+        /* Moving to the next chunk would recreate the ES before the
+         * planned samples are sent, so do it after MP4_PlanSend */
+        if( MP4_TrackNextSampleChangesES( tk ) )
+        {
+            tk->b_es_pending = true;
+            break;
+        }
+
+        /* Next sample */
+        if( MP4_TrackNextSample( p_demux, tk ) )
+            break;
+    }
+}
+
+static int MP4_PlanCompare( const void *p_a, const void *p_b )
+{
+    const mp4_sample_req_t *a = *(const mp4_sample_req_t **)p_a;
+    const mp4_sample_req_t *b = *(const mp4_sample_req_t **)p_b;
+
+    /* Group by stream cursor, then by file offset */
+    if( a->p_track->s != b->p_track->s )
+        return (uintptr_t)a->p_track->s < (uintptr_t)b->p_track->s ? -1 : 1;
+    if( a->i_pos != b->i_pos )
+        return a->i_pos < b->i_pos ? -1 : 1;
+    return a < b ? -1 : ( a > b ? 1 : 0 );
+}
+
+static void MP4_PlanRead( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    stream_t    *s_last = NULL;
+    mp4_track_t *tk_last = NULL;
+    uint64_t     i_next = 0;
+    bool         b_interleaved = false;
+
+    if( p_sys->i_req <= 0 )
+        return;
+
+    for( int i = 0; i < p_sys->i_req; i++ )
+        p_sys->pp_req_read[i] = &p_sys->p_req[i];
+    qsort( p_sys->pp_req_read, p_sys->i_req, sizeof(*p_sys->pp_req_read),
+           MP4_PlanCompare );
+
+    for( int i = 0; i < p_sys->i_req; i++ )
+    {
+        mp4_sample_req_t *p_req = p_sys->pp_req_read[i];
+        mp4_track_t *tk = p_req->p_track;
+        stream_t *s = tk->s ? tk->s : p_demux->s;
+
+        if( !tk->b_selected )
+            continue;
+
+        if( s != s_last || p_req->i_pos != i_next )
+        {
+            bool b_seek = true;
+
+            if( s == s_last && p_req->i_pos > i_next &&
+                p_req->i_pos - i_next <= MP4_PLAN_MAX_GAP )
             {
-                block_t *p_block;
-                int64_t i_delta;
+                /* Small hole, read through it */
+                b_seek = stream_Read( s, NULL, p_req->i_pos - i_next ) !=
+                         (int)( p_req->i_pos - i_next );
+            }
+            if( s == s_last && tk != tk_last &&
+                ( p_req->i_pos > i_next ? p_req->i_pos - i_next
+                                        : i_next - p_req->i_pos ) > MP4_INTERLEAVE_DISTANCE )
+                b_interleaved = true;
 
-                /* go,go go ! */
-                if( stream_Seek( p_demux->s, MP4_TrackGetPos( tk ) ) )
-                {
-                    msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
-                              tk->i_track_ID );
-                    MP4_TrackUnselect( p_demux, tk );
-                    break;
-                }
+            if( b_seek && stream_Seek( s, p_req->i_pos ) )
+            {
+                msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
+                          tk->i_track_ID );
+                MP4_TrackUnselect( p_demux, tk );
+                s_last = NULL;
+                continue;
+            }
+        }
+
+        /* now read pes */
+        if( !(p_req->p_block = stream_Block( s, p_req->i_size )) )
+        {
+            msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
+                      tk->i_track_ID );
+            MP4_TrackUnselect( p_demux, tk );
+            s_last = NULL;
+            continue;
+        }
+        s_last  = s;
+        tk_last = tk;
+        i_next  = p_req->i_pos + p_req->p_block->i_buffer;
+    }
+
+    /* Detect pathological interleaving */
+    if( p_sys->b_track_streams )
+        return;
+    if( b_interleaved )
+        p_sys->i_interleave_score++;
+    else if( p_sys->i_interleave_score > 0 )
+        p_sys->i_interleave_score--;
+
+    if( p_sys->i_interleave_score >= MP4_INTERLEAVE_WINDOWS )
+        MP4_OpenTrackStreams( p_demux );
+}
+
+static void MP4_PlanSend( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( int i = 0; i < p_sys->i_req; i++ )
+    {
+        mp4_sample_req_t *p_req = &p_sys->p_req[i];
+        mp4_track_t *tk = p_req->p_track;
+        block_t *p_block = p_req->p_block;
 
-                /* now read pes */
-                if( !(p_block =
-                         stream_Block( p_demux->s, MP4_TrackSampleSize(tk) )) )
+        p_req->p_block = NULL;
+        if( !p_block )
+            continue;
+        if( !tk->b_selected )
+        {
+            block_Release( p_block );
+            continue;
+        }
+
+        if( tk->b_drms && tk->p_drms )
+        {
+            if( tk->p_skcr )
+            {
+                uint32_t p_key[4];
+                drms_get_p_key( tk->p_drms, p_key );
+
+                for( size_t i_pos = tk->p_skcr->data.p_skcr->i_init; i_pos < p_block->i_buffer; )
                 {
-                    msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
-                              tk->i_track_ID );
-                    MP4_TrackUnselect( p_demux, tk );
-                    break;
+                    int n = __MIN( tk->p_skcr->data.p_skcr->i_encr, p_block->i_buffer - i_pos );
+                    drms_decrypt( tk->p_drms, (uint32_t*)&p_block->p_buffer[i_pos], n, p_key );
+                    i_pos += n;
+                    i_pos += __MIN( tk->p_skcr->data.p_skcr->i_decr, p_block->i_buffer - i_pos );
                 }
+            }
+            else
+            {
+                drms_decrypt( tk->p_drms, (uint32_t*)p_block->p_buffer,
+                              p_block->i_buffer, NULL );
+            }
+        }
+        else if( tk->fmt.i_cat == SPU_ES )
+        {
+            if( tk->fmt.i_codec == VLC_FOURCC( 's', 'u', 'b', 't' ) &&
+                p_block->i_buffer >= 2 )
+            {
+                uint16_t i_size = GetWBE( p_block->p_buffer );
 
-                if( tk->b_drms && tk->p_drms )
+                if( i_size + 2 <= p_block->i_buffer )
                 {
-                    if( tk->p_skcr )
-                    {
-                        uint32_t p_key[4];
-                        drms_get_p_key( tk->p_drms, p_key );
-
-                        for( size_t i_pos = tk->p_skcr->data.p_skcr->i_init; i_pos < p_block->i_buffer; )
-                        {
-                            int n = __MIN( tk->p_skcr->data.p_skcr->i_encr, p_block->i_buffer - i_pos );
-                            drms_decrypt( tk->p_drms, (uint32_t*)&p_block->p_buffer[i_pos], n, p_key );
-                            i_pos += n;
-                            i_pos += __MIN( tk->p_skcr->data.p_skcr->i_decr, p_block->i_buffer - i_pos );
-                        }
-                    }
-                    else
+                    char *p;
+                    /* remove the length field, and append a '\0' */
+                    memmove( &p_block->p_buffer[0],
+                             &p_block->p_buffer[2], i_size );
+                    p_block->p_buffer[i_size] = '\0';
+                    p_block->i_buffer = i_size + 1;
+
+                    /* convert \r -> \n */
+                    while( ( p = strchr((char *) p_block->p_buffer, '\r' ) ) )
                     {
-                        drms_decrypt( tk->p_drms, (uint32_t*)p_block->p_buffer,
-                                      p_block->i_buffer, NULL );
+                        *p = '\n';
                     }
                 }
-                else if( tk->fmt.i_cat == SPU_ES )
+                else
                 {
-                    if( tk->fmt.i_codec == VLC_FOURCC( 's', 'u', 'b', 't' ) &&
-                        p_block->i_buffer >= 2 )
-                    {
-                        uint16_t i_size = GetWBE( p_block->p_buffer );
+                    /* Invalid */
+                    p_block->i_buffer = 0;
+                }
+            }
+        }
+        /* dts */
+        p_block->i_dts = VLC_TS_0 + p_req->i_dts;
+        /* pts */
+        if( p_req->i_pts_delta != -1 )
+            p_block->i_pts = p_block->i_dts + p_req->i_pts_delta;
+        else if( tk->fmt.i_cat != VIDEO_ES )
+            p_block->i_pts = p_block->i_dts;
+        else
+            p_block->i_pts = VLC_TS_INVALID;
 
-                        if( i_size + 2 <= p_block->i_buffer )
-                        {
-                            char *p;
-                            /* remove the length field, and append a '\0' */
-                            memmove( &p_block->p_buffer[0],
-                                     &p_block->p_buffer[2], i_size );
-                            p_block->p_buffer[i_size] = '\0';
-                            p_block->i_buffer = i_size + 1;
-
-                            /* convert \r -> \n */
-                            while( ( p = strchr((char *) p_block->p_buffer, '\r' ) ) )
-                            {
-                                *p = '\n';
-                            }
-                        }
-                        else
-                        {
-                            /* Invalid */
-                            p_block->i_buffer = 0;
-                        }
-                    }
+        if( !tk->b_drms || ( tk->b_drms && tk->p_drms ) )
+            es_out_Send( p_demux->out, tk->p_es, p_block );
+        else
+            block_Release( p_block );
+    }
+    p_sys->i_req = 0;
+
+    /* Now that the samples have been sent, move to the chunks with a new
+     * sample description */
+    for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i_track];
+
+        if( !tk->b_es_pending )
+            continue;
+        tk->b_es_pending = false;
+        if( tk->b_selected )
+            MP4_TrackNextSample( p_demux, tk );
+    }
+}
+
+static void MP4_OpenTrackStreams( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    char *psz_url;
+    bool b_first = true;
+
+    /* Whatever happens, do it only once */
+    p_sys->b_track_streams = true;
+
+    if( asprintf( &psz_url, "%s://%s", p_demux->psz_access,
+                  p_demux->psz_location ) < 0 )
+        return;
+
+    msg_Dbg( p_demux, "badly interleaved file, using one stream per track" );
+    for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i_track];
+
+        if( !tk->b_ok || tk->b_chapter || !tk->b_selected )
+            continue;
+
+        /* The first track keeps the demuxer stream */
+        if( b_first )
+        {
+            b_first = false;
+            continue;
+        }
+
+        tk->s = stream_UrlNew( p_demux, psz_url );
+        if( !tk->s )
+        {
+            msg_Warn( p_demux, "cannot open a stream for track[Id 0x%x]",
+                      tk->i_track_ID );
+            break;
+        }
+    }
+    free( psz_url );
+}
+
+/*****************************************************************************
+ * Fragmented files
+ *****************************************************************************
+ * The moov only describes the tracks, the samples are given by the movie
+ * fragments (moof/traf/trun) which are parsed one at a time when a track runs
+ * out of samples. The samples are then read through the read planner and
+ * forgotten once sent, so the memory only depends on the fragment size.
+ *****************************************************************************/
+static mp4_track_t *FragTrackByID( demux_sys_t *p_sys, uint32_t i_track_ID )
+{
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i];
+        if( tk->b_ok && tk->i_track_ID == i_track_ID )
+            return tk;
+    }
+    return NULL;
+}
+
+static void FragTrackFlush( mp4_track_t *tk )
+{
+    FREENULL( tk->p_frag );
+    tk->i_frag = tk->i_frag_count = tk->i_frag_max = 0;
+}
+
+/* Forget the samples already sent */
+static void FragTrackCompact( mp4_track_t *tk )
+{
+    if( tk->i_frag <= 0 )
+        return;
+    if( tk->i_frag >= tk->i_frag_count )
+    {
+        FragTrackFlush( tk );
+        return;
+    }
+    memmove( &tk->p_frag[0], &tk->p_frag[tk->i_frag],
+             ( tk->i_frag_count - tk->i_frag ) * sizeof(*tk->p_frag) );
+    tk->i_frag_count -= tk->i_frag;
+    tk->i_frag = 0;
+}
+
+static mp4_frag_sample_t *FragTrackNewSample( mp4_track_t *tk )
+{
+    if( tk->i_frag_count >= tk->i_frag_max )
+    {
+        uint32_t i_max = __MAX( 2 * tk->i_frag_max, 64 );
+        mp4_frag_sample_t *p_frag = realloc( tk->p_frag,
+                                             i_max * sizeof(*p_frag) );
+        if( !p_frag )
+            return NULL;
+        tk->p_frag = p_frag;
+        tk->i_frag_max = i_max;
+    }
+    return &tk->p_frag[tk->i_frag_count++];
+}
+
+static inline mtime_t FragTrackTime( const mp4_track_t *tk, uint64_t i_value )
+{
+    return INT64_C(1000000) * i_value / tk->i_timescale;
+}
+
+/* Append the samples described by a moof to their tracks */
+static void FragParseMoof( demux_t *p_demux, MP4_Box_t *p_moof )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_data_end = p_moof->i_pos;
+
+    /* Reset below for the tracks that get samples */
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        if( p_sys->track[i].i_frag_misses < UINT32_MAX )
+            p_sys->track[i].i_frag_misses++;
+    }
+
+    for( MP4_Box_t *p_traf = p_moof->p_first; p_traf; p_traf = p_traf->p_next )
+    {
+        MP4_Box_t *p_tfhd, *p_tfdt;
+        const MP4_Box_data_tfhd_t *tfhd;
+        const MP4_Box_data_trex_t *trex;
+        mp4_track_t *tk;
+        uint64_t i_base, i_pos, i_dts;
+        uint32_t i_dflt_duration, i_dflt_size, i_dflt_flags;
+
+        if( p_traf->i_type != FOURCC_traf ||
+            !( p_tfhd = MP4_BoxGet( p_traf, "tfhd" ) ) || !p_tfhd->data.p_tfhd )
+            continue;
+        tfhd = p_tfhd->data.p_tfhd;
+        tk   = FragTrackByID( p_sys, tfhd->i_track_ID );
+        trex = tk ? tk->p_trex : NULL;
+
+        if( tfhd->i_flags & MP4_TFHD_BASE_DATA_OFFSET )
+            i_base = tfhd->i_base_data_offset;
+        else if( tfhd->i_flags & MP4_TFHD_DEFAULT_BASE_IS_MOOF )
+            i_base = p_moof->i_pos;
+        else
+            i_base = i_data_end;
+
+        i_dflt_duration = ( tfhd->i_flags & MP4_TFHD_DFLT_SAMPLE_DURATION ) ?
+            tfhd->i_default_sample_duration : trex ? trex->i_default_sample_duration : 0;
+        i_dflt_size     = ( tfhd->i_flags & MP4_TFHD_DFLT_SAMPLE_SIZE ) ?
+            tfhd->i_default_sample_size : trex ? trex->i_default_sample_size : 0;
+        i_dflt_flags    = ( tfhd->i_flags & MP4_TFHD_DFLT_SAMPLE_FLAGS ) ?
+            tfhd->i_default_sample_flags : trex ? trex->i_default_sample_flags : 0;
+
+        i_dts = tk ? tk->i_frag_dts : 0;
+        if( ( p_tfdt = MP4_BoxGet( p_traf, "tfdt" ) ) && p_tfdt->data.p_tfdt )
+            i_dts = p_tfdt->data.p_tfdt->i_base_media_decode_time;
+
+        if( tk )
+            FragTrackCompact( tk );
+
+        i_pos = i_base;
+        for( MP4_Box_t *p_trun = p_traf->p_first; p_trun; p_trun = p_trun->p_next )
+        {
+            const MP4_Box_data_trun_t *trun = p_trun->data.p_trun;
+
+            if( p_trun->i_type != FOURCC_trun || !trun )
+                continue;
+
+            if( trun->i_flags & MP4_TRUN_DATA_OFFSET )
+                i_pos = i_base + trun->i_data_offset;
+
+            for( uint32_t i = 0; i < trun->i_sample_count; i++ )
+            {
+                const MP4_descriptor_trun_sample_t *p_entry = &trun->p_samples[i];
+                uint32_t i_duration = ( trun->i_flags & MP4_TRUN_SAMPLE_DURATION ) ?
+                                      p_entry->i_duration : i_dflt_duration;
+                uint32_t i_size     = ( trun->i_flags & MP4_TRUN_SAMPLE_SIZE ) ?
+                                      p_entry->i_size : i_dflt_size;
+                uint32_t i_flags    = ( trun->i_flags & MP4_TRUN_SAMPLE_FLAGS ) ?
+                                      p_entry->i_flags : i_dflt_flags;
+
+                if( i == 0 && ( trun->i_flags & MP4_TRUN_FIRST_FLAGS ) )
+                    i_flags = trun->i_first_sample_flags;
+
+                if( tk )
+                {
+                    mp4_frag_sample_t *p_sample = FragTrackNewSample( tk );
+                    if( !p_sample )
+                        break;
+                    p_sample->i_pos  = i_pos;
+                    p_sample->i_size = i_size;
+                    p_sample->b_sync = !( i_flags & MP4_SAMPLE_FLAG_NON_SYNC );
+                    p_sample->i_dts  = i_dts;
+                    p_sample->i_cts_offset =
+                        ( trun->i_flags & MP4_TRUN_SAMPLE_TIME_OFFSET ) ?
+                        (int32_t)p_entry->i_composition_time_offset : INT32_MIN;
+                    tk->i_frag_misses = 0;
                 }
-                /* dts */
-                p_block->i_dts = VLC_TS_0 + MP4_TrackGetDTS( p_demux, tk );
-                /* pts */
-                i_delta = MP4_TrackGetPTSDelta( tk );
-                if( i_delta != -1 )
-                    p_block->i_pts = p_block->i_dts + i_delta;
-                else if( tk->fmt.i_cat != VIDEO_ES )
-                    p_block->i_pts = p_block->i_dts;
-                else
-                    p_block->i_pts = VLC_TS_INVALID;
+                i_dts += i_duration;
+                i_pos += i_size;
+            }
+        }
+        i_data_end = i_pos;
+        if( tk )
+            tk->i_frag_dts = i_dts;
+    }
+}
+
+/* Add the seek points given by a sidx box at i_sidx_pos. The entry of a
+ * parent sidx (hierarchical or daisy chained) pointing at this one is
+ * replaced by its entries. */
+static void FragIndexFromSidx( demux_t *p_demux, const MP4_Box_data_sidx_t *sidx,
+                               uint64_t i_sidx_pos, uint64_t i_sidx_end )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_offset = i_sidx_end + sidx->i_first_offset;
+    uint64_t i_time = sidx->i_earliest_presentation_time;
+    mp4_frag_index_t *p_index;
+    int i_parent = -1;
+
+    if( sidx->i_timescale == 0 || sidx->i_reference_count == 0 )
+        return;
+
+    for( int i = 0; i < p_sys->i_frag_index; i++ )
+    {
+        if( p_sys->p_frag_index[i].i_offset == i_sidx_pos )
+            i_parent = i;
+    }
+    if( p_sys->i_frag_index > 0 && i_parent < 0 )
+        return;
+
+    const int i_count = p_sys->i_frag_index - ( i_parent >= 0 ) +
+                        sidx->i_reference_count;
+    p_index = calloc( i_count, sizeof(*p_index) );
+    if( !p_index )
+        return;
+
+    const int i_before = i_parent >= 0 ? i_parent : 0;
+    if( i_before > 0 )
+        memcpy( p_index, p_sys->p_frag_index, i_before * sizeof(*p_index) );
+    for( unsigned i = 0; i < sidx->i_reference_count; i++ )
+    {
+        p_index[i_before + i].i_time   = INT64_C(1000000) * i_time / sidx->i_timescale;
+        p_index[i_before + i].i_offset = i_offset;
+        i_time   += sidx->p_subsegment_duration[i];
+        i_offset += sidx->p_referenced_size[i];
+    }
+    if( i_parent >= 0 )
+        memcpy( &p_index[i_before + sidx->i_reference_count],
+                &p_sys->p_frag_index[i_parent + 1],
+                ( p_sys->i_frag_index - i_parent - 1 ) * sizeof(*p_index) );
+
+    free( p_sys->p_frag_index );
+    p_sys->p_frag_index = p_index;
+    p_sys->i_frag_index = i_count;
+
+    if( p_sys->i_duration == 0 )
+        p_sys->i_duration = i_time * p_sys->i_timescale / sidx->i_timescale;
+    msg_Dbg( p_demux, "using sidx index (%d entries)", p_sys->i_frag_index );
+}
+
+/* Is there a seek point at this sidx, that its entries would refine ? */
+static bool FragIndexNeedsSidx( const demux_sys_t *p_sys, uint64_t i_sidx_pos )
+{
+    if( p_sys->i_frag_index <= 0 )
+        return true;
+    for( int i = 0; i < p_sys->i_frag_index; i++ )
+    {
+        if( p_sys->p_frag_index[i].i_offset == i_sidx_pos )
+            return true;
+    }
+    return false;
+}
 
-                if( !tk->b_drms || ( tk->b_drms && tk->p_drms ) )
-                    es_out_Send( p_demux->out, tk->p_es, p_block );
+/* Use the mfra box at the end of the file, if any, as seek index */
+static void FragLoadMfra( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint64_t i_size = stream_Size( p_demux->s );
+    const uint8_t *p_peek;
+    MP4_Box_t *p_mfra;
+    MP4_Box_t *p_tfra_box = NULL;
+
+    if( i_size < 16 || stream_Seek( p_demux->s, i_size - 16 ) ||
+        stream_Peek( p_demux->s, &p_peek, 16 ) < 16 ||
+        VLC_FOURCC( p_peek[4], p_peek[5], p_peek[6], p_peek[7] ) != FOURCC_mfro ||
+        GetDWBE( &p_peek[12] ) < 16 || GetDWBE( &p_peek[12] ) > i_size ||
+        stream_Seek( p_demux->s, i_size - GetDWBE( &p_peek[12] ) ) )
+        goto end;
+
+    if( !( p_mfra = MP4_BoxRead( p_demux->s, NULL ) ) )
+        goto end;
+    if( p_mfra->i_type != FOURCC_mfra )
+    {
+        MP4_BoxFree( p_demux->s, p_mfra );
+        goto end;
+    }
+
+    /* Use the tfra of the first video track (sync points), else the first */
+    for( MP4_Box_t *p_box = p_mfra->p_first; p_box; p_box = p_box->p_next )
+    {
+        mp4_track_t *tk;
+
+        if( p_box->i_type != FOURCC_tfra || !p_box->data.p_tfra ||
+            !( tk = FragTrackByID( p_sys, p_box->data.p_tfra->i_track_ID ) ) )
+            continue;
+        if( !p_tfra_box || tk->fmt.i_cat == VIDEO_ES )
+            p_tfra_box = p_box;
+        if( tk->fmt.i_cat == VIDEO_ES )
+            break;
+    }
+
+    if( p_tfra_box && p_tfra_box->data.p_tfra->i_number_of_entries > 0 )
+    {
+        const MP4_Box_data_tfra_t *tfra = p_tfra_box->data.p_tfra;
+        mp4_track_t *tk = FragTrackByID( p_sys, tfra->i_track_ID );
+
+        p_sys->p_frag_index = calloc( tfra->i_number_of_entries,
+                                      sizeof(*p_sys->p_frag_index) );
+        if( p_sys->p_frag_index )
+        {
+            for( uint32_t i = 0; i < tfra->i_number_of_entries; i++ )
+            {
+                p_sys->p_frag_index[i].i_time =
+                    FragTrackTime( tk, tfra->p_time[i] );
+                p_sys->p_frag_index[i].i_offset = tfra->p_moof_offset[i];
             }
+            p_sys->i_frag_index = tfra->i_number_of_entries;
+            msg_Dbg( p_demux, "using mfra index (%d entries)",
+                     p_sys->i_frag_index );
+        }
+    }
+    MP4_BoxFree( p_demux->s, p_mfra );
+
+end:
+    stream_Seek( p_demux->s, p_sys->i_frag_next );
+}
+
+/* Load the next movie fragment, returns VLC_EGENERIC at the end */
+static int FragLoadNext( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
 
-            /* Next sample */
-            if( MP4_TrackNextSample( p_demux, tk ) )
+    for( ;; )
+    {
+        MP4_Box_t box;
+
+        if( stream_Seek( p_demux->s, p_sys->i_frag_next ) ||
+            !MP4_ReadBoxCommon( p_demux->s, &box ) || box.i_size < 8 )
+            return VLC_EGENERIC;
+
+        switch( box.i_type )
+        {
+            case FOURCC_moof:
+            {
+                MP4_Box_t *p_moof = MP4_BoxRead( p_demux->s, NULL );
+                if( !p_moof )
+                    return VLC_EGENERIC;
+                p_sys->i_frag_next = box.i_pos + box.i_size;
+
+                FragParseMoof( p_demux, p_moof );
+                MP4_BoxFree( p_demux->s, p_moof );
+
+                /* Skip the mdat now: once its samples are read, the next
+                 * fragment is after it and no backward seek is needed */
+                MP4_Box_t mdat;
+                if( stream_Tell( p_demux->s ) == p_sys->i_frag_next &&
+                    MP4_ReadBoxCommon( p_demux->s, &mdat ) &&
+                    mdat.i_type == FOURCC_mdat && mdat.i_size >= 8 )
+                    p_sys->i_frag_next = mdat.i_pos + mdat.i_size;
+                return VLC_SUCCESS;
+            }
+
+            case FOURCC_sidx:
+                if( FragIndexNeedsSidx( p_sys, box.i_pos ) )
+                {
+                    MP4_Box_t *p_sidx = MP4_BoxRead( p_demux->s, NULL );
+                    if( p_sidx && p_sidx->data.p_sidx )
+                        FragIndexFromSidx( p_demux, p_sidx->data.p_sidx,
+                                           box.i_pos, box.i_pos + box.i_size );
+                    MP4_BoxFree( p_demux->s, p_sidx );
+                }
+                break;
+
+            case FOURCC_mfra:
+                return VLC_EGENERIC;
+
+            default: /* mdat, free, styp, ... */
                 break;
         }
+        p_sys->i_frag_next = box.i_pos + box.i_size;
+    }
+}
+
+/* Does a selected audio/video track need another fragment ? Subtitle tracks
+ * are sparse and are not waited for, nor the tracks missing from the last
+ * fragments (that would load the whole file) */
+static bool FragNeedsMore( demux_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        const mp4_track_t *tk = &p_sys->track[i];
+
+        if( tk->b_ok && !tk->b_chapter && tk->b_selected &&
+            tk->fmt.i_cat != SPU_ES && tk->i_frag >= tk->i_frag_count &&
+            tk->i_frag_misses < MP4_FRAG_MISSES_MAX )
+            return true;
     }
+    return false;
+}
+
+/* Return the dts of the next sample to send, or -1 if none is loaded */
+static mtime_t FragNextTime( demux_sys_t *p_sys )
+{
+    mtime_t i_min = -1;
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        const mp4_track_t *tk = &p_sys->track[i];
+        mtime_t i_dts;
+
+        if( !tk->b_ok || tk->b_chapter || !tk->b_selected ||
+            tk->i_frag >= tk->i_frag_count )
+            continue;
+        i_dts = FragTrackTime( tk, tk->p_frag[tk->i_frag].i_dts );
+        if( i_min < 0 || i_dts < i_min )
+            i_min = i_dts;
+    }
+    return i_min;
+}
+
+static int DemuxFrag( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    unsigned int i_track_selected = 0;
+    mtime_t i_next;
+
+    /* check for newly selected/unselected track */
+    for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i_track];
+        bool b;
+
+        if( !tk->b_ok || tk->b_chapter )
+            continue;
+
+        es_out_Control( p_demux->out, ES_OUT_GET_ES_STATE, tk->p_es, &b );
+
+        if( tk->b_selected && !b )
+            MP4_TrackUnselect( p_demux, tk );
+        else if( !tk->b_selected && b )
+            MP4_TrackSelect( p_demux, tk, MP4_GetMoviePTS( p_sys ) );
+
+        if( tk->b_selected )
+            i_track_selected++;
+    }
+
+    if( i_track_selected <= 0 )
+    {
+        msg_Warn( p_demux, "no track selected, exiting..." );
+        return 0;
+    }
+
+    /* Load fragments until every selected track has something to send */
+    while( !p_sys->b_frag_eof && FragNeedsMore( p_sys ) )
+    {
+        if( FragLoadNext( p_demux ) )
+            p_sys->b_frag_eof = true;
+    }
+
+    i_next = FragNextTime( p_sys );
+    if( i_next < 0 )
+        return p_sys->b_frag_eof ? 0 : 1;
+
+    /* Live streams (and holes) do not start at 0 */
+    if( i_next > MP4_GetMoviePTS( p_sys ) + CLOCK_FREQ )
+    {
+        p_sys->i_time = i_next * p_sys->i_timescale / 1000000;
+        p_sys->i_pcr  = i_next;
+    }
+
+    /* */
+    MP4_UpdateSeekpoint( p_demux );
+
+    es_out_Control( p_demux->out, ES_OUT_SET_PCR, VLC_TS_0 + p_sys->i_pcr );
+
+    p_sys->i_pcr = MP4_GetMoviePTS( p_sys );
+
+    /* we will read 100ms for each stream so ...*/
+    p_sys->i_time += __MAX( p_sys->i_timescale / 10 , 1 );
+
+    p_sys->i_req = 0;
+    for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i_track];
+
+        if( !tk->b_ok || tk->b_chapter || !tk->b_selected )
+            continue;
+
+        while( tk->i_frag < tk->i_frag_count )
+        {
+            const mp4_frag_sample_t *p_sample = &tk->p_frag[tk->i_frag];
+            const mtime_t i_dts = FragTrackTime( tk, p_sample->i_dts );
+            mp4_sample_req_t *p_req;
+
+            if( i_dts >= MP4_GetMoviePTS( p_sys ) )
+                break;
+            if( p_sample->i_size > 0 )
+            {
+                if( !( p_req = MP4_PlanNewReq( p_sys ) ) )
+                    break;
+                p_req->p_track     = tk;
+                p_req->i_pos       = p_sample->i_pos;
+                p_req->i_size      = p_sample->i_size;
+                p_req->i_dts       = i_dts;
+                p_req->i_pts_delta = p_sample->i_cts_offset != INT32_MIN ?
+                    p_sample->i_cts_offset * INT64_C(1000000) /
+                    (int64_t)tk->i_timescale : -1;
+                p_req->p_block     = NULL;
+            }
+            tk->i_frag++;
+        }
+    }
+
+    MP4_PlanRead( p_demux );
+    MP4_PlanSend( p_demux );
+
+    for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+        FragTrackCompact( &p_sys->track[i_track] );
 
     return 1;
 }
 
+static int FragSeek( demux_t *p_demux, mtime_t i_date )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_track_t *p_ref = NULL;
+    uint64_t i_pos = p_sys->i_frag_first;
+    mtime_t  i_start = 0;
+
+    /* Find the closest indexed fragment */
+    for( int i = 0; i < p_sys->i_frag_index; i++ )
+    {
+        if( p_sys->p_frag_index[i].i_time > i_date )
+            break;
+        i_pos   = p_sys->p_frag_index[i].i_offset;
+        i_start = p_sys->p_frag_index[i].i_time;
+    }
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i];
+
+        FragTrackFlush( tk );
+        tk->i_frag_misses = 0;
+        /* tfdt, if present, will override it */
+        tk->i_frag_dts = i_start * tk->i_timescale / 1000000;
+
+        if( tk->b_ok && !tk->b_chapter && tk->b_selected &&
+            ( !p_ref || ( tk->fmt.i_cat == VIDEO_ES && p_ref->fmt.i_cat != VIDEO_ES ) ) )
+            p_ref = tk;
+    }
+    p_sys->i_frag_next = i_pos;
+    p_sys->b_frag_eof  = false;
+
+    /* Load fragments up to the one containing i_date (there is usually
+     * nothing to skip when an index exists) */
+    while( p_ref )
+    {
+        if( FragLoadNext( p_demux ) )
+        {
+            p_sys->b_frag_eof = true;
+            break;
+        }
+        if( p_ref->i_frag_count > 0 &&
+            FragTrackTime( p_ref, p_ref->p_frag[p_ref->i_frag_count-1].i_dts ) >= i_date )
+            break;
+        if( p_ref->i_frag_misses >= MP4_FRAG_MISSES_MAX )
+            break;
+        for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+            FragTrackFlush( &p_sys->track[i] );
+    }
+
+    /* Start from the last sync sample of the reference track before i_date */
+    if( p_ref && p_ref->i_frag_count > 0 )
+    {
+        uint32_t i_sync = 0;
+        for( uint32_t i = 0; i < p_ref->i_frag_count; i++ )
+        {
+            if( FragTrackTime( p_ref, p_ref->p_frag[i].i_dts ) > i_date )
+                break;
+            if( p_ref->p_frag[i].b_sync )
+                i_sync = i;
+        }
+        i_date = FragTrackTime( p_ref, p_ref->p_frag[i_sync].i_dts );
+    }
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i];
+
+        while( tk->i_frag < tk->i_frag_count &&
+               FragTrackTime( tk, tk->p_frag[tk->i_frag].i_dts ) < i_date )
+            tk->i_frag++;
+        FragTrackCompact( tk );
+    }
+
+    p_sys->i_time = i_date * p_sys->i_timescale / 1000000;
+    p_sys->i_pcr  = i_date;
+    MP4_UpdateSeekpoint( p_demux );
+
+    es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME, i_date );
+
+    return VLC_SUCCESS;
+}
+
 static void MP4_UpdateSeekpoint( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -788,6 +1688,9 @@ static int Seek( demux_t *p_demux, mtime_t i_date )
     demux_sys_t *p_sys = p_demux->p_sys;
     unsigned int i_track;
 
+    if( p_sys->b_fragmented )
+        return FragSeek( p_demux, i_date );
+
     /* First update update global time */
     p_sys->i_time = i_date * p_sys->i_timescale / 1000000;
     p_sys->i_pcr  = i_date;
@@ -1041,6 +1944,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         case DEMUX_GET_ATTACHMENTS:
         case DEMUX_GET_PTS_DELAY:
         case DEMUX_CAN_RECORD:
+        case DEMUX_GET_NETWORK_STATS:
             return VLC_EGENERIC;
 
         default:
@@ -1070,6 +1974,9 @@ static void Close ( vlc_object_t * p_this )
     if( p_sys->p_title )
         vlc_input_title_Delete( p_sys->p_title );
 
+    free( p_sys->p_req );
+    free( p_sys->pp_req_read );
+    free( p_sys->p_frag_index );
     free( p_sys );
 }
 
@@ -1201,10 +2108,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = p_co64->data.p_co64->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -1257,13 +2160,13 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     MP4_Box_t *p_box;
     MP4_Box_data_stsz_t *stsz;
     MP4_Box_data_stts_t *stts;
-    /* TODO use also stss and stsh table for seeking */
+    MP4_Box_data_ctts_t *ctts;
+    /* TODO use also stsh table for seeking */
     /* FIXME use edit table */
-    int64_t i_sample;
-    int64_t i_chunk;
+    uint32_t i_chunk;
 
-    int64_t i_index;
-    int64_t i_index_sample_used;
+    uint32_t i_index;
+    uint32_t i_index_sample_used;
 
     int64_t i_next_dts;
 
@@ -1290,11 +2193,18 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     stts = p_box->data.p_stts;
 
-    /* Use stsz table to create a sample number -> sample size table */
+    /* Find ctts
+     *  Gives the delta between decoding time (dts) and composition table (pts)
+     */
+    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
+    ctts = p_box ? p_box->data.p_ctts : NULL;
+
+    /* The sample size table is used as is, the stsz box is kept until the
+     * demuxer is closed */
     p_demux_track->i_sample_count = stsz->i_sample_count;
     if( stsz->i_sample_size )
     {
-        /* 1: all sample have the same size, so no need to construct a table */
+        /* 1: all sample have the same size, so no need of a table */
         p_demux_track->i_sample_size = stsz->i_sample_size;
         p_demux_track->p_sample_size = NULL;
     }
@@ -1302,76 +2212,38 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     {
         /* 2: each sample can have a different size */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
+        if( p_demux_track->p_sample_size == NULL &&
+            p_demux_track->i_sample_count > 0 )
+            return VLC_EGENERIC;
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
+    /* Only remember for each chunk where its first sample lies in the stts
+     * (and ctts) runs, the tables are never expanded */
+    p_demux_track->p_stts = stts;
     i_next_dts = 0;
     i_index = 0; i_index_sample_used = 0;
     for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
     {
         mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-        int64_t i_entry, i_sample_count, i;
+        uint32_t i_sample_count = ck->i_sample_count;
 
-        /* save first dts */
-        ck->i_first_dts = i_next_dts;
-        ck->i_last_dts  = i_next_dts;
+        ck->i_first_dts  = i_next_dts;
+        ck->i_last_dts   = i_next_dts;
+        ck->i_stts_entry = i_index;
+        ck->i_stts_skip  = i_index_sample_used;
 
-        /* count how many entries are needed for this chunk
-         * for p_sample_delta_dts and p_sample_count_dts */
-        i_sample_count = ck->i_sample_count;
-
-        i_entry = 0;
-        while( i_sample_count > 0 )
-        {
-            i_sample_count -= stts->i_sample_count[i_index+i_entry];
-            /* don't count already used sample in this entry */
-            if( i_entry == 0 )
-                i_sample_count += i_index_sample_used;
-
-            i_entry++;
-        }
-
-        /* allocate them */
-        ck->p_sample_count_dts = calloc( i_entry, sizeof( uint32_t ) );
-        ck->p_sample_delta_dts = calloc( i_entry, sizeof( uint32_t ) );
-
-        if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            return VLC_ENOMEM;
-
-        /* now copy */
-        i_sample_count = ck->i_sample_count;
-        for( i = 0; i < i_entry; i++ )
+        while( i_sample_count > 0 && i_index < stts->i_entry_count )
         {
-            int64_t i_used;
-            int64_t i_rest;
-
-            i_rest = stts->i_sample_count[i_index] - i_index_sample_used;
-
-            i_used = __MIN( i_rest, i_sample_count );
+            const uint32_t i_used =
+                __MIN( stts->i_sample_count[i_index] - i_index_sample_used,
+                       i_sample_count );
 
             i_index_sample_used += i_used;
             i_sample_count -= i_used;
-            i_next_dts += i_used * stts->i_sample_delta[i_index];
-
-            ck->p_sample_count_dts[i] = i_used;
-            ck->p_sample_delta_dts[i] = stts->i_sample_delta[i_index];
+            i_next_dts += (int64_t)i_used * stts->i_sample_delta[i_index];
             if( i_used > 0 )
-                ck->i_last_dts = i_next_dts - ck->p_sample_delta_dts[i];
+                ck->i_last_dts = i_next_dts - stts->i_sample_delta[i_index];
 
             if( i_index_sample_used >= stts->i_sample_count[i_index] )
             {
@@ -1381,63 +2253,29 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         }
     }
 
-    /* Find ctts
-     *  Gives the delta between decoding time (dts) and composition table (pts)
-     */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
-    if( p_box )
+    if( ctts )
     {
-        MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
-
         msg_Warn( p_demux, "CTTS table" );
 
-        /* Create pts-dts table per chunk */
+        p_demux_track->p_ctts = ctts;
         i_index = 0; i_index_sample_used = 0;
         for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            int64_t i_entry, i_sample_count, i;
+            uint32_t i_sample_count = ck->i_sample_count;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            i_sample_count = ck->i_sample_count;
+            ck->i_ctts_entry = i_index;
+            ck->i_ctts_skip  = i_index_sample_used;
 
-            i_entry = 0;
-            while( i_sample_count > 0 )
+            while( i_sample_count > 0 && i_index < ctts->i_entry_count )
             {
-                i_sample_count -= ctts->i_sample_count[i_index+i_entry];
-
-                /* don't count already used sample in this entry */
-                if( i_entry == 0 )
-                    i_sample_count += i_index_sample_used;
-
-                i_entry++;
-            }
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( i_entry, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-                return VLC_ENOMEM;
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-            for( i = 0; i < i_entry; i++ )
-            {
-                int64_t i_used;
-                int64_t i_rest;
-
-                i_rest = ctts->i_sample_count[i_index] -
-                    i_index_sample_used;
-
-                i_used = __MIN( i_rest, i_sample_count );
+                const uint32_t i_used =
+                    __MIN( ctts->i_sample_count[i_index] - i_index_sample_used,
+                           i_sample_count );
 
                 i_index_sample_used += i_used;
                 i_sample_count -= i_used;
 
-                ck->p_sample_count_pts[i] = i_used;
-                ck->p_sample_offset_pts[i] = ctts->i_sample_offset[i_index];
-
                 if( i_index_sample_used >= ctts->i_sample_count[i_index] )
                 {
                     i_index++;
@@ -2035,6 +2873,24 @@ static int TrackCreateES( demux_t *p_demux, mp4_track_t *p_track,
     return VLC_SUCCESS;
 }
 
+/* Return the chunk containing the sample i_sample */
+static uint32_t TrackSampleToChunk( const mp4_track_t *p_track,
+                                    uint32_t i_sample )
+{
+    uint32_t i_lo = 0, i_hi = p_track->i_chunk_count - 1;
+
+    while( i_lo < i_hi )
+    {
+        const uint32_t i_mid = i_lo + ( i_hi - i_lo + 1 ) / 2;
+
+        if( p_track->chunk[i_mid].i_sample_first <= i_sample )
+            i_lo = i_mid;
+        else
+            i_hi = i_mid - 1;
+    }
+    return i_lo;
+}
+
 /* given a time it return sample/chunk
  * it also update elst field of the track
  */
@@ -2047,7 +2903,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -2091,50 +2946,48 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / (int64_t)1000000;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    /* *** find good chunk: the last one starting at or before i_start *** */
+    i_chunk = 0;
+    for( uint32_t i_hi = p_track->i_chunk_count - 1; i_chunk < i_hi; )
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
+        const uint32_t i_mid = i_chunk + ( i_hi - i_chunk + 1 ) / 2;
 
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+        if( p_track->chunk[i_mid].i_first_dts <= (uint64_t)i_start )
+            i_chunk = i_mid;
+        else
+            i_hi = i_mid - 1;
     }
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+        const MP4_Box_data_stts_t *stts = p_track->p_stts;
+        const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+        uint32_t i_entry = ck->i_stts_entry;
+        uint32_t i_skip  = ck->i_stts_skip;
+        uint32_t i_left  = ck->i_sample_count;
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
+        i_sample = ck->i_sample_first;
+        i_dts    = ck->i_first_dts;
+        while( i_left > 0 && i_entry < stts->i_entry_count )
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
+            const uint32_t i_count = __MIN( stts->i_sample_count[i_entry] - i_skip,
+                                            i_left );
+            const int32_t  i_delta = stts->i_sample_delta[i_entry];
+
+            if( i_dts + (uint64_t)i_count * i_delta < (uint64_t)i_start )
             {
+                i_dts    += (uint64_t)i_count * i_delta;
+                i_sample += i_count;
+                i_left   -= i_count;
+                i_entry++;
+                i_skip = 0;
+            }
+            else
+            {
+                if( i_delta > 0 )
+                    i_sample += ( i_start - i_dts ) / i_delta;
                 break;
             }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-            break;
         }
     }
 
@@ -2153,31 +3006,26 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         MP4_Box_data_stss_t *p_stss = p_box_stss->data.p_stss;
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss->i_entry_count; i_index++ )
+        if( p_stss->i_entry_count > 0 )
         {
-            if( i_index >= p_stss->i_entry_count - 1 ||
-                i_sample < p_stss->i_sample_number[i_index+1] )
+            /* last sync sample at or before i_sample (or the first one) */
+            uint32_t i_lo = 0, i_hi = p_stss->i_entry_count - 1;
+            while( i_lo < i_hi )
             {
-                unsigned i_sync_sample = p_stss->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stts gives %d --> %d (sample number)",
-                         i_sample, i_sync_sample );
+                const uint32_t i_mid = i_lo + ( i_hi - i_lo + 1 ) / 2;
 
-                if( i_sync_sample <= i_sample )
-                {
-                    while( i_chunk > 0 &&
-                           i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
-                        i_chunk--;
-                }
+                if( p_stss->i_sample_number[i_mid] <= i_sample )
+                    i_lo = i_mid;
                 else
-                {
-                    while( i_chunk < p_track->i_chunk_count - 1 &&
-                           i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                            p_track->chunk[i_chunk].i_sample_count )
-                        i_chunk++;
-                }
-                i_sample = i_sync_sample;
-                break;
+                    i_hi = i_mid - 1;
             }
+
+            unsigned i_sync_sample = p_stss->i_sample_number[i_lo];
+            msg_Dbg( p_demux, "stts gives %d --> %d (sample number)",
+                     i_sample, i_sync_sample );
+
+            i_chunk  = TrackSampleToChunk( p_track, i_sync_sample );
+            i_sample = i_sync_sample;
         }
     }
     else
@@ -2235,6 +3083,40 @@ static int TrackGotoChunkSample( demux_t *p_demux, mp4_track_t *p_track,
     return p_track->b_selected ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
+/* Fragmented files have empty sample tables in the moov, create a chunk
+ * that only carries the sample description for TrackCreateES */
+static int TrackCreateFragmentIndex( demux_t *p_demux, mp4_track_t *p_track )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    MP4_Box_t   *p_trex;
+
+    for( int i = 0;
+         ( p_trex = MP4_BoxGet( p_sys->p_root, "/moov/mvex/trex[%d]", i ) ); i++ )
+    {
+        if( p_trex->data.p_trex &&
+            p_trex->data.p_trex->i_track_ID == p_track->i_track_ID )
+        {
+            p_track->p_trex = p_trex->data.p_trex;
+            break;
+        }
+    }
+
+    p_track->chunk = calloc( 1, sizeof( mp4_chunk_t ) );
+    if( p_track->chunk == NULL )
+        return VLC_ENOMEM;
+    p_track->i_chunk_count = 1;
+    p_track->chunk[0].i_sample_description_index =
+        p_track->p_trex && p_track->p_trex->i_default_sample_description_index ?
+        p_track->p_trex->i_default_sample_description_index : 1;
+
+    p_track->i_sample_count = 0;
+    p_track->i_sample_size  = 0;
+    p_track->p_sample_size  = NULL;
+    p_track->p_stts = NULL;
+    p_track->p_ctts = NULL;
+    return VLC_SUCCESS;
+}
+
 /****************************************************************************
  * MP4_TrackCreate:
  ****************************************************************************
@@ -2421,8 +3303,13 @@ static void MP4_TrackCreate( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* Create chunk index table and sample index table */
-    if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
+    if( p_sys->b_fragmented )
+    {
+        if( TrackCreateFragmentIndex( p_demux, p_track ) )
+            return;
+    }
+    else if( TrackCreateChunksIndex( p_demux,p_track  ) ||
+             TrackCreateSamplesIndex( p_demux, p_track ) )
     {
         return; /* cannot create chunks index */
     }
@@ -2488,31 +3375,25 @@ static void MP4_TrackCreate( demux_t *p_demux, mp4_track_t *p_track,
  ****************************************************************************/
 static void MP4_TrackDestroy( mp4_track_t *p_track )
 {
-    unsigned int i_chunk;
-
     p_track->b_ok = false;
     p_track->b_enable   = false;
     p_track->b_selected = false;
 
     es_format_Clean( &p_track->fmt );
 
-    for( i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
+    if( p_track->s )
     {
-        if( p_track->chunk )
-        {
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_dts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_delta_dts );
-
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_pts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_offset_pts );
-        }
+        stream_Delete( p_track->s );
+        p_track->s = NULL;
     }
+
     FREENULL( p_track->chunk );
+    FragTrackFlush( p_track );
 
-    if( !p_track->i_sample_size )
-    {
-        FREENULL( p_track->p_sample_size );
-    }
+    /* the sample size and timing tables belong to the boxes */
+    p_track->p_sample_size = NULL;
+    p_track->p_stts = NULL;
+    p_track->p_ctts = NULL;
 }
 
 static int MP4_TrackSelect( demux_t *p_demux, mp4_track_t *p_track,
@@ -2564,6 +3445,13 @@ static int MP4_TrackSeek( demux_t *p_demux, mp4_track_t *p_track,
     if( !p_track->b_ok || p_track->b_chapter )
         return VLC_EGENERIC;
 
+    /* the samples come from the fragments, loaded for all tracks at once */
+    if( p_demux->p_sys->b_fragmented )
+    {
+        p_track->b_selected = true;
+        return VLC_SUCCESS;
+    }
+
     p_track->b_selected = false;
 
     if( TrackTimeToSampleChunk( p_demux, p_track, i_start,
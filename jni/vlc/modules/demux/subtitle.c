@@ -40,6 +40,7 @@
 
 #include <vlc_demux.h>
 #include <vlc_charset.h>
+#include <vlc_strings.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -57,6 +58,7 @@ static void Close( vlc_object_t *p_this );
     "\"subrip\", \"subviewer\", \"ssa1\", \"ssa2-4\", \"ass\", \"vplayer\", " \
     "\"sami\", \"dvdsubtitle\", \"mpl2\", \"aqt\", \"pjs\", "\
     "\"mpsub\", \"jacosub\", \"psb\", \"realtext\", \"dks\", \"subviewer1\", " \
+    "\"danmaku\", " \
     " and \"auto\" (meaning autodetection, this should always work).")
 #define SUB_DESCRIPTION_LONGTEXT \
     N_("Override the default track description.")
@@ -66,7 +68,7 @@ static const char *const ppsz_sub_type[] =
     "auto", "microdvd", "subrip", "subviewer", "ssa1",
     "ssa2-4", "ass", "vplayer", "sami", "dvdsubtitle", "mpl2",
     "aqt", "pjs", "mpsub", "jacosub", "psb", "realtext", "dks",
-    "subviewer1"
+    "subviewer1", "danmaku"
 };
 
 vlc_module_begin ()
@@ -115,8 +117,9 @@ enum
     SUB_TYPE_PSB,
     SUB_TYPE_RT,
     SUB_TYPE_DKS,
-    SUB_TYPE_SUBVIEW1 /* SUBVIEWER 1 - mplayer calls it subrip09,
+    SUB_TYPE_SUBVIEW1, /* SUBVIEWER 1 - mplayer calls it subrip09,
                          and Gnome subtitles SubViewer 1.0 */
+    SUB_TYPE_DANMAKU, /* bilibili/acfun comments XML */
 };
 
 typedef struct
@@ -170,6 +173,10 @@ struct demux_sys_t
         float f_total;
         float f_factor;
     } mpsub;
+    struct
+    {
+        const char *psz_next; /* next comment in the current line */
+    } danmaku;
 };
 
 static int  ParseMicroDvd   ( demux_t *, subtitle_t *, int );
@@ -189,6 +196,7 @@ static int  ParsePSB        ( demux_t *, subtitle_t *, int );
 static int  ParseRealText   ( demux_t *, subtitle_t *, int );
 static int  ParseDKS        ( demux_t *, subtitle_t *, int );
 static int  ParseSubViewer1 ( demux_t *, subtitle_t *, int );
+static int  ParseDanmaku    ( demux_t *, subtitle_t *, int );
 
 static const struct
 {
@@ -217,6 +225,7 @@ static const struct
     { "realtext",   SUB_TYPE_RT,          "RealText",    ParseRealText },
     { "dks",        SUB_TYPE_DKS,         "DKS",         ParseDKS },
     { "subviewer1", SUB_TYPE_SUBVIEW1,    "Subviewer 1", ParseSubViewer1 },
+    { "danmaku",    SUB_TYPE_DANMAKU,     "Danmaku",     ParseDanmaku },
     { NULL,         SUB_TYPE_UNKNOWN,     "Unknown",     NULL }
 };
 /* When adding support for more formats, be sure to add their file extension
@@ -227,6 +236,7 @@ static int Demux( demux_t * );
 static int Control( demux_t *, int, va_list );
 
 static void Fix( demux_t * );
+static int  SubtitleCompare( const void *, const void * );
 
 /*****************************************************************************
  * Module initializer
@@ -261,6 +271,7 @@ static int Open ( vlc_object_t *p_this )
 
     p_sys->jss.b_inited       = false;
     p_sys->mpsub.b_inited     = false;
+    p_sys->danmaku.psz_next   = NULL;
 
     /* Get the FPS */
     f_fps = var_CreateGetFloat( p_demux, "sub-original-fps" ); /* FIXME */
@@ -319,6 +330,11 @@ static int Open ( vlc_object_t *p_this )
                 p_sys->i_type = SUB_TYPE_SAMI;
                 break;
             }
+            else if( strstr( s, "<d p=\"" ) )
+            {
+                p_sys->i_type = SUB_TYPE_DANMAKU;
+                break;
+            }
             else if( sscanf( s, "{%d}{%d}", &i_dummy, &i_dummy ) == 2 ||
                      sscanf( s, "{%d}{}", &i_dummy ) == 1)
             {
@@ -503,6 +519,13 @@ static int Open ( vlc_object_t *p_this )
     msg_Dbg(p_demux, "loaded %d subtitles", p_sys->i_subtitles );
 
     /* Fix subtitle (order and time) *** */
+    if( p_sys->i_type == SUB_TYPE_DANMAKU )
+    {
+        /* The comments are stored in posting order and there can be
+         * tens of thousands of them, too many for Fix() */
+        qsort( p_sys->subtitle, p_sys->i_subtitles, sizeof(*p_sys->subtitle),
+               SubtitleCompare );
+    }
     p_sys->i_subtitle = 0;
     p_sys->i_length = 0;
     if( p_sys->i_subtitles > 0 )
@@ -521,6 +544,10 @@ static int Open ( vlc_object_t *p_this )
         Fix( p_demux );
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SSA );
     }
+    else if( p_sys->i_type == SUB_TYPE_DANMAKU )
+    {
+        es_format_Init( &fmt, SPU_ES, VLC_CODEC_DANMAKU );
+    }
     else
     {
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SUBT );
@@ -707,6 +734,16 @@ static int Demux( demux_t *p_demux )
     return 1;
 }
 
+static int SubtitleCompare( const void *p_a, const void *p_b )
+{
+    const subtitle_t *p_sub_a = p_a;
+    const subtitle_t *p_sub_b = p_b;
+
+    if( p_sub_a->i_start != p_sub_b->i_start )
+        return p_sub_a->i_start < p_sub_b->i_start ? -1 : 1;
+    return 0;
+}
+
 /*****************************************************************************
  * Fix: fix time stamp and order of subtitle
  *****************************************************************************/
@@ -2068,3 +2105,66 @@ static int ParseSubViewer1( demux_t *p_demux, subtitle_t *p_subtitle, int i_idx
     return VLC_SUCCESS;
 }
 
+
+/* bilibili/acfun comment files: one <d p="time,mode,size,color,...">text</d>
+ * per comment, any number of them per line */
+static int ParseDanmaku( demux_t *p_demux, subtitle_t *p_subtitle, int i_idx )
+{
+    VLC_UNUSED( i_idx );
+
+    demux_sys_t *p_sys = p_demux->p_sys;
+    text_t      *txt = &p_sys->txt;
+
+    for( ;; )
+    {
+        const char *s = p_sys->danmaku.psz_next;
+
+        if( !s || !( s = strstr( s, "<d p=\"" ) ) )
+        {
+            if( !( p_sys->danmaku.psz_next = TextGetLine( txt ) ) )
+                return VLC_EGENERIC;
+            continue;
+        }
+        s += 6;
+
+        const char *psz_body = strchr( s, '>' );
+        const char *psz_end = psz_body ? strstr( psz_body, "</d>" ) : NULL;
+        if( !psz_end )
+        {
+            /* Comments spanning several lines are not supported */
+            p_sys->danmaku.psz_next = NULL;
+            continue;
+        }
+        p_sys->danmaku.psz_next = psz_end + 4;
+        psz_body++;
+
+        /* The time is in seconds with a fractional part */
+        char *psz_attr;
+        const double f_time = us_strtod( s, &psz_attr );
+        int i_mode, i_size;
+        unsigned i_color;
+        if( psz_attr == s || *psz_attr != ',' ||
+            sscanf( psz_attr + 1, "%d,%d,%u", &i_mode, &i_size, &i_color ) != 3 ||
+            f_time < 0 || psz_end == psz_body )
+            continue;
+
+        /* "mode,size,color\ntext" for the danmaku decoder */
+        char psz_attrs[3 * 12];
+        const int i_attrs = snprintf( psz_attrs, sizeof(psz_attrs), "%d,%d,%u\n",
+                                      i_mode, i_size, i_color );
+        const size_t i_body = psz_end - psz_body;
+        char *psz_text = malloc( i_attrs + i_body + 1 );
+        if( !psz_text )
+            return VLC_ENOMEM;
+        memcpy( psz_text, psz_attrs, i_attrs );
+        memcpy( &psz_text[i_attrs], psz_body, i_body );
+        psz_text[i_attrs + i_body] = '\0';
+        resolve_xml_special_chars( &psz_text[i_attrs] );
+
+        /* The display time is chosen by the decoder */
+        p_subtitle->i_start = (int64_t)( f_time * 1000000 );
+        p_subtitle->i_stop  = -1;
+        p_subtitle->psz_text = psz_text;
+        return VLC_SUCCESS;
+    }
+}
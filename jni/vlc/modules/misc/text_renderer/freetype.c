@@ -135,6 +135,10 @@ static void Destroy( vlc_object_t * );
 #define SHADOW_ANGLE_TEXT N_("Shadow angle")
 #define SHADOW_DISTANCE_TEXT N_("Shadow distance")
 
+#define CACHE_TEXT N_("Glyph cache size")
+#define CACHE_LONGTEXT N_("Memory (in kiB) used to keep the rendered glyphs " \
+    "between two subtitles. 0 disables the cache." )
+
 
 static const int pi_sizes[] = { 20, 18, 16, 12, 6 };
 static const char *const ppsz_sizes_text[] = {
@@ -231,6 +235,9 @@ vlc_module_begin ()
 
     add_obsolete_integer( "freetype-effect" );
 
+    add_integer( "freetype-cache-size", 1024, CACHE_TEXT,
+                 CACHE_LONGTEXT, true )
+
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
     set_capability( "text renderer", 100 )
@@ -264,6 +271,42 @@ struct line_desc_t
     line_character_t *p_character;
 };
 
+/* Rendered glyphs, kept in a LRU cache between renders. The bitmaps are
+ * rendered for the fractional part of the pen position only, they are
+ * moved to the integer part when copied out of the cache */
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    glyph_cache_entry_t *p_hash_next;
+    glyph_cache_entry_t *p_lru_prev;
+    glyph_cache_entry_t *p_lru_next;
+
+    /* Key */
+    char           *psz_face;           /* NULL for the default face */
+    int            i_style_flags;       /* STYLE_BOLD and STYLE_ITALIC */
+    int            i_size;
+    int            i_glyph_index;
+    FT_Vector      pen;                 /* fractional parts, 26.6 */
+    FT_Vector      pen_shadow;
+
+    /* */
+    FT_Glyph       p_glyph;
+    FT_Glyph       p_outline;
+    FT_Glyph       p_shadow;
+    FT_Vector      advance;
+    size_t         i_memory;
+};
+
+#define GLYPH_CACHE_BUCKETS 256
+typedef struct
+{
+    glyph_cache_entry_t *pp_bucket[GLYPH_CACHE_BUCKETS];
+    glyph_cache_entry_t *p_lru_first;   /* most recently used */
+    glyph_cache_entry_t *p_lru_last;
+    size_t              i_memory;
+    size_t              i_memory_max;
+} glyph_cache_t;
+
 typedef struct font_stack_t font_stack_t;
 struct font_stack_t
 {
@@ -315,6 +358,8 @@ struct filter_sys_t
 
     input_attachment_t **pp_font_attachments;
     int                  i_font_attachments;
+
+    glyph_cache_t  glyph_cache;
 };
 
 /* */
@@ -1721,22 +1766,165 @@ static bool FaceStyleEquals( const text_style_t *p_style1,
            !strcmp( p_style1->psz_fontname, p_style2->psz_fontname );
 }
 
-static int GetGlyph( filter_t *p_filter,
-                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
-                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
-                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+/*****************************************************************************
+ * Glyph cache
+ *****************************************************************************/
+static unsigned GlyphCacheHash( const char *psz_face, int i_style_flags,
+                                int i_size, int i_glyph_index )
+{
+    unsigned i_hash = i_glyph_index * 2654435761u;
+    i_hash ^= i_size * 40503u + i_style_flags;
+    if( psz_face )
+        for( const char *p = psz_face; *p; p++ )
+            i_hash = i_hash * 31 + (unsigned char)*p;
+    return i_hash % GLYPH_CACHE_BUCKETS;
+}
 
-                     FT_Face  p_face,
-                     int i_glyph_index,
-                     int i_style_flags,
-                     FT_Vector *p_pen,
-                     FT_Vector *p_pen_shadow )
+static bool GlyphCacheMatch( const glyph_cache_entry_t *p_entry,
+                             const char *psz_face, int i_style_flags,
+                             int i_size, int i_glyph_index,
+                             const FT_Vector *p_pen, const FT_Vector *p_pen_shadow )
+{
+    return p_entry->i_glyph_index == i_glyph_index &&
+           p_entry->i_size == i_size &&
+           p_entry->i_style_flags == i_style_flags &&
+           p_entry->pen.x == p_pen->x && p_entry->pen.y == p_pen->y &&
+           p_entry->pen_shadow.x == p_pen_shadow->x &&
+           p_entry->pen_shadow.y == p_pen_shadow->y &&
+           ( p_entry->psz_face == psz_face ||
+             ( p_entry->psz_face && psz_face &&
+               !strcmp( p_entry->psz_face, psz_face ) ) );
+}
+
+static void GlyphCacheEntryDelete( glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->p_glyph )
+        FT_Done_Glyph( p_entry->p_glyph );
+    if( p_entry->p_outline )
+        FT_Done_Glyph( p_entry->p_outline );
+    if( p_entry->p_shadow )
+        FT_Done_Glyph( p_entry->p_shadow );
+    free( p_entry->psz_face );
+    free( p_entry );
+}
+
+static void GlyphCacheLruUnlink( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->p_lru_prev )
+        p_entry->p_lru_prev->p_lru_next = p_entry->p_lru_next;
+    else
+        p_cache->p_lru_first = p_entry->p_lru_next;
+    if( p_entry->p_lru_next )
+        p_entry->p_lru_next->p_lru_prev = p_entry->p_lru_prev;
+    else
+        p_cache->p_lru_last = p_entry->p_lru_prev;
+}
+
+static void GlyphCacheLruPush( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    p_entry->p_lru_prev = NULL;
+    p_entry->p_lru_next = p_cache->p_lru_first;
+    if( p_cache->p_lru_first )
+        p_cache->p_lru_first->p_lru_prev = p_entry;
+    else
+        p_cache->p_lru_last = p_entry;
+    p_cache->p_lru_first = p_entry;
+}
+
+static glyph_cache_entry_t *GlyphCacheFind( glyph_cache_t *p_cache,
+                                            const char *psz_face, int i_style_flags,
+                                            int i_size, int i_glyph_index,
+                                            const FT_Vector *p_pen,
+                                            const FT_Vector *p_pen_shadow )
+{
+    const unsigned i_hash = GlyphCacheHash( psz_face, i_style_flags,
+                                            i_size, i_glyph_index );
+    for( glyph_cache_entry_t *p_entry = p_cache->pp_bucket[i_hash];
+         p_entry != NULL; p_entry = p_entry->p_hash_next )
+    {
+        if( GlyphCacheMatch( p_entry, psz_face, i_style_flags, i_size,
+                             i_glyph_index, p_pen, p_pen_shadow ) )
+        {
+            GlyphCacheLruUnlink( p_cache, p_entry );
+            GlyphCacheLruPush( p_cache, p_entry );
+            return p_entry;
+        }
+    }
+    return NULL;
+}
+
+static void GlyphCacheRemove( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    const unsigned i_hash = GlyphCacheHash( p_entry->psz_face, p_entry->i_style_flags,
+                                            p_entry->i_size, p_entry->i_glyph_index );
+    glyph_cache_entry_t **pp = &p_cache->pp_bucket[i_hash];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+
+    GlyphCacheLruUnlink( p_cache, p_entry );
+    p_cache->i_memory -= p_entry->i_memory;
+    GlyphCacheEntryDelete( p_entry );
+}
+
+/* Returns false if the entry does not fit, it is then owned by the caller */
+static bool GlyphCacheInsert( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->i_memory > p_cache->i_memory_max )
+        return false;
+
+    /* Evict the least recently used glyphs */
+    while( p_cache->i_memory + p_entry->i_memory > p_cache->i_memory_max )
+        GlyphCacheRemove( p_cache, p_cache->p_lru_last );
+
+    const unsigned i_hash = GlyphCacheHash( p_entry->psz_face, p_entry->i_style_flags,
+                                            p_entry->i_size, p_entry->i_glyph_index );
+    p_entry->p_hash_next = p_cache->pp_bucket[i_hash];
+    p_cache->pp_bucket[i_hash] = p_entry;
+    GlyphCacheLruPush( p_cache, p_entry );
+    p_cache->i_memory += p_entry->i_memory;
+    return true;
+}
+
+static void GlyphCacheClean( glyph_cache_t *p_cache )
+{
+    while( p_cache->p_lru_last )
+        GlyphCacheRemove( p_cache, p_cache->p_lru_last );
+}
+
+static size_t GlyphMemory( FT_Glyph glyph )
+{
+    if( !glyph )
+        return 0;
+    const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)glyph)->bitmap;
+    return sizeof(FT_BitmapGlyphRec) + abs( p_bitmap->pitch ) * p_bitmap->rows;
+}
+
+/* Copy a cached bitmap glyph to the integer part of the pen position */
+static FT_Glyph GlyphCopy( FT_Glyph src, const FT_Vector *p_pen, FT_BBox *p_bbox )
+{
+    FT_Glyph glyph;
+    if( !src || FT_Glyph_Copy( src, &glyph ) )
+        return NULL;
+
+    FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)glyph;
+    glyph_bmp->left += p_pen->x >> 6;
+    glyph_bmp->top  += p_pen->y >> 6;
+    FT_Glyph_Get_CBox( glyph, ft_glyph_bbox_pixels, p_bbox );
+    return glyph;
+}
+
+/* Render a glyph with its outline and shadow, for the given pen fractions */
+static glyph_cache_entry_t *RenderGlyph( filter_t *p_filter, FT_Face p_face,
+                                         int i_glyph_index, int i_style_flags,
+                                         const FT_Vector *p_pen,
+                                         const FT_Vector *p_pen_shadow )
 {
     if( FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT ) &&
         FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
     {
         msg_Err( p_filter, "unable to render text FT_Load_Glyph failed" );
-        return VLC_EGENERIC;
+        return NULL;
     }
 
     /* Do synthetic styling now that Freetype supports it;
@@ -1752,7 +1940,7 @@ static int GetGlyph( filter_t *p_filter,
     if( FT_Get_Glyph( p_face->glyph, &glyph ) )
     {
         msg_Err( p_filter, "unable to render text FT_Get_Glyph failed" );
-        return VLC_EGENERIC;
+        return NULL;
     }
 
     FT_Glyph outline = NULL;
@@ -1766,46 +1954,118 @@ static int GetGlyph( filter_t *p_filter,
     if( p_filter->p_sys->i_shadow_opacity > 0 )
     {
         shadow = outline ? outline : glyph;
-        FT_Glyph_To_Bitmap( &shadow, FT_RENDER_MODE_NORMAL, p_pen_shadow, 0 );
-        FT_Glyph_Get_CBox( shadow, ft_glyph_bbox_pixels, p_shadow_bbox );
+        FT_Glyph_To_Bitmap( &shadow, FT_RENDER_MODE_NORMAL, (FT_Vector *)p_pen_shadow, 0 );
     }
-    *pp_shadow = shadow;
 
-    if( FT_Glyph_To_Bitmap( &glyph, FT_RENDER_MODE_NORMAL, p_pen, 1) )
+    if( FT_Glyph_To_Bitmap( &glyph, FT_RENDER_MODE_NORMAL, (FT_Vector *)p_pen, 1) )
     {
         FT_Done_Glyph( glyph );
         if( outline )
             FT_Done_Glyph( outline );
         if( shadow )
             FT_Done_Glyph( shadow );
-        return VLC_EGENERIC;
+        return NULL;
     }
-    FT_Glyph_Get_CBox( glyph, ft_glyph_bbox_pixels, p_glyph_bbox );
-    *pp_glyph = glyph;
-
     if( outline )
+        FT_Glyph_To_Bitmap( &outline, FT_RENDER_MODE_NORMAL, (FT_Vector *)p_pen, 1 );
+
+    glyph_cache_entry_t *p_entry = calloc( 1, sizeof(*p_entry) );
+    if( !p_entry )
+    {
+        FT_Done_Glyph( glyph );
+        if( outline )
+            FT_Done_Glyph( outline );
+        if( shadow )
+            FT_Done_Glyph( shadow );
+        return NULL;
+    }
+    p_entry->p_glyph   = glyph;
+    p_entry->p_outline = outline;
+    p_entry->p_shadow  = shadow;
+    p_entry->advance   = p_face->glyph->advance;
+    p_entry->i_memory  = sizeof(*p_entry) + GlyphMemory( glyph ) +
+                         GlyphMemory( outline ) + GlyphMemory( shadow );
+    return p_entry;
+}
+
+static int GetGlyph( filter_t *p_filter,
+                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
+                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
+                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+                     FT_Vector *p_advance,
+
+                     FT_Face  p_face,
+                     const char *psz_face,
+                     int i_size,
+                     int i_glyph_index,
+                     int i_style_flags,
+                     FT_Vector *p_pen,
+                     FT_Vector *p_pen_shadow )
+{
+    glyph_cache_t *p_cache = &p_filter->p_sys->glyph_cache;
+    const FT_Vector pen = { .x = p_pen->x & 63, .y = p_pen->y & 63 };
+    const FT_Vector pen_shadow = { .x = p_pen_shadow->x & 63, .y = p_pen_shadow->y & 63 };
+
+    i_style_flags &= STYLE_BOLD | STYLE_ITALIC;
+
+    glyph_cache_entry_t *p_entry = GlyphCacheFind( p_cache, psz_face, i_style_flags,
+                                                   i_size, i_glyph_index,
+                                                   &pen, &pen_shadow );
+    bool b_cached = p_entry != NULL;
+    if( !p_entry )
+    {
+        p_entry = RenderGlyph( p_filter, p_face, i_glyph_index, i_style_flags,
+                               &pen, &pen_shadow );
+        if( !p_entry )
+            return VLC_EGENERIC;
+
+        p_entry->psz_face      = psz_face ? strdup( psz_face ) : NULL;
+        p_entry->i_style_flags = i_style_flags;
+        p_entry->i_size        = i_size;
+        p_entry->i_glyph_index = i_glyph_index;
+        p_entry->pen           = pen;
+        p_entry->pen_shadow    = pen_shadow;
+        if( !psz_face || p_entry->psz_face )
+            b_cached = GlyphCacheInsert( p_cache, p_entry );
+    }
+
+    FT_Glyph glyph = GlyphCopy( p_entry->p_glyph, p_pen, p_glyph_bbox );
+    FT_Glyph outline = GlyphCopy( p_entry->p_outline, p_pen, p_outline_bbox );
+    FT_Glyph shadow = GlyphCopy( p_entry->p_shadow, p_pen_shadow, p_shadow_bbox );
+    *p_advance = p_entry->advance;
+
+    if( !b_cached )
+        GlyphCacheEntryDelete( p_entry );
+
+    if( !glyph )
     {
-        FT_Glyph_To_Bitmap( &outline, FT_RENDER_MODE_NORMAL, p_pen, 1 );
-        FT_Glyph_Get_CBox( outline, ft_glyph_bbox_pixels, p_outline_bbox );
+        if( outline )
+            FT_Done_Glyph( outline );
+        if( shadow )
+            FT_Done_Glyph( shadow );
+        return VLC_EGENERIC;
     }
+    *pp_glyph = glyph;
     *pp_outline = outline;
+    *pp_shadow = shadow;
 
     return VLC_SUCCESS;
 }
 
-static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, FT_Face face, const FT_Vector *p_pen )
+static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, const FT_Vector *p_advance,
+                      const FT_Vector *p_pen )
 {
     FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)glyph;
     if( p_bbox->xMin >= p_bbox->xMax )
     {
         p_bbox->xMin = FT_CEIL(p_pen->x);
-        p_bbox->xMax = FT_CEIL(p_pen->x + face->glyph->advance.x);
+        p_bbox->xMax = FT_CEIL(p_pen->x + p_advance->x);
         glyph_bmp->left = p_bbox->xMin;
     }
     if( p_bbox->yMin >= p_bbox->yMax )
     {
         p_bbox->yMax = FT_CEIL(p_pen->y);
-        p_bbox->yMin = FT_CEIL(p_pen->y + face->glyph->advance.y);
+        p_bbox->yMin = FT_CEIL(p_pen->y + p_advance->y);
         glyph_bmp->top  = p_bbox->yMax;
     }
 }
@@ -2048,20 +2308,25 @@ static int ProcessLines( filter_t *p_filter,
                 FT_BBox  outline_bbox;
                 FT_Glyph shadow;
                 FT_BBox  shadow_bbox;
+                FT_Vector advance;
 
                 if( GetGlyph( p_filter,
                               &glyph, &glyph_bbox,
                               &outline, &outline_bbox,
                               &shadow, &shadow_bbox,
-                              p_current_face, i_glyph_index, p_glyph_style->i_style_flags,
+                              &advance,
+                              p_current_face,
+                              p_face ? p_current_style->psz_fontname : NULL,
+                              p_current_style->i_font_size,
+                              i_glyph_index, p_glyph_style->i_style_flags,
                               &pen_new, &pen_shadow_new ) )
                     goto next;
 
-                FixGlyph( glyph, &glyph_bbox, p_current_face, &pen_new );
+                FixGlyph( glyph, &glyph_bbox, &advance, &pen_new );
                 if( outline )
-                    FixGlyph( outline, &outline_bbox, p_current_face, &pen_new );
+                    FixGlyph( outline, &outline_bbox, &advance, &pen_new );
                 if( shadow )
-                    FixGlyph( shadow, &shadow_bbox, p_current_face, &pen_shadow_new );
+                    FixGlyph( shadow, &shadow_bbox, &advance, &pen_shadow_new );
 
                 /* FIXME and what about outline */
 
@@ -2160,8 +2425,8 @@ static int ProcessLines( filter_t *p_filter,
                     .i_line_thickness = i_line_thickness,
                 };
 
-                pen.x = pen_new.x + p_current_face->glyph->advance.x;
-                pen.y = pen_new.y + p_current_face->glyph->advance.y;
+                pen.x = pen_new.x + advance.x;
+                pen.y = pen_new.y + advance.y;
                 line_bbox = line_bbox_new;
             next:
                 i_glyph_last = i_glyph_index;
@@ -2474,6 +2739,9 @@ static int Create( vlc_object_t *p_this )
     p_sys->p_library        = 0;
     p_sys->i_font_size      = 0;
     p_sys->i_display_height = 0;
+    memset( &p_sys->glyph_cache, 0, sizeof(p_sys->glyph_cache) );
+    p_sys->glyph_cache.i_memory_max =
+        __MAX( var_InheritInteger( p_filter, "freetype-cache-size" ), 0 ) * 1024;
 
     var_Create( p_filter, "freetype-rel-fontsize",
                 VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
@@ -2657,6 +2925,7 @@ static void Destroy( vlc_object_t *p_this )
      * even if no other library functions have been made since FcInit(),
      * so don't call it. */
 
+    GlyphCacheClean( &p_sys->glyph_cache );
     if( p_sys->p_stroker )
         FT_Stroker_Done( p_sys->p_stroker );
     FT_Done_Face( p_sys->p_face );
@@ -43,6 +43,7 @@
 #include <vlc_bits.h>
 #include "../codec/cc.h"
 #include "packetizer_helper.h"
+#include "startcode_helper.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -92,7 +93,9 @@ struct decoder_sys_t
 
     /* */
     bool    b_slice;
+    bool    b_frame_end;    /* the source marked the picture complete */
     block_t *p_frame;
+    block_t **pp_last;    /* to append the NAL units in constant time */
     bool    b_frame_sps;
     bool    b_frame_pps;
 
@@ -203,11 +206,14 @@ static int Open( vlc_object_t *p_this )
 
     packetizer_Init( &p_sys->packetizer,
                      p_h264_startcode, sizeof(p_h264_startcode),
+                     startcode_FindAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
 
     p_sys->b_slice = false;
+    p_sys->b_frame_end = false;
     p_sys->p_frame = NULL;
+    p_sys->pp_last = &p_sys->p_frame;
     p_sys->b_frame_sps = false;
     p_sys->b_frame_pps = false;
 
@@ -405,8 +411,23 @@ static void Close( vlc_object_t *p_this )
 static block_t *Packetize( decoder_t *p_dec, block_t **pp_block )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
+    block_t *p_pic = packetizer_Packetize( &p_sys->packetizer, pp_block );
 
-    return packetizer_Packetize( &p_sys->packetizer, pp_block );
+    /* Do not wait for the next access unit to output a picture that the
+     * source (RTP marker bit) has declared complete */
+    if( !p_pic && p_sys->b_frame_end )
+    {
+        p_sys->b_frame_end = false;
+        if( p_sys->b_slice )
+        {
+            p_pic = OutputPicture( p_dec );
+            /* The input block now belongs to the bytestream, it must not
+             * be pushed again by the next call */
+            if( p_pic && pp_block )
+                *pp_block = NULL;
+        }
+    }
+    return p_pic;
 }
 
 /****************************************************************************
@@ -509,11 +530,13 @@ static void PacketizeReset( void *p_private, bool b_broken )
         if( p_sys->p_frame )
             block_ChainRelease( p_sys->p_frame );
         p_sys->p_frame = NULL;
+        p_sys->pp_last = &p_sys->p_frame;
         p_sys->b_frame_sps = false;
         p_sys->b_frame_pps = false;
         p_sys->slice.i_frame_type = 0;
         p_sys->b_slice = false;
     }
+    p_sys->b_frame_end = false;
     p_sys->i_frame_pts = VLC_TS_INVALID;
     p_sys->i_frame_dts = VLC_TS_INVALID;
 }
@@ -612,6 +635,7 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_used_ts, block_t *p_fr
     const int i_nal_type = p_frag->p_buffer[4]&0x1f;
     const mtime_t i_frag_dts = p_frag->i_dts;
     const mtime_t i_frag_pts = p_frag->i_pts;
+    const bool b_frame_end = ( p_frag->i_flags & BLOCK_FLAG_END_OF_FRAME ) != 0;
 
     if( p_sys->b_slice && ( !p_sys->b_sps || !p_sys->b_pps ) )
     {
@@ -621,6 +645,7 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_used_ts, block_t *p_fr
         /* Reset context */
         p_sys->slice.i_frame_type = 0;
         p_sys->p_frame = NULL;
+        p_sys->pp_last = &p_sys->p_frame;
         p_sys->b_frame_sps = false;
         p_sys->b_frame_pps = false;
         p_sys->b_slice = false;
@@ -698,7 +723,7 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_used_ts, block_t *p_fr
 
     /* Append the block */
     if( p_frag )
-        block_ChainAppend( &p_sys->p_frame, p_frag );
+        block_ChainLastAppend( &p_sys->pp_last, p_frag );
 
     *pb_used_ts = false;
     if( p_sys->i_frame_dts <= VLC_TS_INVALID &&
@@ -708,6 +733,8 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_used_ts, block_t *p_fr
         p_sys->i_frame_pts = i_frag_pts;
         *pb_used_ts = true;
     }
+    if( b_frame_end )
+        p_sys->b_frame_end = true;
     return p_pic;
 }
 
@@ -778,6 +805,7 @@ static block_t *OutputPicture( decoder_t *p_dec )
 
     p_sys->slice.i_frame_type = 0;
     p_sys->p_frame = NULL;
+    p_sys->pp_last = &p_sys->p_frame;
     p_sys->i_frame_dts = VLC_TS_INVALID;
     p_sys->i_frame_pts = VLC_TS_INVALID;
     p_sys->b_frame_sps = false;
@@ -45,6 +45,7 @@ typedef struct
 
     int i_startcode;
     const uint8_t *p_startcode;
+    block_startcode_helper_t pf_startcode_helper;
 
     int i_au_prepend;
     const uint8_t *p_au_prepend;
@@ -60,6 +61,7 @@ typedef struct
 
 static inline void packetizer_Init( packetizer_t *p_pack,
                                     const uint8_t *p_startcode, int i_startcode,
+                                    block_startcode_helper_t pf_startcode_helper,
                                     const uint8_t *p_au_prepend, int i_au_prepend,
                                     unsigned i_au_min_size,
                                     packetizer_reset_t pf_reset,
@@ -78,6 +80,7 @@ static inline void packetizer_Init( packetizer_t *p_pack,
 
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
+    p_pack->pf_startcode_helper = pf_startcode_helper;
     p_pack->pf_reset = pf_reset;
     p_pack->pf_parse = pf_parse;
     p_pack->pf_validate = pf_validate;
@@ -89,6 +92,60 @@ static inline void packetizer_Clean( packetizer_t *p_pack )
     block_BytestreamRelease( &p_pack->bytestream );
 }
 
+/* The last block pushed ends a frame, so its end is a unit boundary */
+static inline bool packetizer_IsFrameEnd( const packetizer_t *p_pack )
+{
+    const block_t *p_last = p_pack->bytestream.p_chain;
+
+    if( !p_last )
+        return false;
+    while( p_last->p_next )
+        p_last = p_last->p_next;
+    return ( p_last->i_flags & BLOCK_FLAG_END_OF_FRAME ) != 0;
+}
+
+/* When the unit is the whole end of the current block, possibly followed
+ * by zeros (the first byte of a 4 bytes startcode), the block itself is
+ * detached and returned instead of a copy. The zeros are dropped. */
+static inline block_t *packetizer_DetachUnit( packetizer_t *p_pack )
+{
+    block_bytestream_t *p_bs = &p_pack->bytestream;
+    block_t *p_block = p_bs->p_block;
+    const size_t i_left = p_block->i_buffer - p_bs->i_offset;
+
+    if( p_bs->p_chain != p_block ||
+        p_bs->i_offset < (size_t)p_pack->i_au_prepend ||
+        p_pack->i_offset < i_left )
+        return NULL;
+
+    const size_t i_zero = p_pack->i_offset - i_left;
+    if( i_zero > 0 )
+    {
+        const block_t *p_next = p_block->p_next;
+        if( !p_next || p_next->i_buffer < i_zero )
+            return NULL;
+        for( size_t i = 0; i < i_zero; i++ )
+        {
+            if( p_next->p_buffer[i] )
+                return NULL;
+        }
+    }
+
+    p_bs->p_chain = p_bs->p_block = p_block->p_next;
+    p_block->p_next = NULL;
+
+    p_block->p_buffer += p_bs->i_offset - p_pack->i_au_prepend;
+    p_block->i_buffer = i_left + p_pack->i_au_prepend;
+    if( p_pack->i_au_prepend > 0 )
+        memcpy( p_block->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
+    p_block->i_flags = 0;
+    p_block->i_length = 0;
+    p_block->i_nb_samples = 0;
+
+    p_bs->i_offset = p_bs->p_block ? i_zero : 0;
+    return p_block;
+}
+
 static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_block )
 {
     if( !pp_block || !*pp_block )
@@ -114,6 +171,7 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
     for( ;; )
     {
         bool b_used_ts;
+        bool b_frame_end = false;
         block_t *p_pic;
 
         switch( p_pack->i_state )
@@ -121,7 +179,8 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
         case STATE_NOSYNC:
             /* Find a startcode */
             if( !block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                                p_pack->p_startcode, p_pack->i_startcode ) )
+                                                p_pack->p_startcode, p_pack->i_startcode,
+                                                p_pack->pf_startcode_helper ) )
                 p_pack->i_state = STATE_NEXT_SYNC;
 
             if( p_pack->i_offset )
@@ -139,13 +198,16 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
         case STATE_NEXT_SYNC:
             /* Find the next startcode */
             if( block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                               p_pack->p_startcode, p_pack->i_startcode ) )
+                                               p_pack->p_startcode, p_pack->i_startcode,
+                                               p_pack->pf_startcode_helper ) )
             {
-                if( !p_pack->b_flushing || !p_pack->bytestream.p_chain )
+                b_frame_end = packetizer_IsFrameEnd( p_pack );
+                if( ( !p_pack->b_flushing && !b_frame_end ) ||
+                    !p_pack->bytestream.p_chain )
                     return NULL; /* Need more data */
 
-                /* When flusing and we don't find a startcode, suppose that
-                 * the data extend up to the end */
+                /* When flusing or at the end of a frame and we don't find a
+                 * startcode, suppose that the data extend up to the end */
                 block_ChainProperties( p_pack->bytestream.p_chain,
                                        NULL, &p_pack->i_offset, NULL );
                 p_pack->i_offset -= p_pack->bytestream .i_offset;
@@ -159,14 +221,25 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
             /* Get the new fragment and set the pts/dts */
             block_t *p_block_bytestream = p_pack->bytestream.p_block;
 
-            p_pic = block_New( p_dec, p_pack->i_offset + p_pack->i_au_prepend );
-            p_pic->i_pts = p_block_bytestream->i_pts;
-            p_pic->i_dts = p_block_bytestream->i_dts;
-
-            block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
-                            p_pic->i_buffer - p_pack->i_au_prepend );
-            if( p_pack->i_au_prepend > 0 )
-                memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
+            p_pic = packetizer_DetachUnit( p_pack );
+            if( p_pic )
+            {
+                /* Its timestamps cannot be used twice */
+                p_block_bytestream = NULL;
+            }
+            else
+            {
+                p_pic = block_New( p_dec, p_pack->i_offset + p_pack->i_au_prepend );
+                p_pic->i_pts = p_block_bytestream->i_pts;
+                p_pic->i_dts = p_block_bytestream->i_dts;
+
+                block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
+                                p_pic->i_buffer - p_pack->i_au_prepend );
+                if( p_pack->i_au_prepend > 0 )
+                    memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
+            }
+            if( b_frame_end )
+                p_pic->i_flags |= BLOCK_FLAG_END_OF_FRAME;
 
             p_pack->i_offset = 0;
 
@@ -179,7 +252,7 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
             else
             {
                 p_pic = p_pack->pf_parse( p_pack->p_private, &b_used_ts, p_pic );
-                if( b_used_ts )
+                if( b_used_ts && p_block_bytestream )
                 {
                     p_block_bytestream->i_dts = VLC_TS_INVALID;
                     p_block_bytestream->i_pts = VLC_TS_INVALID;
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * startcode_helper.h: Startcodes helpers
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STARTCODE_HELPER_H_
+#define VLC_STARTCODE_HELPER_H_
+
+#include <string.h>
+#ifdef __ARM_NEON__
+#   include <arm_neon.h>
+#endif
+
+/* A 00 00 01 startcode begins with a zero byte, so only the words holding
+ * one need to be looked at byte by byte */
+#define STARTCODE_MATCH( p, i ) \
+    do { \
+        if( (p)[i] == 0 && (p)[(i)+1] == 0 && (p)[(i)+2] == 1 ) \
+            return &(p)[i]; \
+    } while(0)
+
+/* Non zero if one of the bytes of x is zero */
+#define STARTCODE_HAS_ZERO( x ) \
+    ( ( (x) - UINT32_C(0x01010101) ) & ~(x) & UINT32_C(0x80808080) )
+
+/**
+ * It returns the first 00 00 01 startcode fully inside [p, end), or NULL.
+ * Nothing after end is read.
+ */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
+{
+    /* Up to the first aligned word */
+    for( ; ( (uintptr_t)p & 3 ) && p + 3 <= end; p++ )
+        STARTCODE_MATCH( p, 0 );
+
+#ifdef __ARM_NEON__
+    /* 16 bytes at once */
+    for( ; p + 18 <= end; p += 16 )
+    {
+        const uint64x2_t zero = vreinterpretq_u64_u8(
+                                    vceqq_u8( vld1q_u8( p ), vdupq_n_u8( 0 ) ) );
+        if( !( vgetq_lane_u64( zero, 0 ) | vgetq_lane_u64( zero, 1 ) ) )
+            continue;
+        for( int i = 0; i < 16; i++ )
+            STARTCODE_MATCH( p, i );
+    }
+#endif
+
+    /* A word at a time, the last match of a word reads 2 bytes after it */
+    for( ; p + 6 <= end; p += 4 )
+    {
+        uint32_t x;
+        memcpy( &x, p, 4 );
+        if( !STARTCODE_HAS_ZERO( x ) )
+            continue;
+        STARTCODE_MATCH( p, 0 );
+        STARTCODE_MATCH( p, 1 );
+        STARTCODE_MATCH( p, 2 );
+        STARTCODE_MATCH( p, 3 );
+    }
+
+    for( ; p + 3 <= end; p++ )
+        STARTCODE_MATCH( p, 0 );
+
+    return NULL;
+}
+
+#undef STARTCODE_HAS_ZERO
+#undef STARTCODE_MATCH
+
+#endif
@@ -50,11 +50,14 @@ static int  OpenScaler( vlc_object_t * );
 static void CloseScaler( vlc_object_t * );
 
 #define SCALEMODE_TEXT N_("Scaling mode")
-#define SCALEMODE_LONGTEXT N_("Scaling mode to use.")
+#define SCALEMODE_LONGTEXT N_("Scaling mode to use. The automatic mode " \
+    "averages areas when downscaling (its cost only grows with the ratio) " \
+    "and uses bicubic otherwise.")
 
-static const int pi_mode_values[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+static const int pi_mode_values[] = { -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
 const char *const ppsz_mode_descriptions[] =
-{ N_("Fast bilinear"), N_("Bilinear"), N_("Bicubic (good quality)"),
+{ N_("Automatic"),
+  N_("Fast bilinear"), N_("Bilinear"), N_("Bicubic (good quality)"),
   N_("Experimental"), N_("Nearest neighbour (bad quality)"),
   N_("Area"), N_("Luma bicubic / chroma bilinear"), N_("Gauss"),
   N_("SincR"), N_("Lanczos"), N_("Bicubic spline") };
@@ -66,7 +69,7 @@ vlc_module_begin ()
     set_category( CAT_VIDEO )
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     set_callbacks( OpenScaler, CloseScaler )
-    add_integer( "swscale-mode", 2, SCALEMODE_TEXT, SCALEMODE_LONGTEXT, true )
+    add_integer( "swscale-mode", -1, SCALEMODE_TEXT, SCALEMODE_LONGTEXT, true )
         change_integer_list( pi_mode_values, ppsz_mode_descriptions )
 vlc_module_end ()
 
@@ -78,6 +81,30 @@ vlc_module_end ()
 
 void *( *swscale_fast_memcpy )( void *, const void *, size_t );
 
+/* SwsFlags of the scaling modes 0 to 10 */
+static const int pi_sws_flags[] =
+{ SWS_FAST_BILINEAR, SWS_BILINEAR, SWS_BICUBIC, SWS_X, SWS_POINT, SWS_AREA,
+  SWS_BICUBLIN, SWS_GAUSS, SWS_SINC, SWS_LANCZOS, SWS_SPLINE };
+
+/* Number of idle contexts kept per filter: the SPU scaler switches between
+ * region sizes and the display chain between a few crops/sizes */
+#define CONTEXT_CACHE_SIZE (4)
+
+typedef struct
+{
+    int i_fmti, i_fmto;
+    int i_widthi, i_heighti;
+    int i_widtho, i_heighto;
+    int i_flags;
+} context_key_t;
+
+typedef struct
+{
+    struct SwsContext *ctx;
+    context_key_t key;
+    unsigned i_used;                          /* LRU date */
+} context_cache_entry_t;
+
 /**
  * Internal swscale filter structure.
  */
@@ -85,13 +112,22 @@ struct filter_sys_t
 {
     SwsFilter *p_src_filter;
     SwsFilter *p_dst_filter;
-    int i_cpu_mask, i_sws_flags;
+    int i_cpu_mask, i_sws_mode;
 
     video_format_t fmt_in;
     video_format_t fmt_out;
 
     struct SwsContext *ctx;
     struct SwsContext *ctxA;
+    context_key_t key;
+    context_key_t keyA;
+
+    /* Idle contexts */
+    context_cache_entry_t cache[CONTEXT_CACHE_SIZE];
+    unsigned i_cache_date;
+    unsigned i_created;
+    unsigned i_reused;
+
     picture_t *p_src_a;
     picture_t *p_dst_a;
     int i_extend_factor;
@@ -125,6 +161,7 @@ static int GetParameters( ScalerConfiguration *,
                           int i_sws_flags_default );
 
 static int GetSwsCpuMask(void);
+static void ContextCacheClean( filter_sys_t * );
 
 /* SwScaler point resize quality seems really bad, let our scale module do it
  * (change it to true to try) */
@@ -164,21 +201,9 @@ static int OpenScaler( vlc_object_t *p_this )
 
     /* */
     i_sws_mode = var_CreateGetInteger( p_filter, "swscale-mode" );
-    switch( i_sws_mode )
-    {
-    case 0:  p_sys->i_sws_flags = SWS_FAST_BILINEAR; break;
-    case 1:  p_sys->i_sws_flags = SWS_BILINEAR; break;
-    case 2:  p_sys->i_sws_flags = SWS_BICUBIC; break;
-    case 3:  p_sys->i_sws_flags = SWS_X; break;
-    case 4:  p_sys->i_sws_flags = SWS_POINT; break;
-    case 5:  p_sys->i_sws_flags = SWS_AREA; break;
-    case 6:  p_sys->i_sws_flags = SWS_BICUBLIN; break;
-    case 7:  p_sys->i_sws_flags = SWS_GAUSS; break;
-    case 8:  p_sys->i_sws_flags = SWS_SINC; break;
-    case 9:  p_sys->i_sws_flags = SWS_LANCZOS; break;
-    case 10: p_sys->i_sws_flags = SWS_SPLINE; break;
-    default: p_sys->i_sws_flags = SWS_BICUBIC; i_sws_mode = 2; break;
-    }
+    if( i_sws_mode < -1 || i_sws_mode > 10 )
+        i_sws_mode = -1;
+    p_sys->i_sws_mode = i_sws_mode;
 
     p_sys->p_src_filter = NULL;
     p_sys->p_dst_filter = NULL;
@@ -186,6 +211,10 @@ static int OpenScaler( vlc_object_t *p_this )
     /* Misc init */
     p_sys->ctx = NULL;
     p_sys->ctxA = NULL;
+    memset( p_sys->cache, 0, sizeof(p_sys->cache) );
+    p_sys->i_cache_date = 0;
+    p_sys->i_created = 0;
+    p_sys->i_reused = 0;
     p_sys->p_src_a = NULL;
     p_sys->p_dst_a = NULL;
     p_sys->p_src_e = NULL;
@@ -195,19 +224,13 @@ static int OpenScaler( vlc_object_t *p_this )
 
     if( Init( p_filter ) )
     {
+        ContextCacheClean( p_sys );
         if( p_sys->p_src_filter )
             sws_freeFilter( p_sys->p_src_filter );
         free( p_sys );
         return VLC_EGENERIC;
     }
 
-    msg_Dbg( p_filter, "%ix%i chroma: %4.4s -> %ix%i chroma: %4.4s with scaling using %s",
-             p_filter->fmt_in.video.i_width, p_filter->fmt_in.video.i_height,
-             (char *)&p_filter->fmt_in.video.i_chroma,
-             p_filter->fmt_out.video.i_width, p_filter->fmt_out.video.i_height,
-             (char *)&p_filter->fmt_out.video.i_chroma,
-             ppsz_mode_descriptions[i_sws_mode] );
-
     return VLC_SUCCESS;
 }
 
@@ -220,6 +243,9 @@ static void CloseScaler( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     Clean( p_filter );
+    ContextCacheClean( p_sys );
+    msg_Dbg( p_filter, "%u scaling contexts created, %u reused",
+             p_sys->i_created, p_sys->i_reused );
     if( p_sys->p_src_filter )
         sws_freeFilter( p_sys->p_src_filter );
     free( p_sys );
@@ -228,6 +254,8 @@ static void CloseScaler( vlc_object_t *p_this )
 /*****************************************************************************
  * Helpers
  *****************************************************************************/
+/* XXX The libswscale we build against has no ARM code and no flag for NEON,
+ * on ARM the NEON conversions are done by the arm_neon modules instead. */
 static int GetSwsCpuMask(void)
 {
     const unsigned int i_cpu = vlc_CPU();
@@ -247,6 +275,96 @@ static int GetSwsCpuMask(void)
 
     return i_sws_cpu;
 }
+/* The scaler of the mode, the automatic one depending on the ratio */
+static int GetSwsFlags( int i_sws_mode,
+                        const video_format_t *p_fmti,
+                        const video_format_t *p_fmto )
+{
+    if( i_sws_mode >= 0 )
+        return pi_sws_flags[i_sws_mode];
+
+    /* The filter size of area averaging is 1 + ratio where it is
+     * 1 + 4 * ratio for bicubic, and it does not alias */
+    if( (uint64_t)p_fmto->i_width * p_fmto->i_height <
+        (uint64_t)p_fmti->i_width * p_fmti->i_height )
+        return SWS_AREA;
+    return SWS_BICUBIC;
+}
+
+static const char *GetSwsFlagsName( int i_flags )
+{
+    for( unsigned i = 0; i < sizeof(pi_sws_flags)/sizeof(*pi_sws_flags); i++ )
+    {
+        if( i_flags & pi_sws_flags[i] )
+            return ppsz_mode_descriptions[1 + i];
+    }
+    return "?";
+}
+
+/*****************************************************************************
+ * Context cache: contexts are kept when the formats change, and taken back
+ * when an already seen configuration is used again.
+ *****************************************************************************/
+static struct SwsContext *ContextGet( filter_t *p_filter,
+                                      const context_key_t *p_key )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( int i = 0; i < CONTEXT_CACHE_SIZE; i++ )
+    {
+        context_cache_entry_t *p_entry = &p_sys->cache[i];
+
+        if( p_entry->ctx && !memcmp( &p_entry->key, p_key, sizeof(*p_key) ) )
+        {
+            struct SwsContext *ctx = p_entry->ctx;
+            p_entry->ctx = NULL;
+            p_sys->i_reused++;
+            return ctx;
+        }
+    }
+
+    p_sys->i_created++;
+    return sws_getContext( p_key->i_widthi, p_key->i_heighti, p_key->i_fmti,
+                           p_key->i_widtho, p_key->i_heighto, p_key->i_fmto,
+                           p_key->i_flags,
+                           p_sys->p_src_filter, p_sys->p_dst_filter, 0 );
+}
+
+static void ContextPut( filter_sys_t *p_sys, struct SwsContext *ctx,
+                        const context_key_t *p_key )
+{
+    context_cache_entry_t *p_oldest = &p_sys->cache[0];
+
+    for( int i = 0; i < CONTEXT_CACHE_SIZE; i++ )
+    {
+        context_cache_entry_t *p_entry = &p_sys->cache[i];
+
+        if( !p_entry->ctx )
+        {
+            p_oldest = p_entry;
+            break;
+        }
+        if( p_entry->i_used < p_oldest->i_used )
+            p_oldest = p_entry;
+    }
+    if( p_oldest->ctx )
+        sws_freeContext( p_oldest->ctx );
+
+    p_oldest->ctx    = ctx;
+    p_oldest->key    = *p_key;
+    p_oldest->i_used = p_sys->i_cache_date++;
+}
+
+static void ContextCacheClean( filter_sys_t *p_sys )
+{
+    for( int i = 0; i < CONTEXT_CACHE_SIZE; i++ )
+    {
+        if( p_sys->cache[i].ctx )
+            sws_freeContext( p_sys->cache[i].ctx );
+        p_sys->cache[i].ctx = NULL;
+    }
+}
+
 static bool IsFmtSimilar( const video_format_t *p_fmt1, const video_format_t *p_fmt2 )
 {
     return p_fmt1->i_chroma == p_fmt2->i_chroma &&
@@ -355,7 +473,8 @@ static int Init( filter_t *p_filter )
 
     /* Init with new parameters */
     ScalerConfiguration cfg;
-    if( GetParameters( &cfg, p_fmti, p_fmto, p_sys->i_sws_flags ) )
+    if( GetParameters( &cfg, p_fmti, p_fmto,
+                       GetSwsFlags( p_sys->i_sws_mode, p_fmti, p_fmto ) ) )
     {
         msg_Err( p_filter, "format not supported" );
         return VLC_EGENERIC;
@@ -375,14 +494,18 @@ static int Init( filter_t *p_filter )
     const unsigned i_fmto_width = p_fmto->i_width * p_sys->i_extend_factor;
     for( int n = 0; n < (cfg.b_has_a ? 2 : 1); n++ )
     {
-        const int i_fmti = n == 0 ? cfg.i_fmti : PIX_FMT_GRAY8;
-        const int i_fmto = n == 0 ? cfg.i_fmto : PIX_FMT_GRAY8;
-        struct SwsContext *ctx;
-
-        ctx = sws_getContext( i_fmti_width, p_fmti->i_height, i_fmti,
-                              i_fmto_width, p_fmto->i_height, i_fmto,
-                              cfg.i_sws_flags | p_sys->i_cpu_mask,
-                              p_sys->p_src_filter, p_sys->p_dst_filter, 0 );
+        context_key_t *p_key = n == 0 ? &p_sys->key : &p_sys->keyA;
+
+        memset( p_key, 0, sizeof(*p_key) );
+        p_key->i_fmti    = n == 0 ? cfg.i_fmti : PIX_FMT_GRAY8;
+        p_key->i_fmto    = n == 0 ? cfg.i_fmto : PIX_FMT_GRAY8;
+        p_key->i_widthi  = i_fmti_width;
+        p_key->i_heighti = p_fmti->i_height;
+        p_key->i_widtho  = i_fmto_width;
+        p_key->i_heighto = p_fmto->i_height;
+        p_key->i_flags   = cfg.i_sws_flags | p_sys->i_cpu_mask;
+
+        struct SwsContext *ctx = ContextGet( p_filter, p_key );
         if( n == 0 )
             p_sys->ctx = ctx;
         else
@@ -421,12 +544,13 @@ static int Init( filter_t *p_filter )
     p_sys->b_swap_uvo = cfg.b_swap_uvo;
 
     video_format_ScaleCropAr( p_fmto, p_fmti );
-#if 0
-    msg_Dbg( p_filter, "%ix%i chroma: %4.4s -> %ix%i chroma: %4.4s extend by %d",
+    msg_Dbg( p_filter, "%ix%i chroma: %4.4s -> %ix%i chroma: %4.4s with %s using %s "
+             "(%u contexts created, %u reused)",
              p_fmti->i_width, p_fmti->i_height, (char *)&p_fmti->i_chroma,
              p_fmto->i_width, p_fmto->i_height, (char *)&p_fmto->i_chroma,
-             p_sys->i_extend_factor );
-#endif
+             cfg.b_copy ? "copy" : "scaling",
+             GetSwsFlagsName( cfg.i_sws_flags ),
+             p_sys->i_created, p_sys->i_reused );
     return VLC_SUCCESS;
 }
 static void Clean( filter_t *p_filter )
@@ -443,11 +567,12 @@ static void Clean( filter_t *p_filter )
     if( p_sys->p_dst_a )
         picture_Release( p_sys->p_dst_a );
 
+    /* Keep the contexts for a later configuration change back */
     if( p_sys->ctxA )
-        sws_freeContext( p_sys->ctxA );
+        ContextPut( p_sys, p_sys->ctxA, &p_sys->keyA );
 
     if( p_sys->ctx )
-        sws_freeContext( p_sys->ctx );
+        ContextPut( p_sys, p_sys->ctx, &p_sys->key );
 
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
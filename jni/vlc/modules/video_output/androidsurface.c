@@ -30,8 +30,12 @@
 #include <vlc_plugin.h>
 #include <vlc_vout_display.h>
 #include <vlc_picture_pool.h>
+#include <vlc_cpu.h>
 
 #include <dlfcn.h>
+#ifdef __ARM_NEON__
+# include <arm_neon.h>
+#endif
 
 #ifndef ANDROID_SYM_S_LOCK
 # define ANDROID_SYM_S_LOCK "_ZN7android7Surface4lockEPNS0_11SurfaceInfoEb"
@@ -80,12 +84,25 @@ typedef void (*Surface_unlockAndPost)(void *);
  *****************************************************************************/
 
 static picture_pool_t   *Pool  (vout_display_t *, unsigned);
+static void             Prepare(vout_display_t *, picture_t *, subpicture_t *);
 static void             Display(vout_display_t *, picture_t *, subpicture_t *);
 static int              Control(vout_display_t *, int, va_list);
+static void             Manage (vout_display_t *);
+
+/* Blend a line of straight alpha RGBA over a RGB565 line */
+typedef void (*blend_line_t)(uint16_t *, const uint8_t *, unsigned, unsigned);
+
+static void BlendLine(uint16_t *, const uint8_t *, unsigned, unsigned);
+#ifdef __ARM_NEON__
+static void BlendLineNEON(uint16_t *, const uint8_t *, unsigned, unsigned);
+#endif
 
 /* */
 struct vout_display_sys_t {
     picture_pool_t *pool;
+    blend_line_t pf_blend;
+    uint8_t *p_line;        /* scaled subpicture line */
+    unsigned i_line;
     void *p_library;
     Surface_lock s_lock;
     Surface_lock2 s_lock2;
@@ -94,6 +111,7 @@ struct vout_display_sys_t {
     picture_resource_t resource;
 
     vlc_object_t *p_vout;
+    void *p_surface;        /* last surface seen by Manage */
 };
 
 /* */
@@ -211,14 +229,26 @@ static int Open(vlc_object_t *p_this) {
         goto enomem;
     }
 
+    /* Subpictures are blended straight into the locked surface */
+    static const vlc_fourcc_t subpicture_chromas[] = { VLC_CODEC_RGBA, 0 };
+    vout_display_info_t info = vd->info;
+    info.subpicture_chromas = subpicture_chromas;
+
+    sys->pf_blend = BlendLine;
+#ifdef __ARM_NEON__
+    if (vlc_CPU() & CPU_CAPABILITY_NEON)
+        sys->pf_blend = BlendLineNEON;
+#endif
+
     /* Setup vout_display */
     vd->sys     = sys;
     vd->fmt     = fmt;
+    vd->info    = info;
     vd->pool    = Pool;
     vd->display = Display;
     vd->control = Control;
-    vd->prepare = NULL;
-    vd->manage  = NULL;
+    vd->prepare = Prepare;
+    vd->manage  = Manage;
 
     /* Fix initial state */
     vout_display_SendEventFullscreen(vd, false);
@@ -239,10 +269,25 @@ static void Close(vlc_object_t *p_this) {
 
     picture_pool_Delete(sys->pool);
     dlclose(sys->p_library);
+    free(sys->p_line);
     free(sys);
     vlc_mutex_unlock(&single_instance);
 }
 
+static void Manage(vout_display_t *vd) {
+    vout_display_sys_t *sys = vd->sys;
+    void *surf;
+
+    // a new surface is blank, the last picture must be displayed again
+    surf = jni_LockAndGetAndroidSurface(sys->p_vout);
+    jni_UnlockAndroidSurface(sys->p_vout);
+    if (surf != sys->p_surface) {
+        sys->p_surface = surf;
+        if (surf)
+            vout_display_SendEventExposed(vd);
+    }
+}
+
 static picture_pool_t *Pool(vout_display_t *vd, unsigned count) {
     vout_display_sys_t *sys = vd->sys;
     VLC_UNUSED(count);
@@ -301,13 +346,159 @@ static void AndroidUnlockSurface(picture_t *picture) {
     jni_UnlockAndroidSurface(sys->p_vout);
 }
 
+/* x / 255 rounded to nearest, exact for x <= 255 * 255 */
+static inline unsigned Div255(unsigned x) {
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+static void BlendLine(uint16_t *dst, const uint8_t *src,
+                      unsigned width, unsigned alpha) {
+    for (unsigned x = 0; x < width; x++, src += 4) {
+        const unsigned a = Div255(src[3] * alpha);
+        if (a == 0)
+            continue;
+
+        const unsigned d = dst[x];
+        const unsigned r5 = d >> 11, g6 = (d >> 5) & 0x3f, b5 = d & 0x1f;
+        const unsigned dr = (r5 << 3) | (r5 >> 2);
+        const unsigned dg = (g6 << 2) | (g6 >> 4);
+        const unsigned db = (b5 << 3) | (b5 >> 2);
+
+        const unsigned r = Div255(src[0] * a + dr * (255 - a));
+        const unsigned g = Div255(src[1] * a + dg * (255 - a));
+        const unsigned b = Div255(src[2] * a + db * (255 - a));
+        dst[x] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    }
+}
+
+#ifdef __ARM_NEON__
+static inline uint8x8_t Div255NEON(uint16x8_t x) {
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+/* 8 pixels per iteration, bit exact with BlendLine */
+static void BlendLineNEON(uint16_t *dst, const uint8_t *src,
+                          unsigned width, unsigned alpha) {
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned x;
+
+    for (x = 0; x + 8 <= width; x += 8, src += 32) {
+        const uint8x8x4_t s = vld4_u8(src);
+        const uint8x8_t a = Div255NEON(vmull_u8(s.val[3], va));
+
+        /* nothing to do for transparent runs (most of a text region) */
+        if (vget_lane_u64(vreinterpret_u64_u8(a), 0) == 0)
+            continue;
+
+        const uint8x8_t ia = vmvn_u8(a);
+        const uint16x8_t d = vld1q_u16(&dst[x]);
+
+        /* expand 565 to 888 by replicating the high bits */
+        uint8x8_t dr = vshrn_n_u16(d, 8);
+        dr = vsri_n_u8(dr, dr, 5);
+        uint8x8_t dg = vshrn_n_u16(d, 3);
+        dg = vsri_n_u8(dg, dg, 6);
+        uint8x8_t db = vmovn_u16(vshlq_n_u16(d, 3));
+        db = vsri_n_u8(db, db, 5);
+
+        const uint8x8_t r = Div255NEON(vmlal_u8(vmull_u8(s.val[0], a), dr, ia));
+        const uint8x8_t g = Div255NEON(vmlal_u8(vmull_u8(s.val[1], a), dg, ia));
+        const uint8x8_t b = Div255NEON(vmlal_u8(vmull_u8(s.val[2], a), db, ia));
+
+        uint16x8_t o = vshll_n_u8(r, 8);
+        o = vsriq_n_u16(o, vshll_n_u8(g, 8), 5);
+        o = vsriq_n_u16(o, vshll_n_u8(b, 8), 11);
+        vst1q_u16(&dst[x], o);
+    }
+    if (x < width)
+        BlendLine(&dst[x], src, width - x, alpha);
+}
+#endif
+
+/* Composite the region rectangles only, scaling them (nearest neighbour) if
+ * the subpicture was not rendered at the picture size */
+static void BlendSubpicture(vout_display_t *vd, picture_t *picture,
+                            subpicture_t *subpicture) {
+    vout_display_sys_t *sys = vd->sys;
+    const int pic_w = picture->format.i_visible_width;
+    const int pic_h = picture->format.i_visible_height;
+    const int spu_w = subpicture->i_original_picture_width  > 0 ?
+                      subpicture->i_original_picture_width  : pic_w;
+    const int spu_h = subpicture->i_original_picture_height > 0 ?
+                      subpicture->i_original_picture_height : pic_h;
+    /* Rendered at the source size, the subpicture has the aligned size of
+     * the picture; rendered at the place size, it covers the visible part */
+    const bool full = spu_w == (int)picture->format.i_width &&
+                      spu_h == (int)picture->format.i_height;
+    const int ref_w = full ? spu_w : pic_w;
+    const int ref_h = full ? spu_h : pic_h;
+    const bool scaled = spu_w != ref_w || spu_h != ref_h;
+    plane_t *p = &picture->p[0];
+
+    if (!p->p_pixels)
+        return;
+
+    for (subpicture_region_t *r = subpicture->p_region; r != NULL; r = r->p_next) {
+        const int alpha = subpicture->i_alpha * r->i_alpha / 255;
+        if (!r->p_picture || r->fmt.i_chroma != VLC_CODEC_RGBA || alpha <= 0)
+            continue;
+
+        const plane_t *sp = &r->p_picture->p[0];
+        const uint8_t *src = sp->p_pixels + r->fmt.i_y_offset * sp->i_pitch +
+                             r->fmt.i_x_offset * 4;
+        const int src_w = r->fmt.i_visible_width;
+        const int src_h = r->fmt.i_visible_height;
+
+        /* Destination rectangle, clipped to the picture */
+        const int x0 = (int64_t)r->i_x * ref_w / spu_w;
+        const int y0 = (int64_t)r->i_y * ref_h / spu_h;
+        const int w  = (int64_t)(r->i_x + src_w) * ref_w / spu_w - x0;
+        const int h  = (int64_t)(r->i_y + src_h) * ref_h / spu_h - y0;
+        const int cx0 = __MAX(x0, 0), cx1 = __MIN(x0 + w, pic_w);
+        const int cy0 = __MAX(y0, 0), cy1 = __MIN(y0 + h, pic_h);
+        if (cx0 >= cx1 || cy0 >= cy1)
+            continue;
+
+        if (scaled && sys->i_line < (unsigned)(cx1 - cx0)) {
+            uint8_t *line = realloc(sys->p_line, 4 * (cx1 - cx0));
+            if (!line)
+                continue;
+            sys->p_line = line;
+            sys->i_line = cx1 - cx0;
+        }
+
+        for (int y = cy0; y < cy1; y++) {
+            uint16_t *dst = (uint16_t *)&p->p_pixels[y * p->i_pitch] + cx0;
+            const uint8_t *line;
+
+            if (scaled) {
+                const uint8_t *src_line = &src[(y - y0) * src_h / h * sp->i_pitch];
+                uint32_t *scaled_line = (uint32_t *)sys->p_line;
+                for (int x = cx0; x < cx1; x++)
+                    memcpy(&scaled_line[x - cx0],
+                           &src_line[4 * ((x - x0) * src_w / w)], 4);
+                line = sys->p_line;
+            } else {
+                line = &src[(y - y0) * sp->i_pitch + 4 * (cx0 - x0)];
+            }
+            sys->pf_blend(dst, line, cx1 - cx0, alpha);
+        }
+    }
+}
+
+static void Prepare(vout_display_t *vd, picture_t *picture, subpicture_t *subpicture) {
+    if (subpicture)
+        BlendSubpicture(vd, picture, subpicture);
+}
+
 static void Display(vout_display_t *vd, picture_t *picture, subpicture_t *subpicture) {
     VLC_UNUSED(vd);
-    VLC_UNUSED(subpicture);
 
 	//__android_log_print(ANDROID_LOG_ERROR, "hoperun", "%ll7d", mdate());
 	
     picture_Release(picture);
+    if (subpicture)
+        subpicture_Delete(subpicture);
 }
 
 static int Control(vout_display_t *vd, int query, va_list args) {
@@ -554,6 +554,20 @@ int libvlc_media_get_stats( libvlc_media_t *p_md,
     p_stats->i_sent_packets = p_itm_stats->i_sent_packets;
     p_stats->i_sent_bytes = p_itm_stats->i_sent_bytes;
     p_stats->f_send_bitrate = p_itm_stats->f_send_bitrate;
+
+    p_stats->i_demux_time = p_itm_stats->i_demux_time;
+    p_stats->i_decode_video_time = p_itm_stats->i_decode_video_time;
+    p_stats->i_decode_audio_time = p_itm_stats->i_decode_audio_time;
+    p_stats->i_convert_time = p_itm_stats->i_convert_time;
+    p_stats->i_blend_time = p_itm_stats->i_blend_time;
+    p_stats->i_display_time = p_itm_stats->i_display_time;
+    p_stats->i_copied_bytes = p_itm_stats->i_copied_bytes;
+    p_stats->i_audio_delay = p_itm_stats->i_audio_delay;
+    p_stats->i_video_queue = p_itm_stats->i_video_queue;
+    p_stats->i_audio_queue = p_itm_stats->i_audio_queue;
+    p_stats->i_network_jitter = p_itm_stats->i_network_jitter;
+    p_stats->i_network_lost = p_itm_stats->i_network_lost;
+    p_stats->i_network_buffer = p_itm_stats->i_network_buffer;
     vlc_mutex_unlock( &p_itm_stats->lock );
     return true;
 }
@@ -30,6 +30,9 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#ifdef HAVE_UNISTD_H
+#   include <unistd.h>
+#endif
 
 #include <vlc_common.h>
 
@@ -177,6 +180,13 @@ struct decoder_owner_sys_t
 #define DECODER_MAX_BUFFERING_AUDIO_DURATION (AOUT_MAX_PREPARE_TIME)
 #define DECODER_MAX_BUFFERING_VIDEO_DURATION (1*CLOCK_FREQ)
 
+/* Decoded pictures which may wait for their display, the automatic count
+ * uses at most DECODER_AHEAD_MEMORY_SHARE of the free memory */
+#define DECODER_AHEAD_MIN (2)
+#define DECODER_AHEAD_AUTO_MAX (8)
+#define DECODER_AHEAD_MAX (32)
+#define DECODER_AHEAD_MEMORY_SHARE (8)
+
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((mtime_t)(DEFAULT_PTS_DELAY * 30))
@@ -1176,7 +1186,8 @@ static void DecoderWaitDate( decoder_t *p_dec,
 }
 
 static void DecoderPlayAudio( decoder_t *p_dec, aout_buffer_t *p_audio,
-                              int *pi_played_sum, int *pi_lost_sum )
+                              int *pi_played_sum, int *pi_lost_sum,
+                              mtime_t *pi_delay )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
     aout_instance_t *p_aout = p_owner->p_aout;
@@ -1255,6 +1266,8 @@ static void DecoderPlayAudio( decoder_t *p_dec, aout_buffer_t *p_audio,
 
         if( !b_reject )
         {
+            /* How long the buffer will wait in the audio output */
+            *pi_delay = p_audio->i_pts - mdate();
             if( !aout_DecPlay( p_aout, p_aout_input, p_audio, i_rate ) )
                 *pi_played_sum += 1;
             *pi_lost_sum += aout_DecGetResetLost( p_aout, p_aout_input );
@@ -1289,9 +1302,17 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
     int i_decoded = 0;
     int i_lost = 0;
     int i_played = 0;
+    mtime_t i_decode_time = 0;
+    mtime_t i_delay = -1;
 
-    while( (p_aout_buf = p_dec->pf_decode_audio( p_dec, &p_block )) )
+    for( ;; )
     {
+        const mtime_t i_start = mdate();
+        p_aout_buf = p_dec->pf_decode_audio( p_dec, &p_block );
+        i_decode_time += mdate() - i_start;
+        if( !p_aout_buf )
+            break;
+
         aout_instance_t *p_aout = p_owner->p_aout;
         aout_input_t    *p_aout_input = p_owner->p_aout_input;
 
@@ -1321,13 +1342,14 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
             p_owner->i_preroll_end = VLC_TS_INVALID;
         }
 
-        DecoderPlayAudio( p_dec, p_aout_buf, &i_played, &i_lost );
+        DecoderPlayAudio( p_dec, p_aout_buf, &i_played, &i_lost, &i_delay );
     }
 
     /* Update ugly stat */
     input_thread_t  *p_input = p_owner->p_input;
 
-    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_played > 0) )
+    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_played > 0 ||
+                            i_decode_time > 0) )
     {
         vlc_mutex_lock( &p_input->p->counters.counters_lock);
 
@@ -1337,6 +1359,13 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
                              i_played, NULL );
         stats_UpdateInteger( p_dec, p_input->p->counters.p_decoded_audio,
                              i_decoded, NULL );
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_decode_audio_time,
+                             i_decode_time, NULL );
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_audio_queue,
+                             block_FifoCount( p_owner->p_fifo ), NULL );
+        if( i_delay >= 0 )
+            stats_UpdateInteger( p_dec, p_input->p->counters.p_audio_delay,
+                                 i_delay, NULL );
 
         vlc_mutex_unlock( &p_input->p->counters.counters_lock);
     }
@@ -1387,7 +1416,8 @@ static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
 }
 
 static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
-                              int *pi_played_sum, int *pi_lost_sum )
+                              int *pi_played_sum, int *pi_lost_sum,
+                              vout_render_statistic_t *p_render_sum )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
     vout_thread_t  *p_vout = p_owner->p_vout;
@@ -1492,10 +1522,16 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
         }
         int i_tmp_display;
         int i_tmp_lost;
-        vout_GetResetStatistic( p_vout, &i_tmp_display, &i_tmp_lost );
+        vout_render_statistic_t tmp_render;
+        vout_GetResetStatistic( p_vout, &i_tmp_display, &i_tmp_lost,
+                                &tmp_render );
 
         *pi_played_sum += i_tmp_display;
         *pi_lost_sum += i_tmp_lost;
+        p_render_sum->i_copied  += tmp_render.i_copied;
+        p_render_sum->i_convert += tmp_render.i_convert;
+        p_render_sum->i_blend   += tmp_render.i_blend;
+        p_render_sum->i_display += tmp_render.i_display;
 
         if( !b_has_more || b_buffering_first )
             break;
@@ -1516,9 +1552,17 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
     int i_lost = 0;
     int i_decoded = 0;
     int i_displayed = 0;
+    vout_render_statistic_t render = { 0, 0, 0, 0 };
+    mtime_t i_decode_time = 0;
 
-    while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) )
+    for( ;; )
     {
+        const mtime_t i_start = mdate();
+        p_pic = p_dec->pf_decode_video( p_dec, &p_block );
+        i_decode_time += mdate() - i_start;
+        if( !p_pic )
+            break;
+
         vout_thread_t  *p_vout = p_owner->p_vout;
         if( DecoderIsExitRequested( p_dec ) )
         {
@@ -1550,13 +1594,14 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
             ( !p_owner->p_packetizer || !p_owner->p_packetizer->pf_get_cc ) )
             DecoderGetCc( p_dec, p_dec );
 
-        DecoderPlayVideo( p_dec, p_pic, &i_displayed, &i_lost );
+        DecoderPlayVideo( p_dec, p_pic, &i_displayed, &i_lost, &render );
     }
 
     /* Update ugly stat */
     input_thread_t *p_input = p_owner->p_input;
 
-    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0) )
+    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0 ||
+                            i_decode_time > 0) )
     {
         vlc_mutex_lock( &p_input->p->counters.counters_lock );
 
@@ -1567,6 +1612,18 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
 
         stats_UpdateInteger( p_dec, p_input->p->counters.p_displayed_pictures,
                              i_displayed, NULL);
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_copied_bytes,
+                             render.i_copied, NULL);
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_convert_time,
+                             render.i_convert, NULL);
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_blend_time,
+                             render.i_blend, NULL);
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_display_time,
+                             render.i_display, NULL);
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_decode_video_time,
+                             i_decode_time, NULL);
+        stats_UpdateInteger( p_dec, p_input->p->counters.p_video_queue,
+                             block_FifoCount( p_owner->p_fifo ), NULL);
 
         vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
@@ -2333,6 +2390,40 @@ static void aout_del_buffer( decoder_t *p_dec, aout_buffer_t *p_buffer )
                           p_owner->p_aout_input, p_buffer );
 }
 
+/* Number of decoded pictures which may be queued ahead of the display */
+static unsigned DecoderGetAheadCount( decoder_t *p_dec, const video_format_t *p_fmt )
+{
+    const int i_ahead = var_InheritInteger( p_dec, "decode-ahead" );
+    if( i_ahead > 0 )
+        return __MIN( i_ahead, DECODER_AHEAD_MAX );
+
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_fmt->i_chroma );
+    uint64_t i_picture = 0;
+    if( p_dsc )
+    {
+        for( unsigned i = 0; i < p_dsc->plane_count; i++ )
+            i_picture += (uint64_t)p_fmt->i_width * p_dsc->p[i].w.num / p_dsc->p[i].w.den *
+                         p_fmt->i_height * p_dsc->p[i].h.num / p_dsc->p[i].h.den *
+                         p_dsc->pixel_size;
+    }
+    if( i_picture == 0 )
+        i_picture = (uint64_t)p_fmt->i_width * p_fmt->i_height * 4;
+
+    unsigned i_count = DECODER_AHEAD_AUTO_MAX;
+#if defined(_SC_AVPHYS_PAGES) && defined(_SC_PAGESIZE)
+    const long i_pages = sysconf( _SC_AVPHYS_PAGES );
+    const long i_page_size = sysconf( _SC_PAGESIZE );
+    if( i_pages > 0 && i_page_size > 0 )
+    {
+        const uint64_t i_budget = (uint64_t)i_pages * i_page_size /
+                                  DECODER_AHEAD_MEMORY_SHARE;
+        i_count = __MIN( i_budget / i_picture, DECODER_AHEAD_AUTO_MAX );
+    }
+#endif
+    return __MAX( i_count, DECODER_AHEAD_MIN );
+}
+
 static picture_t *vout_new_buffer( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -2422,10 +2513,15 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
             dpb_size = 2;
             break;
         }
+        const unsigned i_ahead = DecoderGetAheadCount( p_dec, &fmt );
+        msg_Dbg( p_dec, "up to %u decoded pictures ahead of the display", i_ahead );
+
         p_vout = input_resource_RequestVout( p_owner->p_resource,
                                              p_vout, &fmt,
-                                             dpb_size + 1 + DECODER_MAX_BUFFERING_COUNT,
+                                             dpb_size + 1 + DECODER_MAX_BUFFERING_COUNT +
+                                             i_ahead,
                                              true );
+        p_dec->i_pictures_ahead = p_vout ? i_ahead : 0;
         vlc_mutex_lock( &p_owner->lock );
         p_owner->p_vout = p_vout;
 
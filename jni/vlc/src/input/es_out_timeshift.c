@@ -156,6 +156,9 @@ struct ts_storage_t
 {
     ts_storage_t *p_next;
 
+    /* The blocks of a memory storage are kept as is, no file is used */
+    bool    b_memory;
+
     /* */
     char    *psz_file;  /* Filename */
     size_t  i_file_max; /* Max size in bytes */
@@ -177,11 +180,16 @@ typedef struct
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
     const char     *psz_tmp_path;
+    int64_t        i_memory_max;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
 
+    /* */
+    int64_t        i_memory_size;
+    bool           b_memory_full;
+
     /* */
     bool           b_paused;
     mtime_t        i_pause_date;
@@ -206,6 +214,9 @@ typedef struct
 struct es_out_id_t
 {
     es_out_id_t *p_es;
+
+    /* A block has been dropped (protected by the ts_thread_t lock) */
+    bool        b_discontinuity;
 };
 
 struct es_out_sys_t
@@ -215,7 +226,8 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
-    char           *psz_tmp_path;     /* Path for temporary files */
+    char           *psz_tmp_path;     /* Path for temporary files (or NULL) */
+    int64_t        i_memory_max;      /* Maximal size kept in memory in byte */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -255,6 +267,7 @@ static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
 static void         *TsRun( void * );
 
 static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static size_t       TsStorageCmdSize( const ts_cmd_t *p_cmd );
 static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
@@ -331,11 +344,23 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     else
         p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1*1024*1024 );
 
+    const int64_t i_memory_max = var_CreateGetInteger( p_input, "input-timeshift-memory" );
+    p_sys->i_memory_max = __MAX( i_memory_max, 0 );
+
+    /* With a memory budget, the temporary files are only used to spill
+     * what does not fit in it and only when a path has been given */
     char *psz_tmp_path = var_CreateGetNonEmptyString( p_input, "input-timeshift-path" );
-    p_sys->psz_tmp_path = GetTmpPath( psz_tmp_path );
+    if( psz_tmp_path || p_sys->i_memory_max <= 0 )
+        p_sys->psz_tmp_path = GetTmpPath( psz_tmp_path );
+    else
+        p_sys->psz_tmp_path = NULL;
 
-    msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
-             (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
+    if( p_sys->i_memory_max > 0 )
+        msg_Dbg( p_input, "using timeshift memory of %d MiB",
+                 (int)(p_sys->i_memory_max/(1024*1024)) );
+    if( p_sys->psz_tmp_path )
+        msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
+                 (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
 
 #if 0
 #define S(t) msg_Err( p_input, "SIZEOF("#t")=%d", sizeof(t) )
@@ -381,6 +406,7 @@ static es_out_id_t *Add( es_out_t *p_out, const es_format_t *p_fmt )
     es_out_id_t *p_es = malloc( sizeof( *p_es ) );
     if( !p_es )
         return NULL;
+    p_es->b_discontinuity = false;
 
     vlc_mutex_lock( &p_sys->lock );
 
@@ -742,6 +768,9 @@ static int TsStart( es_out_t *p_out )
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
+    p_ts->i_memory_max = p_sys->i_memory_max;
+    p_ts->i_memory_size = 0;
+    p_ts->b_memory_full = false;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
     vlc_mutex_init( &p_ts->lock );
@@ -804,36 +833,81 @@ static void TsStop( ts_thread_t *p_ts )
 
     TsDestroy( p_ts );
 }
+static ts_storage_t *TsGetStorageLocked( ts_thread_t *p_ts, const ts_cmd_t *p_cmd )
+{
+    ts_storage_t *p_storage = p_ts->p_storage_w;
+
+    vlc_assert_locked( &p_ts->lock );
+
+    /* Do not come back to memory before the current file is full */
+    if( p_storage && !p_storage->b_memory && !TsStorageIsFull( p_storage, p_cmd ) )
+        return p_storage;
+
+    /* Only the blocks are accounted, the other commands are small */
+    const bool b_memory = p_ts->i_memory_max > 0 &&
+                          ( p_cmd->i_type != C_SEND ||
+                            p_ts->i_memory_size + TsStorageCmdSize( p_cmd ) <= p_ts->i_memory_max );
+    if( !b_memory && !p_ts->psz_tmp_path )
+        return NULL;
+
+    if( p_storage && p_storage->b_memory == b_memory && !TsStorageIsFull( p_storage, p_cmd ) )
+        return p_storage;
+
+    p_storage = TsStorageNew( b_memory ? NULL : p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+    if( !p_storage )
+        return NULL;
+
+    if( !p_ts->p_storage_w )
+    {
+        p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
+    }
+    else
+    {
+        TsStoragePack( p_ts->p_storage_w );
+        p_ts->p_storage_w->p_next = p_storage;
+        p_ts->p_storage_w = p_storage;
+    }
+    return p_storage;
+}
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
 
-    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
+    ts_storage_t *p_storage = TsGetStorageLocked( p_ts, p_cmd );
+    if( !p_storage )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
-
-        if( !p_storage )
+        /* The memory is full and there is no file to spill to: drop the
+         * newest data, the decoders will be told about the hole */
+        if( p_cmd->i_type == C_SEND && p_ts->i_memory_max > 0 )
         {
-            CmdClean( p_cmd );
-            vlc_mutex_unlock( &p_ts->lock );
-            /* TODO warn the user (but only once) */
-            return;
+            if( !p_ts->b_memory_full )
+                msg_Warn( p_ts->p_input, "timeshift memory is full, dropping data" );
+            p_ts->b_memory_full = true;
+            p_cmd->u.send.p_es->b_discontinuity = true;
         }
+        CmdClean( p_cmd );
+        vlc_mutex_unlock( &p_ts->lock );
+        return;
+    }
 
-        if( !p_ts->p_storage_w )
+    if( p_cmd->i_type == C_SEND )
+    {
+        es_out_id_t *p_es = p_cmd->u.send.p_es;
+
+        if( p_es->b_discontinuity )
         {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
+            p_cmd->u.send.p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+            p_es->b_discontinuity = false;
         }
-        else
+        if( p_storage->b_memory )
         {
-            TsStoragePack( p_ts->p_storage_w );
-            p_ts->p_storage_w->p_next = p_storage;
-            p_ts->p_storage_w = p_storage;
+            p_ts->i_memory_size += TsStorageCmdSize( p_cmd );
+            p_ts->b_memory_full = false;
         }
     }
 
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_storage, p_cmd, p_ts->p_storage_r == p_storage );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -847,6 +921,8 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
         return VLC_EGENERIC;
 
     TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+    if( p_ts->p_storage_r->b_memory && p_cmd->i_type == C_SEND )
+        p_ts->i_memory_size -= TsStorageCmdSize( p_cmd );
 
     while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
     {
@@ -1063,11 +1139,15 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_next = NULL;
 
     /* */
+    p_storage->b_memory = psz_tmp_path == NULL;
     p_storage->i_file_max = i_tmp_size_max;
     p_storage->i_file_size = 0;
-    p_storage->p_filew = GetTmpFile( &p_storage->psz_file, psz_tmp_path );
-    if( p_storage->psz_file )
-        p_storage->p_filer = vlc_fopen( p_storage->psz_file, "rb" );
+    if( !p_storage->b_memory )
+    {
+        p_storage->p_filew = GetTmpFile( &p_storage->psz_file, psz_tmp_path );
+        if( p_storage->psz_file )
+            p_storage->p_filer = vlc_fopen( p_storage->psz_file, "rb" );
+    }
 
     /* */
     p_storage->i_cmd_w = 0;
@@ -1076,7 +1156,8 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_cmd = malloc( p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
 
-    if( !p_storage->p_cmd || !p_storage->p_filew || !p_storage->p_filer )
+    if( !p_storage->p_cmd ||
+        ( !p_storage->b_memory && ( !p_storage->p_filew || !p_storage->p_filer ) ) )
     {
         TsStorageDelete( p_storage );
         return NULL;
@@ -1120,11 +1201,18 @@ static void TsStoragePack( ts_storage_t *p_storage )
     if( p_new )
         p_storage->p_cmd = p_new;
 }
+static size_t TsStorageCmdSize( const ts_cmd_t *p_cmd )
+{
+    assert( p_cmd->i_type == C_SEND && p_cmd->u.send.p_block );
+    return sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+}
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
-    if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
+    /* The memory budget is shared by all the storages (see TsPushCmd) */
+    if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 &&
+        !p_storage->b_memory )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = TsStorageCmdSize( p_cmd );
 
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
@@ -1141,7 +1229,7 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
 
     assert( !TsStorageIsFull( p_storage, p_cmd ) );
 
-    if( cmd.i_type == C_SEND )
+    if( cmd.i_type == C_SEND && !p_storage->b_memory )
     {
         block_t *p_block = cmd.u.send.p_block;
 
@@ -1175,7 +1263,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     assert( !TsStorageIsEmpty( p_storage ) );
 
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
-    if( p_cmd->i_type == C_SEND )
+    if( p_cmd->i_type == C_SEND && !p_storage->b_memory )
     {
         block_t block;
 
@@ -1188,7 +1276,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
             {
                 p_block->i_dts      = block.i_dts;
                 p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
+                p_block->i_flags    = block.i_flags & ~BLOCK_FLAG_PADDED;
                 p_block->i_length   = block.i_length;
                 p_block->i_rate     = block.i_rate;
                 p_block->i_nb_samples = block.i_nb_samples;
@@ -550,6 +550,16 @@ static void *Run( void *obj )
     if( Init( p_input ) )
         goto exit;
 
+    /* Prepared state: the decoders are fed until the buffering is done
+     * (the first pictures are decoded and held) but the clock only starts
+     * when the input is unpaused */
+    if( var_InheritBool( p_input, "start-paused" ) )
+    {
+        msg_Dbg( p_input, "starting paused" );
+        vlc_value_t val = { .i_int = PAUSE_S };
+        Control( p_input, INPUT_CONTROL_SET_STATE, val );
+    }
+
     MainLoop( p_input, true ); /* FIXME it can be wrong (like with VLM) */
 
     /* Clean up */
@@ -588,8 +598,20 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed, bool *pb_d
         ( p_input->p->i_run > 0 && i_start_mdate+p_input->p->i_run < mdate() ) )
         i_ret = 0; /* EOF */
     else
+    {
+        const mtime_t i_demux_start = mdate();
         i_ret = demux_Demux( p_input->p->input.p_demux );
 
+        /* The time spent in the access is accounted too */
+        if( libvlc_stats( p_input ) )
+        {
+            vlc_mutex_lock( &p_input->p->counters.counters_lock );
+            stats_UpdateInteger( p_input, p_input->p->counters.p_demux_time,
+                                 mdate() - i_demux_start, NULL );
+            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+        }
+    }
+
     if( i_ret > 0 )
     {
         if( p_input->p->input.p_demux->info.i_update )
@@ -718,6 +740,21 @@ static void MainLoopInterface( input_thread_t *p_input )
  */
 static void MainLoopStatistic( input_thread_t *p_input )
 {
+    int64_t i_jitter, i_lost, i_buffer;
+
+    if( libvlc_stats( p_input ) &&
+        !demux_Control( p_input->p->input.p_demux, DEMUX_GET_NETWORK_STATS,
+                        &i_jitter, &i_lost, &i_buffer ) )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        stats_UpdateInteger( p_input, p_input->p->counters.p_network_jitter,
+                             i_jitter, NULL );
+        stats_UpdateInteger( p_input, p_input->p->counters.p_network_lost,
+                             i_lost, NULL );
+        stats_UpdateInteger( p_input, p_input->p->counters.p_network_buffer,
+                             i_buffer, NULL );
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
     stats_ComputeInputStats( p_input, p_input->p->p_item->p_stats );
     input_SendEventStatistics( p_input );
 }
@@ -876,6 +913,19 @@ static void InitStatistics( input_thread_t * p_input )
         INIT_COUNTER( lost_abuffers, INTEGER, COUNTER );
         INIT_COUNTER( displayed_pictures, INTEGER, COUNTER );
         INIT_COUNTER( lost_pictures, INTEGER, COUNTER );
+        INIT_COUNTER( copied_bytes, INTEGER, COUNTER );
+        INIT_COUNTER( demux_time, INTEGER, COUNTER );
+        INIT_COUNTER( decode_video_time, INTEGER, COUNTER );
+        INIT_COUNTER( decode_audio_time, INTEGER, COUNTER );
+        INIT_COUNTER( convert_time, INTEGER, COUNTER );
+        INIT_COUNTER( blend_time, INTEGER, COUNTER );
+        INIT_COUNTER( display_time, INTEGER, COUNTER );
+        INIT_COUNTER( audio_delay, INTEGER, LAST );
+        INIT_COUNTER( video_queue, INTEGER, LAST );
+        INIT_COUNTER( audio_queue, INTEGER, LAST );
+        INIT_COUNTER( network_jitter, INTEGER, LAST );
+        INIT_COUNTER( network_lost, INTEGER, LAST );
+        INIT_COUNTER( network_buffer, INTEGER, LAST );
         INIT_COUNTER( decoded_audio, INTEGER, COUNTER );
         INIT_COUNTER( decoded_video, INTEGER, COUNTER );
         INIT_COUNTER( decoded_sub, INTEGER, COUNTER );
@@ -1361,6 +1411,19 @@ error:
         EXIT_COUNTER( lost_abuffers );
         EXIT_COUNTER( displayed_pictures );
         EXIT_COUNTER( lost_pictures );
+        EXIT_COUNTER( copied_bytes );
+        EXIT_COUNTER( demux_time );
+        EXIT_COUNTER( decode_video_time );
+        EXIT_COUNTER( decode_audio_time );
+        EXIT_COUNTER( convert_time );
+        EXIT_COUNTER( blend_time );
+        EXIT_COUNTER( display_time );
+        EXIT_COUNTER( audio_delay );
+        EXIT_COUNTER( video_queue );
+        EXIT_COUNTER( audio_queue );
+        EXIT_COUNTER( network_jitter );
+        EXIT_COUNTER( network_lost );
+        EXIT_COUNTER( network_buffer );
         EXIT_COUNTER( decoded_audio );
         EXIT_COUNTER( decoded_video );
         EXIT_COUNTER( decoded_sub );
@@ -1434,6 +1497,19 @@ static void End( input_thread_t * p_input )
             CL_CO( lost_abuffers );
             CL_CO( displayed_pictures );
             CL_CO( lost_pictures );
+            CL_CO( copied_bytes );
+            CL_CO( demux_time );
+            CL_CO( decode_video_time );
+            CL_CO( decode_audio_time );
+            CL_CO( convert_time );
+            CL_CO( blend_time );
+            CL_CO( display_time );
+            CL_CO( audio_delay );
+            CL_CO( video_queue );
+            CL_CO( audio_queue );
+            CL_CO( network_jitter );
+            CL_CO( network_lost );
+            CL_CO( network_buffer );
             CL_CO( decoded_audio) ;
             CL_CO( decoded_video );
             CL_CO( decoded_sub) ;
@@ -154,6 +154,19 @@ struct input_thread_private_t
         counter_t *p_lost_abuffers;
         counter_t *p_displayed_pictures;
         counter_t *p_lost_pictures;
+        counter_t *p_copied_bytes;
+        counter_t *p_demux_time;
+        counter_t *p_decode_video_time;
+        counter_t *p_decode_audio_time;
+        counter_t *p_convert_time;
+        counter_t *p_blend_time;
+        counter_t *p_display_time;
+        counter_t *p_audio_delay;
+        counter_t *p_video_queue;
+        counter_t *p_network_jitter;
+        counter_t *p_network_lost;
+        counter_t *p_network_buffer;
+        counter_t *p_audio_queue;
         vlc_mutex_t counters_lock;
     } counters;
 
@@ -637,6 +637,9 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
         case STREAM_GET_CONTENT_TYPE:
             return access_Control( p_access, ACCESS_GET_CONTENT_TYPE,
                                     va_arg( args, char ** ) );
+        case STREAM_GET_PTS_DELAY:
+            return access_Control( p_access, ACCESS_GET_PTS_DELAY,
+                                    va_arg( args, int64_t * ) );
         case STREAM_SET_RECORD_STATE:
         default:
             msg_Err( s, "invalid stream_vaControl query=0x%x", i_query );
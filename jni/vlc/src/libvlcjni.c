@@ -9,6 +9,7 @@
 #include <vlc/libvlc_media_player.h>
 /* XXX: NG */
 #include "control/media_player_internal.h"
+#include "control/libvlc_internal.h"
 #include <vlc_common.h>
 #include <vlc_input.h>
 
@@ -32,21 +33,28 @@
 JavaVM *gJVM = NULL;
 
 /* JNI fields */
-static jclass clz_VlcEvent = 0;
-static jfieldID f_VlcEvent_eventType = 0;
-static jfieldID f_VlcEvent_booleanValue = 0;
-static jfieldID f_VlcEvent_intValue = 0;
-static jfieldID f_VlcEvent_longValue = 0;
-static jfieldID f_VlcEvent_floatValue = 0;
-static jfieldID f_VlcEvent_stringValue = 0;
 static jmethodID m_VlcMediaPlayer_onVlcEvent = 0;
 
 /* */
 
 static void *vlc_jni_player_gc_thread(void *);
+static void *vlc_jni_event_thread(void *);
 
 libvlc_instance_t *s_vlc_instance = 0;
 
+/*
+ * Playback state shared with the Java side through a direct ByteBuffer, the
+ * layout must match VlcMediaPlayer.STATE_*. Java only reads the 32 bits
+ * fields there, time and length are read under s_event_lock by the getters.
+ */
+typedef struct _vlc_jni_state
+{
+    int64_t time;
+    int64_t length;
+    float position;
+    float buffering;
+} vlc_jni_state_t;
+
 typedef struct _vlc_jni_player
 {
     int status;
@@ -60,8 +68,42 @@ typedef struct _vlc_jni_player
     int buffering;
     void *surface;
     vlc_mutex_t surface_lock;
+    /* protected by s_event_lock */
+    vlc_jni_state_t state;
+    bool progress_queued;
+    vlc_jni_state_t state_sent;
 } vlc_jni_player_t;
 
+/*
+ * Events are queued by the libvlc callbacks, which run on the input thread,
+ * and delivered to Java by the event thread. Time, position, length and
+ * buffering updates only update the state and queue at most one progress
+ * entry per player, delivered no more than every JNI_PROGRESS_INTERVAL.
+ */
+#define JNI_EVENT_QUEUE_SIZE 64
+#define JNI_EVENT_PROGRESS (-1)
+#define JNI_PROGRESS_INTERVAL (INT64_C(200000))
+
+typedef struct _vlc_jni_event
+{
+    vlc_jni_player_t *vj;
+    jobject reference;
+    int type;
+    bool booleanValue;
+    int intValue;
+    int64_t longValue;
+    float floatValue;
+    char *stringValue;
+} vlc_jni_event_t;
+
+static vlc_mutex_t s_event_lock;
+static vlc_cond_t s_event_cond;
+static vlc_jni_event_t s_event_queue[JNI_EVENT_QUEUE_SIZE];
+static int s_event_first = 0;
+static int s_event_count = 0;
+static bool s_event_urgent = false;
+static mtime_t s_progress_last = 0;
+
 static void *s_surface = 0;
 static vlc_mutex_t s_surface_lock;
 
@@ -158,12 +200,14 @@ static inline vlc_jni_player_t *vlc_jni_player_find_by_vout(vlc_object_t *p_vout
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved)
 {
     gJVM = vm;
-    const char *argv[] = {"-I", "dummy", "-vvv", "--no-plugins-cache", "--no-drop-late-frames", "--input-timeshift-path", "/data/local/tmp"};
+    const char *argv[] = {"-I", "dummy", "-vvv", "--no-plugins-cache", "--no-drop-late-frames", "--input-timeshift-memory", "33554432", "--avformat-probesize", "262144", "--avformat-analyzeduration", "2000"};
     s_vlc_instance = libvlc_new_with_builtins(sizeof(argv) / sizeof(*argv), argv, vlc_builtins_modules);
     vlc_mutex_init(&s_surface_lock);
     s_VlcMediaPlayer_array = vlc_array_new();
     vlc_mutex_init(&s_VlcMediaPlayer_lock);
     vlc_cond_init(&s_VlcMediaPlayer_cond);
+    vlc_mutex_init(&s_event_lock);
+    vlc_cond_init(&s_event_cond);
 
     return JNI_VERSION_1_4;
 }
@@ -174,6 +218,38 @@ JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved)
     /* TODO: release all left player instances */
     vlc_mutex_destroy(&s_VlcMediaPlayer_lock);
     vlc_cond_destroy(&s_VlcMediaPlayer_cond);
+    vlc_mutex_destroy(&s_event_lock);
+    vlc_cond_destroy(&s_event_cond);
+}
+
+/*
+ * The on-disk caches live in the application cache directory, which only
+ * Java knows (it depends on the Android user). They are off until it is set.
+ */
+JNIEXPORT void JNICALL NAME(nativeSetCacheDir)(JNIEnv *env, jclass clz, jstring dir)
+{
+    static const struct
+    {
+        const char *name;
+        const char *sub;
+    } caches[] = {
+        { "avformat-probe-cache", "avformat" },
+        { "http-cache-dir", "http" },
+    };
+    libvlc_int_t *p_libvlc = s_vlc_instance->p_libvlc_int;
+    const char *str = (*env)->GetStringUTFChars(env, dir, 0);
+    if (!str)
+        return;
+    for (size_t i = 0; i < sizeof(caches) / sizeof(*caches); i++)
+    {
+        char *path;
+        if (asprintf(&path, "%s/%s", str, caches[i].sub) < 0)
+            continue;
+        var_Create(p_libvlc, caches[i].name, VLC_VAR_STRING);
+        var_SetString(p_libvlc, caches[i].name, path);
+        free(path);
+    }
+    (*env)->ReleaseStringUTFChars(env, dir, str);
 }
 
 JNIEXPORT int Java_org_stagex_danmaku_helper_SystemUtility_setenv(JNIEnv *env, jclass klz, jstring key, jstring val, jboolean overwrite)
@@ -186,30 +262,42 @@ JNIEXPORT int Java_org_stagex_danmaku_helper_SystemUtility_setenv(JNIEnv *env, j
     return err;
 }
 
+/* must be called with s_event_lock held */
+static vlc_jni_event_t *vlc_jni_event_push(vlc_jni_player_t *vj, int type)
+{
+    if (s_event_count >= JNI_EVENT_QUEUE_SIZE)
+    {
+        __android_log_print(ANDROID_LOG_WARN, "faplayer", "event queue full, dropping event %d", type);
+        return NULL;
+    }
+    vlc_jni_event_t *e = &s_event_queue[(s_event_first + s_event_count) % JNI_EVENT_QUEUE_SIZE];
+    s_event_count += 1;
+    memset(e, 0, sizeof(*e));
+    e->vj = vj;
+    e->reference = vj->reference;
+    e->type = type;
+    if (type != JNI_EVENT_PROGRESS)
+        s_event_urgent = true;
+    vlc_cond_signal(&s_event_cond);
+    return e;
+}
+
+/* must be called with s_event_lock held, after the state was updated */
+static inline void vlc_jni_state_changed(vlc_jni_player_t *vj)
+{
+    if (!vj->progress_queued && vlc_jni_event_push(vj, JNI_EVENT_PROGRESS))
+        vj->progress_queued = true;
+}
+
+/* EXPLAIN: this runs on the input thread, it must not call into the JVM */
 static void vlc_event_callback(const libvlc_event_t *ev, void *data)
 {
-    JNIEnv *env;
-    jobject obj_VlcMediaPlayer;
-    jobject obj_VlcEvent;
-    int trigger = 1;
+    vlc_jni_player_t *vj = (vlc_jni_player_t *) data;
+    vlc_jni_event_t *e;
 
-    if ((*gJVM)->AttachCurrentThread(gJVM, &env, 0) < 0)
-        return;
-    obj_VlcEvent = (*env)->AllocObject(env, clz_VlcEvent);
-    if (!obj_VlcEvent)
-        return;
-    vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, (jobject) data);
-    char *mrl = libvlc_media_get_mrl(vj->media);
-    (*env)->SetIntField(env, obj_VlcEvent, f_VlcEvent_eventType, ev->type);
     switch (ev->type) {
-    case libvlc_MediaDurationChanged: {
-        int64_t duration = ev->u.media_duration_changed.new_duration;
-        (*env)->SetLongField(env, obj_VlcEvent, f_VlcEvent_longValue, (jlong) duration);
-        break;
-    }
     case libvlc_MediaStateChanged: {
         int state = ev->u.media_state_changed.new_state;
-        (*env)->SetIntField(env, obj_VlcEvent, f_VlcEvent_intValue, state);
         /* wake up if there is an error */
         if (state == libvlc_MediaPlayerEncounteredError) {
             vlc_mutex_lock(&vj->parse_lock);
@@ -217,80 +305,197 @@ static void vlc_event_callback(const libvlc_event_t *ev, void *data)
             vlc_cond_broadcast(&vj->parse_cond);
             vlc_mutex_unlock(&vj->parse_lock);
         }
+        vlc_mutex_lock(&s_event_lock);
+        if ((e = vlc_jni_event_push(vj, ev->type)))
+            e->intValue = state;
+        vlc_mutex_unlock(&s_event_lock);
         break;
     }
     case libvlc_MediaParsedChanged: {
-        libvlc_media_player_play(vj->player);
-        trigger = 0;
+        /* the playing input sets it too, nothing to do as we do not
+         * preparse anymore */
         break;
     }
     case libvlc_MediaPlayerBuffering: {
         float cache = ev->u.media_player_buffering.new_cache;
-        (*env)->SetFloatField(env, obj_VlcEvent, f_VlcEvent_floatValue, cache);
+        bool prepared = false;
         if ((int) cache == 100) {
             vj->buffering += 1;
-            /* if it's the first time */
+            /* if it's the first time, the input started paused */
             if (vj->buffering == 1) {
-                /* send buffering update event now */
-                (*env)->CallVoidMethod(env, vj->reference, m_VlcMediaPlayer_onVlcEvent, obj_VlcEvent);
-                libvlc_media_player_set_pause(vj->player, 1);
                 /* asynchonous preparing is done */
                 vlc_mutex_lock(&vj->parse_lock);
                 vj->parse_status = 1;
                 vlc_cond_broadcast(&vj->parse_cond);
                 vlc_mutex_unlock(&vj->parse_lock);
-                /* simulate a media prepared event */
-                (*env)->SetIntField(env, obj_VlcEvent, f_VlcEvent_eventType, libvlc_MediaParsedChanged);
-                (*env)->SetBooleanField(env, obj_VlcEvent, f_VlcEvent_booleanValue, 1);
+                prepared = true;
             }
         }
+        vlc_mutex_lock(&s_event_lock);
+        if (prepared) {
+            /* send buffering update event now, then simulate a media prepared event */
+            if ((e = vlc_jni_event_push(vj, libvlc_MediaPlayerBuffering)))
+                e->floatValue = cache;
+            if ((e = vlc_jni_event_push(vj, libvlc_MediaParsedChanged)))
+                e->booleanValue = true;
+            vj->state.buffering = vj->state_sent.buffering = cache;
+            vlc_jni_state_changed(vj);
+        }
+        else {
+            vj->state.buffering = cache;
+            vlc_jni_state_changed(vj);
+        }
+        vlc_mutex_unlock(&s_event_lock);
         break;
     }
     case libvlc_MediaPlayerTimeChanged: {
-        int64_t time = ev->u.media_player_time_changed.new_time;
-        (*env)->SetLongField(env, obj_VlcEvent, f_VlcEvent_longValue, (jlong) time);
+        vlc_mutex_lock(&s_event_lock);
+        vj->state.time = ev->u.media_player_time_changed.new_time;
+        vlc_jni_state_changed(vj);
+        vlc_mutex_unlock(&s_event_lock);
         break;
     }
     case libvlc_MediaPlayerPositionChanged: {
-        float position = ev->u.media_player_position_changed.new_position;
-        (*env)->SetFloatField(env, obj_VlcEvent, f_VlcEvent_floatValue, position);
+        vlc_mutex_lock(&s_event_lock);
+        vj->state.position = ev->u.media_player_position_changed.new_position;
+        vlc_jni_state_changed(vj);
+        vlc_mutex_unlock(&s_event_lock);
         break;
     }
-    case libvlc_MediaPlayerSeekableChanged: {
-        int seekable = ev->u.media_player_seekable_changed.new_seekable;
-        (*env)->SetBooleanField(env, obj_VlcEvent, f_VlcEvent_booleanValue, seekable > 0);
+    case libvlc_MediaPlayerLengthChanged: {
+        vlc_mutex_lock(&s_event_lock);
+        vj->state.length = ev->u.media_player_length_changed.new_length;
+        vlc_jni_state_changed(vj);
+        vlc_mutex_unlock(&s_event_lock);
         break;
     }
-    case libvlc_MediaPlayerPausableChanged: {
-        int pausable = ev->u.media_player_pausable_changed.new_pausable;
-        (*env)->SetBooleanField(env, obj_VlcEvent, f_VlcEvent_booleanValue, pausable > 0);
+    default: {
+        vlc_mutex_lock(&s_event_lock);
+        e = vlc_jni_event_push(vj, ev->type);
+        if (e) {
+            switch (ev->type) {
+            case libvlc_MediaDurationChanged:
+                e->longValue = ev->u.media_duration_changed.new_duration;
+                break;
+            case libvlc_MediaPlayerSeekableChanged:
+                e->booleanValue = ev->u.media_player_seekable_changed.new_seekable > 0;
+                break;
+            case libvlc_MediaPlayerPausableChanged:
+                e->booleanValue = ev->u.media_player_pausable_changed.new_pausable > 0;
+                break;
+            case libvlc_MediaPlayerTitleChanged:
+                e->intValue = ev->u.media_player_title_changed.new_title;
+                break;
+            case libvlc_MediaPlayerSnapshotTaken:
+                e->stringValue = strdup(ev->u.media_player_snapshot_taken.psz_filename);
+                break;
+            default:
+                break;
+            }
+        }
+        vlc_mutex_unlock(&s_event_lock);
         break;
     }
-    case libvlc_MediaPlayerTitleChanged: {
-        int title = ev->u.media_player_title_changed.new_title;
-        (*env)->SetIntField(env, obj_VlcEvent, f_VlcEvent_intValue, title);
-        break;
     }
-    case libvlc_MediaPlayerSnapshotTaken: {
-        char *p = ev->u.media_player_snapshot_taken.psz_filename;
-        jstring path = (*env)->NewStringUTF(env, p);
-        (*env)->SetObjectField(env, obj_VlcEvent, f_VlcEvent_stringValue, path);
-        break;
+}
+
+/* drop the queued events of a player about to be destroyed */
+static void vlc_jni_event_purge(vlc_jni_player_t *vj)
+{
+    vlc_mutex_lock(&s_event_lock);
+    for (int i = 0; i < s_event_count; i++)
+    {
+        vlc_jni_event_t *e = &s_event_queue[(s_event_first + i) % JNI_EVENT_QUEUE_SIZE];
+        if (e->vj != vj)
+            continue;
+        free(e->stringValue);
+        e->stringValue = NULL;
+        e->vj = NULL;
     }
-    case libvlc_MediaPlayerLengthChanged: {
-        int64_t length = ev->u.media_player_length_changed.new_length;
-        (*env)->SetLongField(env, obj_VlcEvent, f_VlcEvent_longValue, (jlong) length);
-        break;
+    vlc_mutex_unlock(&s_event_lock);
+}
+
+static void vlc_jni_event_deliver(JNIEnv *env, const vlc_jni_event_t *e)
+{
+    jstring str = e->stringValue ? (*env)->NewStringUTF(env, e->stringValue) : NULL;
+    (*env)->CallVoidMethod(env, e->reference, m_VlcMediaPlayer_onVlcEvent, e->type, e->booleanValue, e->intValue, (jlong) e->longValue, e->floatValue, str);
+    if ((*env)->ExceptionCheck(env))
+    {
+        (*env)->ExceptionDescribe(env);
+        (*env)->ExceptionClear(env);
     }
-    default:
-        break;
+    if (str)
+        (*env)->DeleteLocalRef(env, str);
+}
+
+/* the only thread calling into the JVM for player events */
+static void *vlc_jni_event_thread(void *para)
+{
+    /* one progress entry gives up to 3 events */
+    static vlc_jni_event_t batch[3 * JNI_EVENT_QUEUE_SIZE];
+    JNIEnv *env;
+
+    if ((*gJVM)->AttachCurrentThread(gJVM, &env, 0) < 0)
+        return NULL;
+    while (true)
+    {
+        int count = 0;
+        vlc_mutex_lock(&s_event_lock);
+        while (s_event_count == 0)
+            vlc_cond_wait(&s_event_cond, &s_event_lock);
+        /* give the progress updates some time to coalesce */
+        mtime_t deadline = s_progress_last + JNI_PROGRESS_INTERVAL;
+        while (!s_event_urgent && mdate() < deadline)
+        {
+            if (vlc_cond_timedwait(&s_event_cond, &s_event_lock, deadline))
+                break;
+        }
+        for (; s_event_count > 0; s_event_count--)
+        {
+            vlc_jni_event_t *e = &s_event_queue[s_event_first];
+            vlc_jni_player_t *vj = e->vj;
+            s_event_first = (s_event_first + 1) % JNI_EVENT_QUEUE_SIZE;
+            if (!vj)
+                continue;
+            if (e->type != JNI_EVENT_PROGRESS)
+            {
+                batch[count++] = *e;
+                continue;
+            }
+            /* only send what changed since the last time */
+            vj->progress_queued = false;
+            s_progress_last = mdate();
+            if (vj->state.buffering != vj->state_sent.buffering)
+            {
+                batch[count] = *e;
+                batch[count].type = libvlc_MediaPlayerBuffering;
+                batch[count++].floatValue = vj->state.buffering;
+            }
+            if (vj->state.length != vj->state_sent.length)
+            {
+                batch[count] = *e;
+                batch[count].type = libvlc_MediaPlayerLengthChanged;
+                batch[count++].longValue = vj->state.length;
+            }
+            if (vj->state.time != vj->state_sent.time)
+            {
+                batch[count] = *e;
+                batch[count].type = libvlc_MediaPlayerTimeChanged;
+                batch[count++].longValue = vj->state.time;
+            }
+            vj->state_sent = vj->state;
+        }
+        s_event_urgent = false;
+        vlc_mutex_unlock(&s_event_lock);
+        /* the global references are never released, it is safe to use them
+         * even if the player is being destroyed */
+        for (int i = 0; i < count; i++)
+        {
+            vlc_jni_event_deliver(env, &batch[i]);
+            free(batch[i].stringValue);
+        }
     }
-    if (trigger)
-        (*env)->CallVoidMethod(env, vj->reference, m_VlcMediaPlayer_onVlcEvent, obj_VlcEvent);
-    (*env)->DeleteLocalRef(env, obj_VlcEvent);
-    free(mrl);
-    /* EXPLAIN: this is called in pthread wrapper routines */
-    // (*gJVM)->DetachCurrentThread(gJVM);
+    return NULL;
 }
 
 JNIEXPORT void JNICALL NAME(nativeAttachSurface)(JNIEnv *env, jobject thiz, jobject s)
@@ -353,29 +558,21 @@ JNIEXPORT void JNICALL NAME(nativeCreate)(JNIEnv *env, jobject thiz)
     if (!m_VlcMediaPlayer_onVlcEvent)
     {
         clz = (*env)->GetObjectClass(env, thiz);
-        m_VlcMediaPlayer_onVlcEvent = (*env)->GetMethodID(env, clz, "onVlcEvent", "(L" PREFIX "VlcMediaPlayer$VlcEvent;)V");
-        (*env)->DeleteLocalRef(env, clz);
-    }
-    if (!clz_VlcEvent)
-    {
-        clz = (*env)->FindClass(env, PREFIX "VlcMediaPlayer$VlcEvent");
-        clz_VlcEvent = (*env)->NewGlobalRef(env, clz);
-        f_VlcEvent_eventType = (*env)->GetFieldID(env, clz, "eventType", "I");
-        f_VlcEvent_booleanValue = (*env)->GetFieldID(env, clz, "booleanValue", "Z");
-        f_VlcEvent_intValue = (*env)->GetFieldID(env, clz, "intValue", "I");
-        f_VlcEvent_longValue = (*env)->GetFieldID(env, clz, "longValue", "J");
-        f_VlcEvent_floatValue = (*env)->GetFieldID(env, clz, "floatValue", "F");
-        f_VlcEvent_stringValue = (*env)->GetFieldID(env, clz, "stringValue", "Ljava/lang/String;");
+        m_VlcMediaPlayer_onVlcEvent = (*env)->GetMethodID(env, clz, "onVlcEvent", "(IZIJFLjava/lang/String;)V");
         (*env)->DeleteLocalRef(env, clz);
     }
     /* */
     if (!s_gc_thread)
     {
-        vlc_thread_t gc;
+        vlc_thread_t gc, ev;
         if (vlc_clone(&gc, vlc_jni_player_gc_thread, NULL, VLC_THREAD_PRIORITY_LOW))
         {
             /* XXX: wtf? */
         }
+        if (vlc_clone(&ev, vlc_jni_event_thread, NULL, VLC_THREAD_PRIORITY_LOW))
+        {
+            __android_log_print(ANDROID_LOG_ERROR, "faplayer", "could not start the event thread");
+        }
         s_gc_thread = -1;
     }
     /* */
@@ -385,12 +582,16 @@ JNIEXPORT void JNICALL NAME(nativeCreate)(JNIEnv *env, jobject thiz)
     vlc_mutex_init(&vj->parse_lock);
     vlc_cond_init(&vj->parse_cond);
     vlc_mutex_init(&vj->surface_lock);
+    vj->state.time = vj->state.length = -1;
+    vj->state_sent = vj->state;
     vj->status = 1;
     vj->player = libvlc_media_player_new(s_vlc_instance);
+    /* Inherited by each input of the player, see vlc_jni_player_prepare() */
+    var_Create(vj->player, "start-paused", VLC_VAR_BOOL);
     libvlc_event_manager_t *em = libvlc_media_player_event_manager(vj->player);
     for (int i = 0; i < sizeof(mp_listening) / sizeof(*mp_listening); i++)
     {
-        libvlc_event_attach(em, mp_listening[i], vlc_event_callback, thiz);
+        libvlc_event_attach(em, mp_listening[i], vlc_event_callback, vj);
     }
     vlc_jni_player_push(vj);
 }
@@ -400,10 +601,62 @@ JNIEXPORT void JNICALL NAME(nativeRelease)(JNIEnv *env, jobject thiz)
     vlc_jni_player_kill(thiz);
 }
 
+JNIEXPORT jobject JNICALL NAME(nativeGetState)(JNIEnv *env, jobject thiz)
+{
+    vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
+    if (!vj)
+        return NULL;
+    return (*env)->NewDirectByteBuffer(env, &vj->state, sizeof(vj->state));
+}
+
+/*
+ * Pipeline statistics, in the order of VlcMediaPlayer.STATS_*. They are
+ * updated by the input thread about once per second.
+ */
+JNIEXPORT jboolean JNICALL NAME(nativeGetStats)(JNIEnv *env, jobject thiz, jlongArray array)
+{
+    vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
+    libvlc_media_stats_t stats;
+    if (!vj || !vj->media || !libvlc_media_get_stats(vj->media, &stats))
+        return 0;
+    const jlong values[] = {
+        stats.i_demux_time,
+        stats.i_decode_video_time,
+        stats.i_decode_audio_time,
+        stats.i_convert_time,
+        stats.i_blend_time,
+        stats.i_display_time,
+        stats.i_audio_delay,
+        stats.i_decoded_video,
+        stats.i_displayed_pictures,
+        stats.i_lost_pictures,
+        stats.i_decoded_audio,
+        stats.i_played_abuffers,
+        stats.i_lost_abuffers,
+        stats.i_demux_corrupted,
+        stats.i_copied_bytes,
+        stats.i_video_queue,
+        stats.i_audio_queue,
+        stats.i_read_bytes,
+        stats.i_network_jitter,
+        stats.i_network_lost,
+        stats.i_network_buffer,
+    };
+    jsize count = (*env)->GetArrayLength(env, array);
+    if (count > (jsize) (sizeof(values) / sizeof(*values)))
+        count = sizeof(values) / sizeof(*values);
+    (*env)->SetLongArrayRegion(env, array, 0, count, values);
+    return 1;
+}
+
 JNIEXPORT jint JNICALL NAME(nativeGetCurrentPosition)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    int64_t position = libvlc_media_player_get_time(vj->player);
+    if (!vj)
+        return -1;
+    vlc_mutex_lock(&s_event_lock);
+    int64_t position = vj->state.time;
+    vlc_mutex_unlock(&s_event_lock);
     if (position < 0)
     {
         return -1;
@@ -414,7 +667,11 @@ JNIEXPORT jint JNICALL NAME(nativeGetCurrentPosition)(JNIEnv *env, jobject thiz)
 JNIEXPORT jint JNICALL NAME(nativeGetDuration)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    int64_t duration = libvlc_media_player_get_length(vj->player);
+    if (!vj)
+        return -1;
+    vlc_mutex_lock(&s_event_lock);
+    int64_t duration = vj->state.length;
+    vlc_mutex_unlock(&s_event_lock);
     if (duration < 0)
     {
         return -1;
@@ -425,7 +682,7 @@ JNIEXPORT jint JNICALL NAME(nativeGetDuration)(JNIEnv *env, jobject thiz)
 JNIEXPORT jint JNICALL NAME(nativeGetVideoHeight)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    if (!vj->media || !libvlc_media_is_parsed(vj->media))
+    if (!vj->media)
         return 0;
     /* FIXME: it returns the first video's information only */
     int i, n;
@@ -449,7 +706,7 @@ JNIEXPORT jint JNICALL NAME(nativeGetVideoHeight)(JNIEnv *env, jobject thiz)
 JNIEXPORT jint JNICALL NAME(nativeGetVideoWidth)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    if (!vj->media || !libvlc_media_is_parsed(vj->media))
+    if (!vj->media)
         return 0;
     /* FIXME: it returns the first video's information only */
     int i, n;
@@ -487,31 +744,33 @@ JNIEXPORT void JNICALL NAME(nativePause)(JNIEnv *env, jobject thiz)
     libvlc_media_player_set_pause(vj->player, 1);
 }
 
+/*
+ * The input is opened paused: it probes the demuxer, creates the decoders
+ * and buffers until the first frames are decoded, then waits for start()
+ * without having started the clock. The first buffering at 100% means it
+ * is prepared. It is a player variable rather than a media option, so that
+ * only the inputs started by a prepare request are paused.
+ */
+static void vlc_jni_player_prepare(vlc_jni_player_t *vj)
+{
+    var_SetBool(vj->player, "start-paused", true);
+    libvlc_media_player_play(vj->player);
+}
+
 JNIEXPORT void JNICALL NAME(nativePrepare)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    char *mrl = libvlc_media_get_mrl(vj->media);
-    if (strncmp(mrl, "file://", 7) == 0)
-        libvlc_media_parse(vj->media);
-    else {
-        libvlc_media_player_play(vj->player);
-        vlc_mutex_lock(&vj->parse_lock);
-        while (!vj->parse_status)
-            vlc_cond_wait(&vj->parse_cond, &vj->parse_lock);
-        vlc_mutex_unlock(&vj->parse_lock);
-    }
-    free(mrl);
+    vlc_jni_player_prepare(vj);
+    vlc_mutex_lock(&vj->parse_lock);
+    while (!vj->parse_status)
+        vlc_cond_wait(&vj->parse_cond, &vj->parse_lock);
+    vlc_mutex_unlock(&vj->parse_lock);
 }
 
 JNIEXPORT void JNICALL NAME(nativePrepareAsync)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
-    char *mrl = libvlc_media_get_mrl(vj->media);
-    if (strncmp(mrl, "file://", 7) == 0)
-        libvlc_media_parse_async(vj->media);
-    else
-        libvlc_media_player_play(vj->player);
-    free(mrl);
+    vlc_jni_player_prepare(vj);
 }
 
 JNIEXPORT void JNICALL NAME(nativeSeekTo)(JNIEnv *env, jobject thiz, jint msec)
@@ -535,7 +794,7 @@ JNIEXPORT void JNICALL NAME(nativeSetDataSource)(JNIEnv *env, jobject thiz, jstr
         libvlc_event_manager_t *em = libvlc_media_event_manager(media);
         for (int i = 0; i < sizeof(md_listening) / sizeof(*md_listening); i++)
         {
-            libvlc_event_attach(em, md_listening[i], vlc_event_callback, thiz);
+            libvlc_event_attach(em, md_listening[i], vlc_event_callback, vj);
         }
         /* this will cancel current input and start a new one */
         libvlc_media_player_set_media(vj->player, media);
@@ -559,6 +818,8 @@ JNIEXPORT void JNICALL NAME(nativeSetLooping)(JNIEnv *env, jobject thiz, jboolea
 JNIEXPORT void JNICALL NAME(nativeStart)(JNIEnv *env, jobject thiz)
 {
     vlc_jni_player_t *vj = vlc_jni_player_find_or_throw(env, thiz);
+    /* A prepared input is unpaused, a new one starts playing */
+    var_SetBool(vj->player, "start-paused", false);
     libvlc_media_player_play(vj->player);
 }
 
@@ -606,14 +867,15 @@ static void *vlc_jni_player_gc_thread(void *para)
             em = libvlc_media_event_manager(md);
             for (int i = 0; i < sizeof(md_listening) / sizeof(*md_listening); i++)
             {
-                libvlc_event_detach(em, md_listening[i], vlc_event_callback, vj->object);
+                libvlc_event_detach(em, md_listening[i], vlc_event_callback, vj);
             }
         }
         em = libvlc_media_player_event_manager(vj->player);
         for (int i = 0; i < sizeof(mp_listening) / sizeof(*mp_listening); i++)
         {
-            libvlc_event_detach(em, mp_listening[i], vlc_event_callback, vj->object);
+            libvlc_event_detach(em, mp_listening[i], vlc_event_callback, vj);
         }
+        vlc_jni_event_purge(vj);
         libvlc_media_player_stop(vj->player);
         libvlc_media_player_release(vj->player);
         /* XXX: free global reference */
@@ -1,5 +1,6 @@
 /* auto generated */
 vlc_declare_plugin(access_avio);
+vlc_declare_plugin(access_concat);
 vlc_declare_plugin(access_demux_avformat);
 vlc_declare_plugin(access_http);
 vlc_declare_plugin(access_mms);
@@ -11,16 +12,19 @@ vlc_declare_plugin(avformat);
 vlc_declare_plugin(bandlimited_resampler);
 vlc_declare_plugin(blend);
 vlc_declare_plugin(converter_fixed);
+vlc_declare_plugin(danmaku);
 vlc_declare_plugin(dummy);
 vlc_declare_plugin(filesystem);
 vlc_declare_plugin(fixed32_mixer);
 vlc_declare_plugin(float32_mixer);
+vlc_declare_plugin(flv);
 vlc_declare_plugin(freetype);
 vlc_declare_plugin(libasf);
 vlc_declare_plugin(libass);
 vlc_declare_plugin(libavi);
 vlc_declare_plugin(libmp4);
 vlc_declare_plugin(live555);
+vlc_declare_plugin(memcpy_neon);
 vlc_declare_plugin(mkv);
 vlc_declare_plugin(mpeg_audio);
 vlc_declare_plugin(mpgv);
@@ -48,6 +52,7 @@ vlc_declare_plugin(vmem);
 vlc_declare_plugin(yuv2rgb);
 const void *vlc_builtins_modules[] = {
 	vlc_plugin(access_avio),
+	vlc_plugin(access_concat),
 	vlc_plugin(access_demux_avformat),
 	vlc_plugin(access_http),
 	vlc_plugin(access_mms),
@@ -59,16 +64,19 @@ const void *vlc_builtins_modules[] = {
 	vlc_plugin(bandlimited_resampler),
 	vlc_plugin(blend),
 	vlc_plugin(converter_fixed),
+	vlc_plugin(danmaku),
 	vlc_plugin(dummy),
 	vlc_plugin(filesystem),
 	vlc_plugin(fixed32_mixer),
 	vlc_plugin(float32_mixer),
+	vlc_plugin(flv),
 	vlc_plugin(freetype),
 	vlc_plugin(libasf),
 	vlc_plugin(libass),
 	vlc_plugin(libavi),
 	vlc_plugin(libmp4),
 	vlc_plugin(live555),
+	vlc_plugin(memcpy_neon),
 	vlc_plugin(mkv),
 	vlc_plugin(mpeg_audio),
 	vlc_plugin(mpgv),
@@ -352,6 +352,36 @@ void *vlc_memcpy (void *tgt, const void *src, size_t n)
     return pf_vlc_memcpy (tgt, src, n);
 }
 
+static void PlaneCopy (uint8_t *dst, size_t dst_pitch,
+                       const uint8_t *src, size_t src_pitch,
+                       size_t width, size_t lines)
+{
+    for (; lines > 0; lines--)
+    {
+        pf_vlc_memcpy (dst, src, width);
+        dst += dst_pitch;
+        src += src_pitch;
+    }
+}
+
+static vlc_plane_copy_t pf_vlc_plane_copy = PlaneCopy;
+
+void vlc_fastplane_register (vlc_plane_copy_t cpy)
+{
+    assert (cpy != NULL);
+    pf_vlc_plane_copy = cpy;
+}
+
+/**
+ * vlc_plane_copy: fast CPU-dependent copy of pitched lines
+ */
+void vlc_plane_copy (uint8_t *dst, size_t dst_pitch,
+                     const uint8_t *src, size_t src_pitch,
+                     size_t width, size_t lines)
+{
+    pf_vlc_plane_copy (dst, dst_pitch, src, src_pitch, width, lines);
+}
+
 /**
  * Returned an aligned pointer on newly allocated memory.
  * \param alignment must be a power of 2 and a multiple of sizeof(void*)
@@ -1201,6 +1201,9 @@ static const entry_t p_list_spu[] = {
     B(VLC_CODEC_SSA, "SubStation Alpha subtitles"),
         A("ssa "),
 
+    B(VLC_CODEC_DANMAKU, "Danmaku scrolling comments"),
+        A("dmku"),
+
     B(VLC_CODEC_TEXT, "Plain text subtitles"),
         A("TEXT"),
 
@@ -177,12 +177,28 @@ void stats_ComputeInputStats( input_thread_t *p_input, input_stats_t *p_stats )
                       &p_stats->i_demux_corrupted );
     stats_GetInteger( p_input, p_input->p->counters.p_demux_discontinuity,
                       &p_stats->i_demux_discontinuity );
+    stats_GetInteger( p_input, p_input->p->counters.p_demux_time,
+                      &p_stats->i_demux_time );
 
     /* Decoders */
     stats_GetInteger( p_input, p_input->p->counters.p_decoded_video,
                       &p_stats->i_decoded_video );
     stats_GetInteger( p_input, p_input->p->counters.p_decoded_audio,
                       &p_stats->i_decoded_audio );
+    stats_GetInteger( p_input, p_input->p->counters.p_decode_video_time,
+                      &p_stats->i_decode_video_time );
+    stats_GetInteger( p_input, p_input->p->counters.p_decode_audio_time,
+                      &p_stats->i_decode_audio_time );
+    stats_GetInteger( p_input, p_input->p->counters.p_video_queue,
+                      &p_stats->i_video_queue );
+    stats_GetInteger( p_input, p_input->p->counters.p_audio_queue,
+                      &p_stats->i_audio_queue );
+    stats_GetInteger( p_input, p_input->p->counters.p_network_jitter,
+                      &p_stats->i_network_jitter );
+    stats_GetInteger( p_input, p_input->p->counters.p_network_lost,
+                      &p_stats->i_network_lost );
+    stats_GetInteger( p_input, p_input->p->counters.p_network_buffer,
+                      &p_stats->i_network_buffer );
 
     /* Sout */
     if( p_input->p->counters.p_sout_send_bitrate )
@@ -200,12 +216,22 @@ void stats_ComputeInputStats( input_thread_t *p_input, input_stats_t *p_stats )
                       &p_stats->i_played_abuffers );
     stats_GetInteger( p_input, p_input->p->counters.p_lost_abuffers,
                       &p_stats->i_lost_abuffers );
+    stats_GetInteger( p_input, p_input->p->counters.p_audio_delay,
+                      &p_stats->i_audio_delay );
 
     /* Vouts */
     stats_GetInteger( p_input, p_input->p->counters.p_displayed_pictures,
                       &p_stats->i_displayed_pictures );
     stats_GetInteger( p_input, p_input->p->counters.p_lost_pictures,
                       &p_stats->i_lost_pictures );
+    stats_GetInteger( p_input, p_input->p->counters.p_copied_bytes,
+                      &p_stats->i_copied_bytes );
+    stats_GetInteger( p_input, p_input->p->counters.p_convert_time,
+                      &p_stats->i_convert_time );
+    stats_GetInteger( p_input, p_input->p->counters.p_blend_time,
+                      &p_stats->i_blend_time );
+    stats_GetInteger( p_input, p_input->p->counters.p_display_time,
+                      &p_stats->i_display_time );
 
     vlc_mutex_unlock( &p_stats->lock );
     vlc_mutex_unlock( &p_input->p->counters.counters_lock );
@@ -220,6 +246,14 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
+    p_stats->i_copied_bytes =
+    p_stats->i_demux_time =
+    p_stats->i_decode_video_time = p_stats->i_decode_audio_time =
+    p_stats->i_convert_time = p_stats->i_blend_time =
+    p_stats->i_display_time = p_stats->i_audio_delay =
+    p_stats->i_video_queue = p_stats->i_audio_queue =
+    p_stats->i_network_jitter = p_stats->i_network_lost =
+    p_stats->i_network_buffer =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
     p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
@@ -234,12 +268,14 @@ void stats_DumpInputStats( input_stats_t *p_stats  )
      * *1000 => bytes / millisecond => kbytes / seconds */
     fprintf( stderr, "Input : %"PRId64" (%"PRId64" bytes) - %f kB/s - "
                      "Demux : %"PRId64" (%"PRId64" bytes) - %f kB/s\n"
-                     " - Vout : %"PRId64"/%"PRId64" - Aout : %"PRId64"/%"PRId64" - Sout : %f\n",
+                     " - Vout : %"PRId64"/%"PRId64" (%"PRId64" bytes/frame) - Aout : %"PRId64"/%"PRId64" - Sout : %f\n",
                     p_stats->i_read_packets, p_stats->i_read_bytes,
                     p_stats->f_input_bitrate * 1000,
                     p_stats->i_demux_read_packets, p_stats->i_demux_read_bytes,
                     p_stats->f_demux_bitrate * 1000,
                     p_stats->i_displayed_pictures, p_stats->i_lost_pictures,
+                    p_stats->i_displayed_pictures > 0 ?
+                        p_stats->i_copied_bytes / p_stats->i_displayed_pictures : 0,
                     p_stats->i_played_abuffers, p_stats->i_lost_abuffers,
                     p_stats->f_send_bitrate );
     vlc_mutex_unlock( &p_stats->lock );
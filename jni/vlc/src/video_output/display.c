@@ -347,6 +347,7 @@ struct vout_display_owner_sys_t {
     } mouse;
 
     bool reset_pictures;
+    bool is_exposed;
 
     bool ch_fullscreen;
     bool is_fullscreen;
@@ -667,6 +668,12 @@ static void VoutDisplayEvent(vout_display_t *vd, int event, va_list args)
         vlc_mutex_unlock(&osys->lock);
         break;
     }
+
+    case VOUT_DISPLAY_EVENT_EXPOSED:
+        vlc_mutex_lock(&osys->lock);
+        osys->is_exposed = true;
+        vlc_mutex_unlock(&osys->lock);
+        break;
     default:
         msg_Err(vd, "VoutDisplayEvent received event %d", event);
         /* TODO add an assert when all event are handled */
@@ -757,7 +764,7 @@ static void VoutDisplayCropRatio(int *left, int *top, int *right, int *bottom,
     }
 }
 
-void vout_ManageDisplay(vout_display_t *vd, bool allow_reset_pictures)
+bool vout_ManageDisplay(vout_display_t *vd, bool allow_reset_pictures)
 {
     vout_display_owner_sys_t *osys = vd->owner.sys;
 
@@ -786,6 +793,11 @@ void vout_ManageDisplay(vout_display_t *vd, bool allow_reset_pictures)
         vout_SendEventMouseHidden(osys->vout);
     }
 
+    vlc_mutex_lock(&osys->lock);
+    bool is_changed = osys->is_exposed;
+    osys->is_exposed = false;
+    vlc_mutex_unlock(&osys->lock);
+
     bool reset_render = false;
     for (;;) {
 
@@ -832,6 +844,7 @@ void vout_ManageDisplay(vout_display_t *vd, bool allow_reset_pictures)
             }
             break;
         }
+        is_changed = true;
 
         /* */
         if (ch_fullscreen) {
@@ -1059,6 +1072,7 @@ void vout_ManageDisplay(vout_display_t *vd, bool allow_reset_pictures)
     }
     if (reset_render)
         VoutDisplayResetRender(vd);
+    return is_changed;
 }
 
 bool vout_AreDisplayPicturesInvalid(vout_display_t *vd)
@@ -1418,6 +1432,7 @@ static void SplitterEvent(vout_display_t *vd, int event, va_list args)
     case VOUT_DISPLAY_EVENT_FULLSCREEN:
     case VOUT_DISPLAY_EVENT_DISPLAY_SIZE:
     case VOUT_DISPLAY_EVENT_PICTURES_INVALID:
+    case VOUT_DISPLAY_EVENT_EXPOSED:
         VoutDisplayEvent(vd, event, args);
         break;
 
@@ -1479,8 +1494,10 @@ static void SplitterManage(vout_display_t *vd)
 {
     vout_display_sys_t *sys = vd->sys;
 
-    for (int i = 0; i < sys->count; i++)
-        vout_ManageDisplay(sys->display[i], true);
+    for (int i = 0; i < sys->count; i++) {
+        if (vout_ManageDisplay(sys->display[i], true))
+            vout_display_SendEventExposed(vd);
+    }
 }
 
 static int SplitterPictureNew(video_splitter_t *splitter, picture_t *picture[])
@@ -29,6 +29,7 @@ typedef struct {
 
     int displayed;
     int lost;
+    vout_render_statistic_t render;
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
@@ -39,14 +40,17 @@ static inline void vout_statistic_Clean(vout_statistic_t *stat)
 {
     vlc_spin_destroy(&stat->spin);
 }
-static inline void vout_statistic_GetReset(vout_statistic_t *stat, int *displayed, int *lost)
+static inline void vout_statistic_GetReset(vout_statistic_t *stat, int *displayed, int *lost,
+                                           vout_render_statistic_t *render)
 {
     vlc_spin_lock(&stat->spin);
     *displayed = stat->displayed;
     *lost      = stat->lost;
+    *render    = stat->render;
 
     stat->displayed = 0;
     stat->lost      = 0;
+    memset(&stat->render, 0, sizeof(stat->render));
     vlc_spin_unlock(&stat->spin);
 }
 static inline void vout_statistic_Update(vout_statistic_t *stat, int displayed, int lost)
@@ -56,5 +60,21 @@ static inline void vout_statistic_Update(vout_statistic_t *stat, int displayed,
     stat->lost      += lost;
     vlc_spin_unlock(&stat->spin);
 }
+static inline void vout_statistic_AddCopied(vout_statistic_t *stat, int64_t copied)
+{
+    vlc_spin_lock(&stat->spin);
+    stat->render.i_copied += copied;
+    vlc_spin_unlock(&stat->spin);
+}
+static inline void vout_statistic_AddRenderTime(vout_statistic_t *stat,
+                                                mtime_t convert, mtime_t blend,
+                                                mtime_t display)
+{
+    vlc_spin_lock(&stat->spin);
+    stat->render.i_convert += convert;
+    stat->render.i_blend   += blend;
+    stat->render.i_display += display;
+    vlc_spin_unlock(&stat->spin);
+}
 
 #endif
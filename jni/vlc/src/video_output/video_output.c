@@ -58,8 +58,8 @@
 static void *Thread(void *);
 static void VoutDestructor(vlc_object_t *);
 
-/* Maximum delay between 2 displayed pictures.
- * XXX it is needed for now but should be removed in the long term.
+/* Maximum delay between 2 checks for a redisplay of the last picture.
+ * The picture is displayed again only if something changed.
  */
 #define VOUT_REDISPLAY_DELAY (INT64_C(80000))
 
@@ -286,9 +286,10 @@ void vout_ChangePause(vout_thread_t *vout, bool is_paused, mtime_t date)
     vout_control_WaitEmpty(&vout->p->control);
 }
 
-void vout_GetResetStatistic(vout_thread_t *vout, int *displayed, int *lost)
+void vout_GetResetStatistic(vout_thread_t *vout, int *displayed, int *lost,
+                            vout_render_statistic_t *render)
 {
-    vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
+    vout_statistic_GetReset( &vout->p->statistic, displayed, lost, render );
 }
 
 void vout_Flush(vout_thread_t *vout, mtime_t date)
@@ -874,6 +875,46 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool is_
     return VLC_SUCCESS;
 }
 
+/* picture_Copy() accounting the bytes moved in the statistics */
+static void ThreadCopyPicture(vout_thread_t *vout, picture_t *dst, picture_t *src)
+{
+    int64_t copied = 0;
+
+    picture_Copy(dst, src);
+    for (int i = 0; i < __MIN(dst->i_planes, src->i_planes); i++)
+        copied += __MIN(dst->p[i].i_visible_pitch, src->p[i].i_visible_pitch) *
+                  __MIN(dst->p[i].i_visible_lines, src->p[i].i_visible_lines);
+    vout_statistic_AddCopied(&vout->p->statistic, copied);
+}
+
+static mtime_t ThreadGetSubtitleDate(vout_thread_t *vout, const picture_t *picture)
+{
+    if (vout->p->pause.is_on)
+        return vout->p->pause.date;
+    return picture->date > 1 ? picture->date : mdate();
+}
+
+/* Tell if displaying again the current picture would change anything */
+static bool ThreadDisplayIsChanged(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->displayed.is_changed ||
+        vout_snapshot_IsRequested(&sys->snapshot))
+        return true;
+
+    /* Interactive filters may animate a still picture */
+    vlc_mutex_lock(&sys->filter.lock);
+    const bool is_filtered = filter_chain_GetLength(sys->filter.chain_interactive) > 0;
+    vlc_mutex_unlock(&sys->filter.lock);
+    if (is_filtered)
+        return true;
+
+    return spu_IsChanged(sys->spu,
+                         ThreadGetSubtitleDate(vout, sys->displayed.current),
+                         mdate());
+}
+
 static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -881,6 +922,12 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 
     picture_t *torender = picture_Hold(vout->p->displayed.current);
 
+    /* What is not blending nor display is accounted as conversion */
+    const mtime_t render_start = mdate();
+    mtime_t blend_time = 0;
+    mtime_t display_time = 0;
+    mtime_t time;
+
     vout_chrono_Start(&vout->p->render);
 
     vlc_mutex_lock(&vout->p->filter.lock);
@@ -897,15 +944,16 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
      * Get the subpicture to be displayed
      */
     const bool do_snapshot = vout_snapshot_IsRequested(&vout->p->snapshot);
-    mtime_t render_subtitle_date;
-    if (vout->p->pause.is_on)
-        render_subtitle_date = vout->p->pause.date;
-    else
-        render_subtitle_date = filtered->date > 1 ? filtered->date : mdate();
+    mtime_t render_subtitle_date = ThreadGetSubtitleDate(vout, filtered);
     mtime_t render_osd_date = mdate(); /* FIXME wrong */
 
     /*
      * Get the subpicture to be displayed
+     *
+     * Early blending needs a private copy of the picture, so it is only
+     * used when the display buffer cannot be blended in place: it is the
+     * decoded picture itself (direct rendering), it is slow to read back,
+     * or the snapshot must include the subtitles.
      */
     const bool do_dr_spu = !do_snapshot &&
                            vd->info.subpicture_chromas &&
@@ -913,9 +961,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     const bool do_early_spu = !do_dr_spu &&
                               (vd->info.is_slow ||
                                sys->display.use_dr ||
-                               do_snapshot ||
-                               !vout_IsDisplayFiltered(vd) ||
-                               vd->fmt.i_width * vd->fmt.i_height <= vd->source.i_width * vd->source.i_height);
+                               do_snapshot);
 
     const vlc_fourcc_t *subpicture_chromas;
     video_format_t fmt_spu;
@@ -957,27 +1003,36 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         }
     }
 
+    time = mdate();
     subpicture_t *subpic = spu_Render(vout->p->spu,
                                       subpicture_chromas, &fmt_spu,
                                       &vd->source,
                                       render_subtitle_date, render_osd_date,
                                       do_snapshot);
+    blend_time += mdate() - time;
     /*
      * Perform rendering
      *
      * We have to:
      * - be sure to end up with a direct buffer.
      * - blend subtitles, and in a fast access buffer
+     *
+     * When the display is filtered, the converters read the picture as is
+     * and write into a display buffer, so no intermediate copy is done.
      */
-    bool is_direct = vout->p->decoder_pool == vout->p->display_pool;
+    bool is_direct = !sys->display.use_dr ||
+                     vout->p->decoder_pool == vout->p->display_pool;
     picture_t *todisplay = filtered;
     if (do_early_spu && subpic) {
         todisplay = picture_pool_Get(vout->p->private_pool);
         if (todisplay) {
             VideoFormatCopyCropAr(&todisplay->format, &filtered->format);
-            picture_Copy(todisplay, filtered);
-            if (vout->p->spu_blend)
+            ThreadCopyPicture(vout, todisplay, filtered);
+            if (vout->p->spu_blend) {
+                time = mdate();
                 picture_BlendSubpicture(todisplay, vout->p->spu_blend, subpic);
+                blend_time += mdate() - time;
+            }
         }
         picture_Release(filtered);
         subpicture_Delete(subpic);
@@ -992,7 +1047,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         direct = picture_pool_Get(vout->p->display_pool);
         if (direct) {
             VideoFormatCopyCropAr(&direct->format, &todisplay->format);
-            picture_Copy(direct, todisplay);
+            ThreadCopyPicture(vout, direct, todisplay);
         }
         picture_Release(todisplay);
     } else {
@@ -1013,15 +1068,23 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 
     /* Render the direct buffer */
     assert(vout_IsDisplayFiltered(vd) == !sys->display.use_dr);
+    const mtime_t date = direct->date;
     vout_UpdateDisplaySourceProperties(vd, &direct->format);
     if (sys->display.use_dr) {
+        time = mdate();
         vout_display_Prepare(vd, direct, subpic);
+        display_time += mdate() - time;
     } else {
         sys->display.filtered = vout_FilterDisplay(vd, direct);
         if (sys->display.filtered) {
-            if (!do_dr_spu && !do_early_spu && vout->p->spu_blend && subpic)
+            if (!do_dr_spu && !do_early_spu && vout->p->spu_blend && subpic) {
+                time = mdate();
                 picture_BlendSubpicture(sys->display.filtered, vout->p->spu_blend, subpic);
+                blend_time += mdate() - time;
+            }
+            time = mdate();
             vout_display_Prepare(vd, sys->display.filtered, do_dr_spu ? subpic : NULL);
+            display_time += mdate() - time;
         }
         if (!do_dr_spu && subpic)
             subpicture_Delete(subpic);
@@ -1030,6 +1093,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     }
 
     vout_chrono_Stop(&vout->p->render);
+    const mtime_t convert_time = mdate() - render_start - blend_time - display_time;
 #if 0
         {
         static int i = 0;
@@ -1041,22 +1105,26 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 
     /* Wait the real date (for rendering jitter) */
 #if 0
-    mtime_t delay = direct->date - mdate();
+    mtime_t delay = date - mdate();
     if (delay < 1000)
         msg_Warn(vout, "picture is late (%lld ms)", delay / 1000);
 #endif
     if (!is_forced)
-        mwait(direct->date);
+        mwait(date);
 
     /* Display the direct buffer returned by vout_RenderPicture */
     vout->p->displayed.date = mdate();
+    vout->p->displayed.is_changed = false;
     vout_display_Display(vd,
                          sys->display.filtered ? sys->display.filtered
                                                 : direct,
                          subpic);
     sys->display.filtered = NULL;
+    display_time += mdate() - vout->p->displayed.date;
 
     vout_statistic_Update(&vout->p->statistic, 1, 0);
+    vout_statistic_AddRenderTime(&vout->p->statistic,
+                                 convert_time, blend_time, display_time);
 
     return VLC_SUCCESS;
 }
@@ -1083,14 +1151,9 @@ static int ThreadDisplayPicture(vout_thread_t *vout,
     if (!vout->p->pause.is_on && vout->p->displayed.next)
         date_next = vout->p->displayed.next->date - render_delay;
 
-    /* FIXME/XXX we must redisplay the last decoded picture (because
-     * of potential vout updated, or filters update or SPU update)
-     * For now a high update period is needed but it coulmd be removed
-     * if and only if:
-     * - vout module emits events from theselves.
-     * - *and* SPU is modified to emit an event or a deadline when needed.
-     *
-     * So it will be done latter.
+    /* The last decoded picture may need to be displayed again (because
+     * of a display, filters or SPU update). It is checked periodically,
+     * but only done when something changed (see ThreadDisplayIsChanged).
      */
     mtime_t date_refresh = VLC_TS_INVALID;
     if (vout->p->displayed.date > VLC_TS_INVALID)
@@ -1104,6 +1167,13 @@ static int ThreadDisplayPicture(vout_thread_t *vout,
     if (date_refresh > VLC_TS_INVALID)
         refresh = date_refresh <= date;
 
+    if (!first && !drop && refresh && !ThreadDisplayIsChanged(vout)) {
+        /* What is displayed is still up to date */
+        vout->p->displayed.date = date;
+        date_refresh = date + VOUT_REDISPLAY_DELAY - render_delay;
+        refresh = false;
+    }
+
     if (!first && !refresh && !drop) {
         if (date_next != VLC_TS_INVALID && date_refresh != VLC_TS_INVALID)
             *deadline = __MIN(date_next, date_refresh);
@@ -36,10 +36,31 @@ void vout_ChangePause( vout_thread_t *, bool b_paused, mtime_t i_date );
  */
 void spu_OffsetSubtitleDate( spu_t *p_spu, mtime_t i_duration );
 
+/**
+ * This function returns true if rendering the subpictures at the given
+ * dates may not give the same result as the last spu_Render() call.
+ */
+bool spu_IsChanged( spu_t *p_spu, mtime_t i_subtitle_date, mtime_t i_osd_date );
+
+/**
+ * Work done by the vout thread to render the pictures.
+ */
+typedef struct
+{
+    int64_t i_copied;   /* bytes copied between picture buffers */
+    mtime_t i_convert;  /* time spent filtering, converting and copying */
+    mtime_t i_blend;    /* time spent rendering and blending subpictures */
+    mtime_t i_display;  /* time spent preparing and displaying */
+} vout_render_statistic_t;
+
 /**
  * This function will return and reset internal statistics.
+ *
+ * p_render receives the rendering work done since the last call (no bytes
+ * are copied when the pictures go straight to the display).
  */
-void vout_GetResetStatistic( vout_thread_t *p_vout, int *pi_displayed, int *pi_lost );
+void vout_GetResetStatistic( vout_thread_t *p_vout, int *pi_displayed, int *pi_lost,
+                             vout_render_statistic_t *p_render );
 
 /**
  * This function will ensure that all ready/displayed pciture have at most
@@ -93,6 +93,7 @@ struct vout_thread_sys_t
         mtime_t     timestamp;
         int         qtype;
         bool        is_interlaced;
+        bool        is_changed;     /* the display must be refreshed */
         picture_t   *decoded;
         picture_t   *current;
         picture_t   *next;
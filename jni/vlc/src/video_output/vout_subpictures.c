@@ -61,6 +61,18 @@ typedef struct {
     spu_heap_entry_t entry[VOUT_MAX_SUBPICTURES];
 } spu_heap_t;
 
+/* What spu_Render() would select, used to detect changes without
+ * rendering (see spu_IsChanged) */
+typedef struct {
+    uint64_t generation;
+    struct {
+        bool    is_used;
+        bool    is_started;
+        bool    is_late;
+        mtime_t date;      /* render date of time dependent subpictures */
+    } entry[VOUT_MAX_SUBPICTURES];
+} spu_state_t;
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     vlc_object_t *input;
@@ -93,6 +105,10 @@ struct spu_private_t {
 
     /* */
     mtime_t last_sort_date;
+
+    /* Change tracking */
+    uint64_t    generation;      /**< bumped on every heap/setting change */
+    spu_state_t rendered;        /**< state at the last spu_Render() */
 };
 
 /*****************************************************************************
@@ -584,8 +600,10 @@ static void SpuSelectSubpictures(spu_t *spu,
             bool is_late;
 
             if (!current || entry->reject) {
-                if (entry->reject)
+                if (entry->reject) {
                     SpuHeapDeleteAt(&sys->heap, index);
+                    sys->generation++;
+                }
                 continue;
             }
 
@@ -649,9 +667,10 @@ static void SpuSelectSubpictures(spu_t *spu,
                     is_rejeted = true;
             }
 
-            if (is_rejeted)
+            if (is_rejeted) {
                 SpuHeapDeleteSubpicture(&sys->heap, current);
-            else
+                sys->generation++;
+            } else
                 subpicture_array[(*subpicture_count)++] = current;
         }
     }
@@ -659,6 +678,61 @@ static void SpuSelectSubpictures(spu_t *spu,
     sys->last_sort_date = render_subtitle_date;
 }
 
+/*****************************************************************************
+ * SpuGetState: summarize the subpictures spu_Render() would use
+ *****************************************************************************
+ * It follows the rules of SpuSelectSubpictures without modifying anything.
+ * Dynamic and fading subpictures change with the render date itself.
+ *****************************************************************************/
+static void SpuGetState(spu_t *spu, spu_state_t *state,
+                        mtime_t render_subtitle_date,
+                        mtime_t render_osd_date)
+{
+    spu_private_t *sys = spu->p;
+
+    state->generation = sys->generation;
+    for (int index = 0; index < VOUT_MAX_SUBPICTURES; index++) {
+        const subpicture_t *current = sys->heap.entry[index].subpicture;
+
+        state->entry[index].is_used    = current != NULL;
+        state->entry[index].is_started = false;
+        state->entry[index].is_late    = false;
+        state->entry[index].date       = VLC_TS_INVALID;
+        if (!current)
+            continue;
+
+        const mtime_t render_date = current->b_subtitle ? render_subtitle_date : render_osd_date;
+        const bool is_started = !render_date || render_date >= current->i_start;
+        const bool is_stop_valid = !current->b_ephemer || current->i_stop > current->i_start;
+        const bool is_late = is_stop_valid && current->i_stop <= render_date;
+
+        bool is_dynamic = current->updater.pf_validate != NULL;
+        if (current->b_fade) {
+            const mtime_t fade_start = current->i_start + 3 * (current->i_stop - current->i_start) / 4;
+            is_dynamic |= fade_start <= render_date && render_date < current->i_stop;
+        }
+
+        state->entry[index].is_started = is_started;
+        state->entry[index].is_late    = is_late;
+        if (is_started && !is_late && is_dynamic)
+            state->entry[index].date = render_date;
+    }
+}
+
+static bool SpuStateIsEqual(const spu_state_t *a, const spu_state_t *b)
+{
+    if (a->generation != b->generation)
+        return false;
+    for (int index = 0; index < VOUT_MAX_SUBPICTURES; index++) {
+        if (a->entry[index].is_used    != b->entry[index].is_used    ||
+            a->entry[index].is_started != b->entry[index].is_started ||
+            a->entry[index].is_late    != b->entry[index].is_late    ||
+            a->entry[index].date       != b->entry[index].date)
+            return false;
+    }
+    return true;
+}
+
 
 
 /**
@@ -1108,6 +1182,7 @@ static void UpdateSPU(spu_t *spu, vlc_object_t *object)
 
     sys->force_palette = false;
     sys->force_crop = false;
+    sys->generation++;
 
     if (var_Get(object, "highlight", &val) || !val.b_bool) {
         vlc_mutex_unlock(&sys->lock);
@@ -1408,6 +1483,7 @@ void spu_PutSubpicture(spu_t *spu, subpicture_t *subpic)
         subpicture_Delete(subpic);
         return;
     }
+    sys->generation++;
     vlc_mutex_unlock(&sys->lock);
 }
 
@@ -1464,6 +1540,7 @@ subpicture_t *spu_Render(spu_t *spu,
     /* Get an array of subpictures to render */
     SpuSelectSubpictures(spu, &subpicture_count, subpicture_array,
                          render_subtitle_date, render_osd_date, ignore_osd);
+    SpuGetState(spu, &sys->rendered, render_subtitle_date, render_osd_date);
     if (subpicture_count <= 0) {
         vlc_mutex_unlock(&sys->lock);
         return NULL;
@@ -1510,7 +1587,33 @@ void spu_OffsetSubtitleDate(spu_t *spu, mtime_t duration)
                 current->i_stop  += duration;
         }
     }
+    sys->generation++;
+    vlc_mutex_unlock(&sys->lock);
+}
+
+bool spu_IsChanged(spu_t *spu,
+                   mtime_t render_subtitle_date,
+                   mtime_t render_osd_date)
+{
+    spu_private_t *sys = spu->p;
+
+    /* Subpicture sources only run when rendering */
+    vlc_mutex_lock(&sys->source_chain_lock);
+    bool is_changed = filter_chain_GetLength(sys->source_chain) > 0;
+    vlc_mutex_unlock(&sys->source_chain_lock);
+
+    vlc_mutex_lock(&sys->lock);
+    if (!is_changed && !sys->source_chain_update) {
+        spu_state_t state;
+
+        SpuGetState(spu, &state, render_subtitle_date, render_osd_date);
+        is_changed = !SpuStateIsEqual(&state, &sys->rendered);
+    } else {
+        is_changed = true;
+    }
     vlc_mutex_unlock(&sys->lock);
+
+    return is_changed;
 }
 
 int spu_RegisterChannel(spu_t *spu)
@@ -1541,6 +1644,7 @@ void spu_ClearChannel(spu_t *spu, int channel)
 
         /* You cannot delete subpicture outside of spu_SortSubpictures */
         entry->reject = true;
+        sys->generation++;
     }
 
     vlc_mutex_unlock(&sys->lock);
@@ -1566,6 +1670,7 @@ void spu_ChangeFilters(spu_t *spu, const char *filters)
 
     free(sys->filter_chain_update);
     sys->filter_chain_update = strdup(filters);
+    sys->generation++;
 
     vlc_mutex_unlock(&sys->lock);
 }
@@ -1576,6 +1681,7 @@ void spu_ChangeMargin(spu_t *spu, int margin)
 
     vlc_mutex_lock(&sys->lock);
     sys->margin = margin;
+    sys->generation++;
     vlc_mutex_unlock(&sys->lock);
 }
 
@@ -113,18 +113,16 @@ static void NoDrInit(vout_thread_t *vout)
 {
     vout_thread_sys_t *sys = vout->p;
 
+    /* A filtered display converts straight from the decoded pictures into
+     * its own buffers, it does not need an intermediate pool */
     if (sys->display.use_dr)
         sys->display_pool = vout_display_Pool(sys->display.vd, 3);
     else
-        //sys->display_pool = picture_pool_Reserve(sys->decoder_pool, DISPLAY_PICTURE_COUNT);
-        sys->display_pool = picture_pool_NewFromFormat(&sys->display.vd->source, DISPLAY_PICTURE_COUNT);
+        sys->display_pool = NULL;
 }
 static void NoDrClean(vout_thread_t *vout)
 {
-    vout_thread_sys_t *sys = vout->p;
-
-    if (!sys->display.use_dr)
-        picture_pool_Delete(sys->display_pool);
+    VLC_UNUSED(vout);
 }
 int vout_InitWrapper(vout_thread_t *vout)
 {
@@ -192,7 +190,8 @@ void vout_ManageWrapper(vout_thread_t *vout)
     vout_display_t *vd = sys->display.vd;
 
     bool reset_display_pool = sys->display.use_dr && vout_AreDisplayPicturesInvalid(vd);
-    vout_ManageDisplay(vd, !sys->display.use_dr || reset_display_pool);
+    if (vout_ManageDisplay(vd, !sys->display.use_dr || reset_display_pool))
+        sys->displayed.is_changed = true;
 
     if (reset_display_pool) {
         NoDrClean(vout);
@@ -0,0 +1,162 @@
+/*****************************************************************************
+ * copy.c: test and benchmark the ARM NEON copies against the libc memcpy
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../libvlc/test.h"
+
+#include "../../../modules/arm_neon/copy.h"
+
+#ifdef __ARM_NEON__
+#define GUARD 64
+#define SIZE  4096
+
+/* Random sizes and misalignments, nothing around must be touched */
+static void test_memcpy( void )
+{
+    static uint8_t p_src[SIZE + 2 * GUARD];
+    static uint8_t p_ref[SIZE + 2 * GUARD];
+    static uint8_t p_dst[SIZE + 2 * GUARD];
+
+    log( "Testing NEON memcpy\n" );
+    srand( 42 );
+    for( int i_loop = 0; i_loop < 10000; i_loop++ )
+    {
+        const size_t i_size = rand() % ( SIZE - 16 );
+        const size_t i_src  = GUARD + rand() % 16;
+        const size_t i_dst  = GUARD + rand() % 16;
+
+        for( size_t i = 0; i < sizeof(p_src); i++ )
+            p_src[i] = rand();
+        memset( p_ref, 0xaa, sizeof(p_ref) );
+        memset( p_dst, 0xaa, sizeof(p_dst) );
+
+        memcpy( &p_ref[i_dst], &p_src[i_src], i_size );
+        assert( copy_MemcpyNEON( &p_dst[i_dst], &p_src[i_src], i_size ) ==
+                &p_dst[i_dst] );
+        assert( !memcmp( p_ref, p_dst, sizeof(p_dst) ) );
+    }
+}
+
+static void test_plane( void )
+{
+    static uint8_t p_src[SIZE * 4];
+    static uint8_t p_ref[SIZE * 4];
+    static uint8_t p_dst[SIZE * 4];
+
+    log( "Testing NEON plane copy\n" );
+    srand( 42 );
+    for( int i_loop = 0; i_loop < 1000; i_loop++ )
+    {
+        const size_t i_width     = 1 + rand() % 600;
+        const size_t i_src_pitch = i_width + rand() % 64;
+        const size_t i_dst_pitch = i_width + rand() % 64;
+        const size_t i_lines     = 1 + rand() % ( sizeof(p_dst) / 2 / 664 );
+
+        for( size_t i = 0; i < sizeof(p_src); i++ )
+            p_src[i] = rand();
+        memset( p_ref, 0xaa, sizeof(p_ref) );
+        memset( p_dst, 0xaa, sizeof(p_dst) );
+
+        for( size_t y = 0; y < i_lines; y++ )
+            memcpy( &p_ref[y * i_dst_pitch], &p_src[y * i_src_pitch], i_width );
+        copy_PlaneNEON( p_dst, i_dst_pitch, p_src, i_src_pitch,
+                        i_width, i_lines );
+        assert( !memcmp( p_ref, p_dst, sizeof(p_dst) ) );
+    }
+}
+
+static double Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* A 720p I420 frame between a decoder and a display buffer whose pitches
+ * differ, ie the line by line case of plane_CopyPixels */
+#define WIDTH  1280
+#define HEIGHT 720
+#define FRAMES 100
+
+static void bench_plane( void )
+{
+    const size_t i_src_pitch = WIDTH + 32;
+    const size_t i_dst_pitch = WIDTH + 64;
+    uint8_t *p_src = malloc( i_src_pitch * HEIGHT * 3 / 2 );
+    uint8_t *p_dst = malloc( i_dst_pitch * HEIGHT * 3 / 2 );
+
+    assert( p_src && p_dst );
+    memset( p_src, 0x55, i_src_pitch * HEIGHT * 3 / 2 );
+    memset( p_dst, 0, i_dst_pitch * HEIGHT * 3 / 2 );
+
+    for( int i_neon = 0; i_neon < 2; i_neon++ )
+    {
+        const double start = Now();
+
+        for( int i_frame = 0; i_frame < FRAMES; i_frame++ )
+        {
+            /* Y then the U and V planes as one plane of half pitch */
+            if( i_neon )
+            {
+                copy_PlaneNEON( p_dst, i_dst_pitch, p_src, i_src_pitch,
+                                WIDTH, HEIGHT );
+                copy_PlaneNEON( p_dst + i_dst_pitch * HEIGHT, i_dst_pitch / 2,
+                                p_src + i_src_pitch * HEIGHT, i_src_pitch / 2,
+                                WIDTH / 2, HEIGHT );
+            }
+            else
+            {
+                for( int y = 0; y < HEIGHT; y++ )
+                    memcpy( &p_dst[y * i_dst_pitch],
+                            &p_src[y * i_src_pitch], WIDTH );
+                for( int y = 0; y < HEIGHT; y++ )
+                    memcpy( &p_dst[i_dst_pitch * HEIGHT + y * i_dst_pitch / 2],
+                            &p_src[i_src_pitch * HEIGHT + y * i_src_pitch / 2],
+                            WIDTH / 2 );
+            }
+        }
+
+        const double duration = Now() - start;
+        log( "%s: %.2f ms/frame, %.0f MB/s\n",
+             i_neon ? "NEON plane copy" : "libc memcpy    ",
+             1000. * duration / FRAMES,
+             (double)WIDTH * HEIGHT * 3 / 2 * FRAMES / duration / 1e6 );
+    }
+    free( p_src );
+    free( p_dst );
+}
+#endif
+
+int main( void )
+{
+#ifdef __ARM_NEON__
+    test_memcpy();
+    test_plane();
+    bench_plane();
+    return 0;
+#else
+    log( "NEON is not available, skipping\n" );
+    return 77;
+#endif
+}
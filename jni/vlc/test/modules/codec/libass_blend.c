@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * libass_blend.c: test the libass premultiplied compositor
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../libvlc/test.h"
+
+#include "../../../modules/codec/libass_blend.h"
+
+#define WIDTH  67 /* not a multiple of 8 to test the tails */
+#define HEIGHT 8
+#define IMAGES 12
+
+typedef struct
+{
+    int x, y, w, h;
+    uint32_t color;
+    uint8_t mask[HEIGHT][WIDTH];
+} image_t;
+
+/* The straight alpha compositing done per pixel before */
+static void BlendReference( uint8_t *p_rgba, const image_t *p_img )
+{
+    const unsigned r = (p_img->color >> 24)&0xff;
+    const unsigned g = (p_img->color >> 16)&0xff;
+    const unsigned b = (p_img->color >>  8)&0xff;
+    const unsigned a = (p_img->color      )&0xff;
+
+    for( int y = 0; y < p_img->h; y++ )
+    {
+        for( int x = 0; x < p_img->w; x++ )
+        {
+            const unsigned alpha = p_img->mask[y][x];
+            const unsigned an = (255 - a) * alpha / 255;
+            uint8_t *p = &p_rgba[4 * ( (y + p_img->y) * WIDTH + x + p_img->x )];
+            const unsigned ao = p[3];
+
+            if( ao == 0 )
+            {
+                p[0] = r;
+                p[1] = g;
+                p[2] = b;
+                p[3] = an;
+            }
+            else
+            {
+                p[3] = 255 - ( 255 - p[3] ) * ( 255 - an ) / 255;
+                if( p[3] != 0 )
+                {
+                    p[0] = ( p[0] * ao * (255-an) / 255 + r * an ) / p[3];
+                    p[1] = ( p[1] * ao * (255-an) / 255 + g * an ) / p[3];
+                    p[2] = ( p[2] * ao * (255-an) / 255 + b * an ) / p[3];
+                }
+            }
+        }
+    }
+}
+
+static void BlendTested( uint8_t *p_rgba, const image_t *p_img,
+                         libass_blend_line_t pf_blend )
+{
+    for( int y = 0; y < p_img->h; y++ )
+        pf_blend( &p_rgba[4 * ( (y + p_img->y) * WIDTH + p_img->x )],
+                  p_img->mask[y], p_img->w, p_img->color );
+}
+
+static void RandomImage( image_t *p_img )
+{
+    p_img->x = rand() % WIDTH;
+    p_img->y = rand() % HEIGHT;
+    p_img->w = 1 + rand() % ( WIDTH - p_img->x );
+    p_img->h = 1 + rand() % ( HEIGHT - p_img->y );
+    p_img->color = ( (uint32_t)rand() << 8 ) ^ (uint32_t)rand();
+    /* mostly opaque glyphs with antialiased borders and empty runs */
+    for( int y = 0; y < HEIGHT; y++ )
+        for( int x = 0; x < WIDTH; x++ )
+        {
+            const int k = rand() % 4;
+            p_img->mask[y][x] = k == 0 ? 0 : k == 1 ? 255 : rand() & 0xff;
+        }
+}
+
+/* Compare in premultiplied space: the straight color of a nearly
+ * transparent pixel is meaningless (and not representable). The reference
+ * truncates at every step, so it drifts a little when images overlap. */
+static void Compare( const uint8_t *p_ref, const uint8_t *p_new )
+{
+    for( int i = 0; i < WIDTH * HEIGHT; i++, p_ref += 4, p_new += 4 )
+    {
+        assert( abs( p_ref[3] - p_new[3] ) <= 3 );
+        for( int c = 0; c < 3; c++ )
+        {
+            const int i_ref = p_ref[c] * p_ref[3];
+            const int i_new = p_new[c] * p_new[3];
+            assert( abs( i_ref - i_new ) <= 4 * 255 );
+        }
+    }
+}
+
+static void test_blend( const char *psz_name, libass_blend_line_t pf_blend )
+{
+    static image_t images[IMAGES];
+    static uint8_t p_ref[4 * WIDTH * HEIGHT];
+    static uint8_t p_new[4 * WIDTH * HEIGHT];
+
+    log( "Testing %s compositor\n", psz_name );
+    srand( 42 );
+    for( int i_loop = 0; i_loop < 1000; i_loop++ )
+    {
+        const int i_images = 1 + rand() % IMAGES;
+
+        memset( p_ref, 0, sizeof(p_ref) );
+        memset( p_new, 0, sizeof(p_new) );
+        for( int i = 0; i < i_images; i++ )
+        {
+            RandomImage( &images[i] );
+            BlendReference( p_ref, &images[i] );
+            BlendTested( p_new, &images[i], pf_blend );
+        }
+        for( int y = 0; y < HEIGHT; y++ )
+            libass_Unpremultiply( &p_new[4 * y * WIDTH], WIDTH );
+
+        Compare( p_ref, p_new );
+    }
+}
+
+#ifdef __ARM_NEON__
+/* The NEON version must be bit exact with the C one */
+static void test_blend_neon( void )
+{
+    static image_t image;
+    static uint8_t p_c[4 * WIDTH * HEIGHT];
+    static uint8_t p_neon[4 * WIDTH * HEIGHT];
+
+    log( "Testing NEON compositor against C\n" );
+    srand( 42 );
+    memset( p_c, 0, sizeof(p_c) );
+    memset( p_neon, 0, sizeof(p_neon) );
+    for( int i_loop = 0; i_loop < 1000; i_loop++ )
+    {
+        RandomImage( &image );
+        BlendTested( p_c, &image, libass_BlendLineC );
+        BlendTested( p_neon, &image, libass_BlendLineNEON );
+        assert( !memcmp( p_c, p_neon, sizeof(p_c) ) );
+    }
+}
+#endif
+
+int main( void )
+{
+    test_blend( "C", libass_BlendLineC );
+#ifdef __ARM_NEON__
+    test_blend( "NEON", libass_BlendLineNEON );
+    test_blend_neon();
+#endif
+
+    return 0;
+}
@@ -1,5 +1,7 @@
 package org.stagex.danmaku;
 
+import org.stagex.danmaku.player.VlcMediaPlayer;
+
 import android.app.Application;
 
 public class Danmaku extends Application {
@@ -84,6 +86,7 @@ public class Danmaku extends Application {
 		super.onCreate();
 
 		System.setProperty("java.net.preferIPv6Addresses", "false");
+		VlcMediaPlayer.setCacheDir(getCacheDir().getAbsolutePath());
 
 	}
 
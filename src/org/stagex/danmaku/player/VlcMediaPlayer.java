@@ -1,5 +1,8 @@
 package org.stagex.danmaku.player;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
 import android.graphics.PixelFormat;
 import android.media.MediaPlayer;
 import android.util.Log;
@@ -26,16 +29,91 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 	/* */
 	private int mTime = -1;
 
+	/* playback state written by the native side, see vlc_jni_state_t,
+	 * the 64 bits time and length are only read through the getters */
+	private static final int STATE_POSITION = 16;
+	private static final int STATE_BUFFERING = 20;
+
+	private ByteBuffer mState = null;
+	/* held while mState is read, so that release() cannot free it meanwhile */
+	private final Object mStateLock = new Object();
+
+	/* pipeline statistics filled by the native side, in this order */
+	private static final int STATS_DEMUX_TIME = 0;
+	private static final int STATS_DECODE_VIDEO_TIME = 1;
+	private static final int STATS_DECODE_AUDIO_TIME = 2;
+	private static final int STATS_CONVERT_TIME = 3;
+	private static final int STATS_BLEND_TIME = 4;
+	private static final int STATS_DISPLAY_TIME = 5;
+	private static final int STATS_AUDIO_DELAY = 6;
+	private static final int STATS_DECODED_PICTURES = 7;
+	private static final int STATS_DISPLAYED_PICTURES = 8;
+	private static final int STATS_LOST_PICTURES = 9;
+	private static final int STATS_DECODED_ABUFFERS = 10;
+	private static final int STATS_PLAYED_ABUFFERS = 11;
+	private static final int STATS_LOST_ABUFFERS = 12;
+	private static final int STATS_DEMUX_CORRUPTED = 13;
+	private static final int STATS_COPIED_BYTES = 14;
+	private static final int STATS_VIDEO_QUEUE = 15;
+	private static final int STATS_AUDIO_QUEUE = 16;
+	private static final int STATS_READ_BYTES = 17;
+	private static final int STATS_NETWORK_JITTER = 18;
+	private static final int STATS_NETWORK_LOST = 19;
+	private static final int STATS_NETWORK_BUFFER = 20;
+	private static final int STATS_COUNT = 21;
+
+	/*
+	 * Statistics of the current media, the times are the microseconds spent
+	 * in each stage since the start of the playback.
+	 */
+	public static class Stats {
+		public long demuxTime;
+		public long decodeVideoTime;
+		public long decodeAudioTime;
+		/* video filters, chroma conversion and copies */
+		public long convertTime;
+		/* subtitles and OSD rendering and blending */
+		public long blendTime;
+		public long displayTime;
+		/* how long the last audio buffer waits before being played */
+		public long audioDelay;
+		public long decodedPictures;
+		public long displayedPictures;
+		/* late or undisplayable pictures */
+		public long lostPictures;
+		public long decodedAudioBuffers;
+		public long playedAudioBuffers;
+		public long lostAudioBuffers;
+		public long demuxCorrupted;
+		public long copiedBytes;
+		/* blocks waiting for the decoders */
+		public long videoQueue;
+		public long audioQueue;
+		public long readBytes;
+		/* live sources: measured jitter, lost packets and jitter buffer */
+		public long networkJitter;
+		public long networkLost;
+		public long networkBuffer;
+	}
+
+	private long[] mStats = new long[STATS_COUNT];
+
 	/*  */
 	protected native void nativeAttachSurface(Surface s);
 
 	protected native void nativeDetachSurface();
 
 	/* */
+	protected static native void nativeSetCacheDir(String dir);
+
 	protected native void nativeCreate();
 
 	protected native void nativeRelease();
 
+	protected native ByteBuffer nativeGetState();
+
+	protected native boolean nativeGetStats(long[] stats);
+
 	protected native int nativeGetCurrentPosition();
 
 	protected native int nativeGetDuration();
@@ -65,7 +143,7 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 	protected native void nativeStop();
 
 	@SuppressWarnings("unused")
-	private class VlcEvent {
+	private static class VlcEvent {
 		/* see native side */
 		public final static int MediaMetaChanged = 0;
 		public final static int MediaSubItemAdded = 1;
@@ -91,21 +169,15 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 		public final static int MediaPlayerTitleChanged = 271;
 		public final static int MediaPlayerSnapshotTaken = 272;
 		public final static int MediaPlayerLengthChanged = 273;
-		/* the variables we received */
-		public int eventType = -1;
-		public boolean booleanValue = false;
-		public int intValue = -1;
-		public long longValue = -1;
-		public float floatValue = -1.0f;
-		public String stringValue = null;
-	}
-
-	/* called by native side */
-	private void onVlcEvent(VlcEvent ev) {
-		//Log.d(LOGTAG, String.format("received vlc event %d", ev.eventType));
-		switch (ev.eventType) {
+	}
+
+	/* called by native side, from its event thread */
+	private void onVlcEvent(int eventType, boolean booleanValue, int intValue,
+			long longValue, float floatValue, String stringValue) {
+		//Log.d(LOGTAG, String.format("received vlc event %d", eventType));
+		switch (eventType) {
 		case VlcEvent.MediaParsedChanged: {
-			if (!ev.booleanValue) {
+			if (!booleanValue) {
 				if (mOnErrorListener != null) {
 					mOnErrorListener.onError(this,
 							MediaPlayer.MEDIA_ERROR_UNKNOWN, 0);
@@ -125,7 +197,7 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 		}
 		case VlcEvent.MediaPlayerBuffering: {
 			if (mOnBufferingUpdateListener != null) {
-				int percent = (int) (ev.floatValue);
+				int percent = (int) (floatValue);
 				mOnBufferingUpdateListener.onBufferingUpdate(this, percent);
 			}
 			break;
@@ -146,7 +218,7 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 		case VlcEvent.MediaPlayerTimeChanged: {
 			if (mOnProgressUpdateListener != null) {
 				mOnProgressUpdateListener.onProgressUpdate(this,
-						(int) ev.longValue, -1);
+						(int) longValue, -1);
 			}
 			if (mTime < 0) {
 				if (mOnVideoSizeChangedListener != null) {
@@ -156,11 +228,11 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 							this, width, height);
 				}
 			}
-			mTime = (int) ev.longValue;
+			mTime = (int) longValue;
 			break;
 		}
 		case VlcEvent.MediaPlayerSeekableChanged: {
-			if (!ev.booleanValue) {
+			if (!booleanValue) {
 				if (mOnInfoListener != null) {
 					mOnInfoListener.onInfo(this,
 							MediaPlayer.MEDIA_INFO_NOT_SEEKABLE, 0);
@@ -171,19 +243,73 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 		case VlcEvent.MediaPlayerLengthChanged: {
 			if (mOnProgressUpdateListener != null) {
 				mOnProgressUpdateListener.onProgressUpdate(
-						(AbsMediaPlayer) this, -1, (int) ev.longValue);
+						(AbsMediaPlayer) this, -1, (int) longValue);
 			}
 			break;
 		}
 		}
 	}
 
+	/* enable the on-disk caches, in the application cache directory */
+	public static void setCacheDir(String dir) {
+		nativeSetCacheDir(dir);
+	}
+
 	public static VlcMediaPlayer getInstance() {
 		return new VlcMediaPlayer();
 	}
 
 	protected VlcMediaPlayer() {
 		nativeCreate();
+		ByteBuffer state = nativeGetState();
+		if (state != null)
+			mState = state.order(ByteOrder.nativeOrder());
+	}
+
+	/* the last playback position (0.0 to 1.0) reported by the native side */
+	public float getPlaybackPosition() {
+		synchronized (mStateLock) {
+			return mState != null ? mState.getFloat(STATE_POSITION) : -1.0f;
+		}
+	}
+
+	/* the last buffering percentage reported by the native side */
+	public float getBufferingPercent() {
+		synchronized (mStateLock) {
+			return mState != null ? mState.getFloat(STATE_BUFFERING) : -1.0f;
+		}
+	}
+
+	/* the statistics of the current media, null if there are none yet */
+	public Stats getStats() {
+		long[] s = mStats;
+		synchronized (s) {
+			if (!nativeGetStats(s))
+				return null;
+			Stats stats = new Stats();
+			stats.demuxTime = s[STATS_DEMUX_TIME];
+			stats.decodeVideoTime = s[STATS_DECODE_VIDEO_TIME];
+			stats.decodeAudioTime = s[STATS_DECODE_AUDIO_TIME];
+			stats.convertTime = s[STATS_CONVERT_TIME];
+			stats.blendTime = s[STATS_BLEND_TIME];
+			stats.displayTime = s[STATS_DISPLAY_TIME];
+			stats.audioDelay = s[STATS_AUDIO_DELAY];
+			stats.decodedPictures = s[STATS_DECODED_PICTURES];
+			stats.displayedPictures = s[STATS_DISPLAYED_PICTURES];
+			stats.lostPictures = s[STATS_LOST_PICTURES];
+			stats.decodedAudioBuffers = s[STATS_DECODED_ABUFFERS];
+			stats.playedAudioBuffers = s[STATS_PLAYED_ABUFFERS];
+			stats.lostAudioBuffers = s[STATS_LOST_ABUFFERS];
+			stats.demuxCorrupted = s[STATS_DEMUX_CORRUPTED];
+			stats.copiedBytes = s[STATS_COPIED_BYTES];
+			stats.videoQueue = s[STATS_VIDEO_QUEUE];
+			stats.audioQueue = s[STATS_AUDIO_QUEUE];
+			stats.readBytes = s[STATS_READ_BYTES];
+			stats.networkJitter = s[STATS_NETWORK_JITTER];
+			stats.networkLost = s[STATS_NETWORK_LOST];
+			stats.networkBuffer = s[STATS_NETWORK_BUFFER];
+			return stats;
+		}
 	}
 
 	@Override
@@ -234,6 +360,10 @@ public class VlcMediaPlayer extends AbsMediaPlayer {
 
 	@Override
 	public void release() {
+		/* the state buffer is freed with the native player */
+		synchronized (mStateLock) {
+			mState = null;
+		}
 		nativeRelease();
 	}
 